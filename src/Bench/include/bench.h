@@ -0,0 +1,31 @@
+#pragma once
+
+#include <core.h>
+
+// Headless micro-benchmarks for core subsystems. The first argument picks the benchmark,
+// the rest are benchmark options plus the usual core command line.
+class Bench : core
+{
+public:
+    Bench( const std::vector<std::string>& args );
+
+    void run();
+
+private:
+    std::vector<std::string> m_args;
+
+    bool hasArg( const std::string& name ) const;
+    uint32_t argValue( const std::string& name, uint32_t defaultValue ) const;
+
+    void initDevice();
+    void initRendering();
+
+    void memoryBenchmark();
+    void uploadBenchmark();
+    void recordBenchmark();
+    void computeBenchmark();
+    void descriptorBenchmark();
+    void pipelineBenchmark();
+    void specializationBenchmark();
+    void vertexBenchmark();
+};
@@ -0,0 +1,16 @@
+#version 450
+
+// Tiny triangle placed on a 512x512 grid by the instance index, no vertex buffers
+vec2 positions[3] = vec2[](
+    vec2(0.0, -1.0),
+    vec2(1.0, 1.0),
+    vec2(-1.0, 1.0)
+);
+
+void main()
+{
+    vec2 cell = vec2( gl_InstanceIndex % 512, ( gl_InstanceIndex / 512 ) % 512 );
+    vec2 center = ( cell + 0.5 ) / 256.0 - 1.0;
+
+    gl_Position = vec4( center + positions[gl_VertexIndex] / 512.0, 0.0, 1.0 );
+}
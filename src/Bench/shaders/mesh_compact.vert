@@ -0,0 +1,23 @@
+#version 450
+
+// mesh_float.vert for quantized meshes: half float position, octahedral normal, 8 bit color
+layout( location = 0 ) in vec3 inPosition;
+layout( location = 1 ) in vec2 inOctahedral;
+layout( location = 2 ) in vec4 inColor;
+
+vec3 decodeOctahedral( vec2 e )
+{
+	vec3 n = vec3( e, 1.0 - abs( e.x ) - abs( e.y ) );
+	if( n.z < 0.0 )
+	{
+		// Not sign(): the encoder maps 0 to +1, sign() would fold it onto the axis
+		n.xy = ( 1.0 - abs( n.yx ) ) * mix( vec2( -1.0 ), vec2( 1.0 ), step( vec2( 0.0 ), n.xy ) );
+	}
+	return normalize( n );
+}
+
+void main()
+{
+	float shade = dot( decodeOctahedral( inOctahedral ), vec3( 0.577 ) ) * inColor.a;
+	gl_Position = vec4( inPosition.xy, 2.0 + shade * 0.001 + inPosition.z * 0.0001, 1.0 );
+}
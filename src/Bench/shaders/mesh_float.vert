@@ -0,0 +1,13 @@
+#version 450
+
+// Full precision mesh vertex. Every attribute feeds the depth, which lands behind the far plane:
+// the vertices are fetched and shaded, nothing gets rasterized.
+layout( location = 0 ) in vec3 inPosition;
+layout( location = 1 ) in vec3 inNormal;
+layout( location = 2 ) in vec4 inColor;
+
+void main()
+{
+	float shade = dot( inNormal, vec3( 0.577 ) ) * inColor.a;
+	gl_Position = vec4( inPosition.xy, 2.0 + shade * 0.001 + inPosition.z * 0.0001, 1.0 );
+}
@@ -0,0 +1,9 @@
+#version 450
+
+// Position only, like a depth prepass: whatever else the layout has is left unread
+layout( location = 0 ) in vec3 inPosition;
+
+void main()
+{
+	gl_Position = vec4( inPosition.xy, 2.0 + inPosition.z * 0.0001, 1.0 );
+}
@@ -0,0 +1,42 @@
+#version 450
+
+// A per-pixel ALU loop. The trip count and the loop body come from specialization constants,
+// or from push constants while the constants keep their default of 0, so the same module
+// builds the uniform-driven pipeline and every specialized one.
+layout( constant_id = 0 ) const uint ITERATIONS = 0;
+layout( constant_id = 1 ) const uint MODE = 0;
+
+layout( push_constant ) uniform Params
+{
+	uint iterations;
+	uint mode;
+} params;
+
+layout( location = 0 ) out vec4 outColor;
+
+void main()
+{
+	uint iterations = ITERATIONS != 0 ? ITERATIONS : params.iterations;
+	uint mode = MODE != 0 ? MODE : params.mode;
+
+	vec2 p = gl_FragCoord.xy / 512.0;
+	vec3 color = vec3( 0.0 );
+	for( uint i = 0; i < iterations; i++ )
+	{
+		if( mode == 1 )
+		{
+			p = sin( p.yx * 1.7 + vec2( 0.3, 0.1 ) );
+		}
+		else if( mode == 2 )
+		{
+			p = fract( p * 1.618 + p.yx * p.yx );
+		}
+		else
+		{
+			p = vec2( cos( p.x + p.y ), sin( p.x - p.y ) ) * 0.9;
+		}
+		color += vec3( abs( p ), 0.5 );
+	}
+
+	outColor = vec4( clamp( color / float( max( iterations, 1u ) ), 0.0, 1.0 ), 1.0 );
+}
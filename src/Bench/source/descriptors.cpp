@@ -0,0 +1,127 @@
+#include <bench.h>
+
+// Allocates and writes N descriptor sets per frame, once with a vkAllocateDescriptorSets and
+// vkFreeDescriptorSets per set from a FREE_DESCRIPTOR_SET pool, and once through core's
+// DescriptorAllocator which hands whole pools back with one reset per frame slot.
+void Bench::descriptorBenchmark()
+{
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    const uint32_t sets = std::max( argValue( "--sets", 10000 ), 1u );
+    const uint32_t frames = std::max( argValue( "--frames", 100 ), 1u );
+    const VkDevice device = GetDevice();
+
+    // A typical draw set: per-object uniforms plus two storage buffers
+    std::vector<VkDescriptorSetLayoutBinding> bindings( 3 );
+    for( uint32_t i = 0; i < bindings.size(); i++ )
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
+    VkDescriptorSetLayout setLayout = GetDescriptorLayouts().getSetLayout( bindings );
+
+    VkBuffer buffer;
+    Allocation allocation;
+    createBuffer( 64 * 1024, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, allocation );
+
+    DescriptorWriter writer;
+    auto writeSet = [&]( VkDescriptorSet set, uint32_t index )
+    {
+        const VkDeviceSize offset = ( index % 64 ) * 256;
+        writer.writeBuffer( 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, buffer, offset, 256 )
+            .writeBuffer( 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffer, 0, 32 * 1024 )
+            .writeBuffer( 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffer, 32 * 1024, 32 * 1024 )
+            .update( device, set );
+    };
+
+    // Old path: one pool big enough for a frame, every set allocated and freed on its own
+    VkDescriptorPoolSize poolSizes[] = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sets },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, sets * 2 }
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolInfo.maxSets = sets;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+
+    VkDescriptorPool pool;
+    if( vkCreateDescriptorPool( device, &poolInfo, nullptr, &pool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create descriptor pool!" );
+    }
+
+    std::vector<VkDescriptorSet> frameSets( sets );
+
+    Milliseconds perSetAlloc{ 0 };
+    Milliseconds perSetFree{ 0 };
+    for( uint32_t frame = 0; frame < frames; frame++ )
+    {
+        Clock::time_point start = Clock::now();
+        for( uint32_t i = 0; i < sets; i++ )
+        {
+            VkDescriptorSetAllocateInfo allocateInfo{};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocateInfo.descriptorPool = pool;
+            allocateInfo.descriptorSetCount = 1;
+            allocateInfo.pSetLayouts = &setLayout;
+
+            if( vkAllocateDescriptorSets( device, &allocateInfo, &frameSets[i] ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to allocate descriptor set!" );
+            }
+            writeSet( frameSets[i], i );
+        }
+        Clock::time_point allocated = Clock::now();
+
+        for( uint32_t i = 0; i < sets; i++ )
+        {
+            vkFreeDescriptorSets( device, pool, 1, &frameSets[i] );
+        }
+
+        perSetAlloc += allocated - start;
+        perSetFree += Clock::now() - allocated;
+    }
+
+    vkDestroyDescriptorPool( device, pool, nullptr );
+
+    // New path: frame slots take turns, a slot's pools are reset when it comes round again
+    DescriptorAllocator& allocator = GetDescriptorAllocator();
+    const DescriptorAllocator::Stats before = allocator.stats();
+
+    Milliseconds frameAlloc{ 0 };
+    Milliseconds frameReset{ 0 };
+    for( uint32_t frame = 0; frame < frames; frame++ )
+    {
+        Clock::time_point start = Clock::now();
+        allocator.beginFrame( frame % FramesInFlight() );
+        Clock::time_point reset = Clock::now();
+
+        for( uint32_t i = 0; i < sets; i++ )
+        {
+            writeSet( allocator.allocate( setLayout ), i );
+        }
+
+        frameReset += reset - start;
+        frameAlloc += Clock::now() - reset;
+    }
+
+    const DescriptorAllocator::Stats& after = allocator.stats();
+
+    const double total = static_cast< double >( sets ) * frames;
+    std::cout << sets << " sets per frame, " << frames << " frames, 1 uniform + 2 storage buffers per set" << std::endl;
+    std::cout << "  allocate/free per set:  alloc+write " << perSetAlloc.count() / frames << " ms/frame (" << perSetAlloc.count() * 1000.0 / total
+        << " us per set), free " << perSetFree.count() / frames << " ms/frame" << std::endl;
+    std::cout << "  DescriptorAllocator:    alloc+write " << frameAlloc.count() / frames << " ms/frame (" << frameAlloc.count() * 1000.0 / total
+        << " us per set), reset " << frameReset.count() / frames << " ms/frame, "
+        << after.poolsCreated - before.poolsCreated << " pools created, " << after.poolResets - before.poolResets << " pool resets" << std::endl;
+
+    destroyBuffer( buffer, allocation );
+}
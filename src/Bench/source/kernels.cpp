@@ -0,0 +1,459 @@
+#include <bench.h>
+
+// Runs SAXPY, a sum reduction and an exclusive prefix scan on the compute queue over 1M to
+// 256M elements and reports GB/s from GPU timestamps. Bytes counted per element:
+// SAXPY 12 (read x and y, write y), reduction 4, scan 16 (the block pass and the add pass
+// each read and write every value). Each kernel is checked against the expected result.
+namespace
+{
+    const uint32_t GROUP_SIZE = 256;
+    const uint32_t REDUCE_BLOCK = GROUP_SIZE * 8;
+    const uint32_t SCAN_BLOCK = GROUP_SIZE * 4;
+    const float SAXPY_A = 2.0f;
+
+    // Push constants shared by all kernels
+    struct KernelParams
+    {
+        uint32_t count;
+        float a;
+    };
+
+    struct Level
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        Allocation allocation;
+        uint32_t count = 0;
+    };
+
+    float asFloat( uint32_t bits )
+    {
+        float value;
+        memcpy( &value, &bits, sizeof( value ) );
+        return value;
+    }
+}
+
+void Bench::computeBenchmark()
+{
+    const uint32_t minElements = std::max( argValue( "--min-m", 1 ), 1u );
+    const uint32_t maxElements = argValue( "--max-m", 256 );
+    const uint32_t iterations = std::max( argValue( "--iterations", 10 ), 1u );
+
+    // Element counts are 32-bit, 4096M would wrap to 0
+    if( maxElements >= 4096 )
+    {
+        throw std::runtime_error( "--max-m must be below 4096" );
+    }
+
+    VkDevice device = GetDevice();
+
+    const VkPhysicalDeviceProperties& properties = GetDeviceSnapshot().properties;
+    const std::vector<VkQueueFamilyProperties>& queueFamilies = GetDeviceSnapshot().queueFamilies;
+
+    const uint32_t family = GetComputeFamily();
+    const bool timestamps = queueFamilies[family].timestampValidBits != 0;
+    const uint64_t timestampMask = queueFamilies[family].timestampValidBits >= 64 ? ~0ull : ( 1ull << queueFamilies[family].timestampValidBits ) - 1;
+
+    std::cout << "Compute queue family " << family << ( queueFamilies[family].queueFlags & VK_QUEUE_GRAPHICS_BIT ? " (shared with graphics)" : " (async compute)" )
+        << ", " << iterations << " iterations, " << ( timestamps ? "GPU timestamps" : "CPU timing" ) << std::endl;
+
+    // Pipelines: one set of two storage buffers and KernelParams for every kernel
+    std::vector<VkDescriptorSetLayoutBinding> bindings( 2 );
+    for( uint32_t i = 0; i < bindings.size(); i++ )
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayout setLayout = GetDescriptorLayouts().getSetLayout( bindings );
+
+    // All four kernels get the same layout from the cache
+    const char* kernelNames[] = { "saxpy", "reduce", "scan", "scan_add" };
+    VkPipelineLayout pipelineLayout;
+    std::array<VkPipeline, 4> pipelines;
+    for( size_t i = 0; i < pipelines.size(); i++ )
+    {
+        pipelines[i] = createComputePipeline( std::string( SPIRV_DIR ) + "/" + kernelNames[i] + ".comp.spv", 1, &setLayout,
+            sizeof( KernelParams ), pipelineLayout );
+    }
+    VkPipeline saxpyPipeline = pipelines[0];
+    VkPipeline reducePipeline = pipelines[1];
+    VkPipeline scanPipeline = pipelines[2];
+    VkPipeline scanAddPipeline = pipelines[3];
+
+    // Command buffer, fence and queries on the compute family
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = family;
+
+    VkCommandPool commandPool;
+    if( vkCreateCommandPool( device, &poolInfo, nullptr, &commandPool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create command pool!" );
+    }
+
+    VkCommandBufferAllocateInfo commandBufferInfo{};
+    commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferInfo.commandPool = commandPool;
+    commandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    VkFence fence;
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if( vkAllocateCommandBuffers( device, &commandBufferInfo, &commandBuffer ) != VK_SUCCESS ||
+        vkCreateFence( device, &fenceInfo, nullptr, &fence ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create compute command buffer" );
+    }
+
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    if( timestamps )
+    {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = 2;
+
+        if( vkCreateQueryPool( device, &queryPoolInfo, nullptr, &queryPool ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create timestamp query pool!" );
+        }
+    }
+
+    VkBuffer readback;
+    Allocation readbackAllocation;
+    createBuffer( sizeof( uint32_t ), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readback, readbackAllocation );
+
+    // Records, submits and waits; returns the CPU time from submit to fence
+    auto submit = [&]( const std::function<void( VkCommandBuffer )>& record )
+    {
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkResetCommandBuffer( commandBuffer, 0 );
+        vkBeginCommandBuffer( commandBuffer, &beginInfo );
+        record( commandBuffer );
+        if( vkEndCommandBuffer( commandBuffer ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to end compute command buffer" );
+        }
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        TimingStats::Clock::time_point start = TimingStats::Clock::now();
+        vkResetFences( device, 1, &fence );
+        if( vkQueueSubmit( GetComputeQueue(), 1, &submitInfo, fence ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to submit to Compute Queue." );
+        }
+        vkWaitForFences( device, 1, &fence, VK_TRUE, UINT64_MAX );
+        return std::chrono::duration<double, std::milli>( TimingStats::Clock::now() - start ).count();
+    };
+
+    // Descriptor sets are allocated per size and freed with the pool
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    DescriptorWriter writer;
+
+    auto bindBuffers = [&]( VkBuffer first, VkBuffer second )
+    {
+        VkDescriptorSetAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateInfo.descriptorPool = descriptorPool;
+        allocateInfo.descriptorSetCount = 1;
+        allocateInfo.pSetLayouts = &setLayout;
+
+        VkDescriptorSet set;
+        if( vkAllocateDescriptorSets( device, &allocateInfo, &set ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to allocate descriptor set!" );
+        }
+
+        writer.writeBuffer( 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, first )
+            .writeBuffer( 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, second )
+            .update( device, set );
+
+        return set;
+    };
+
+    auto recordKernel = [&]( VkCommandBuffer cmd, VkPipeline pipeline, VkDescriptorSet set, uint32_t count, uint32_t block )
+    {
+        KernelParams params = { count, SAXPY_A };
+
+        vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline );
+        vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &set, 0, nullptr );
+        vkCmdPushConstants( cmd, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( params ), &params );
+        dispatch( cmd, ( static_cast< uint64_t >( count ) + block - 1 ) / block );
+    };
+
+    auto createLevel = [&]( uint32_t count )
+    {
+        Level level;
+        level.count = count;
+        createBuffer( static_cast< VkDeviceSize >( count ) * sizeof( uint32_t ),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, level.buffer, level.allocation );
+        return level;
+    };
+
+    // Buffers of count, count / block, count / block^2 ... elements down to a single value
+    auto createLevels = [&]( uint32_t count, uint32_t block )
+    {
+        std::vector<Level> levels;
+        levels.push_back( createLevel( count ) );
+        while( count > 1 )
+        {
+            count = ( count + block - 1 ) / block;
+            levels.push_back( createLevel( count ) );
+        }
+        return levels;
+    };
+
+    auto destroyLevels = [&]( std::vector<Level>& levels )
+    {
+        for( auto& level : levels )
+        {
+            destroyBuffer( level.buffer, level.allocation );
+        }
+        levels.clear();
+    };
+
+    // Timed as one submission of warm-up plus iterations, between two timestamps
+    auto measure = [&]( const std::function<void( VkCommandBuffer )>& fill, const std::function<void( VkCommandBuffer )>& kernel )
+    {
+        double cpuTime = submit( [&]( VkCommandBuffer cmd )
+        {
+            fill( cmd );
+
+            VkMemoryBarrier fillBarrier{};
+            fillBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            fillBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            fillBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier( cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &fillBarrier, 0, nullptr, 0, nullptr );
+
+            kernel( cmd );
+            RecordComputeBarrier( cmd );
+
+            if( timestamps )
+            {
+                vkCmdResetQueryPool( cmd, queryPool, 0, 2 );
+                vkCmdWriteTimestamp( cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, queryPool, 0 );
+            }
+
+            for( uint32_t i = 0; i < iterations; i++ )
+            {
+                kernel( cmd );
+                RecordComputeBarrier( cmd );
+            }
+
+            if( timestamps )
+            {
+                vkCmdWriteTimestamp( cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, queryPool, 1 );
+            }
+        } );
+
+        if( !timestamps )
+        {
+            return cpuTime / ( iterations + 1 );
+        }
+
+        uint64_t results[2];
+        vkGetQueryPoolResults( device, queryPool, 0, 2, sizeof( results ), results, sizeof( uint64_t ), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT );
+        return ( ( results[1] - results[0] ) & timestampMask ) * properties.limits.timestampPeriod / 1e6 / iterations;
+    };
+
+    // Runs kernel once on freshly filled buffers and reads back one 32-bit value
+    auto verify = [&]( const std::function<void( VkCommandBuffer )>& fill, const std::function<void( VkCommandBuffer )>& kernel,
+        VkBuffer result, VkDeviceSize offset )
+    {
+        submit( [&]( VkCommandBuffer cmd )
+        {
+            fill( cmd );
+
+            VkMemoryBarrier fillBarrier{};
+            fillBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            fillBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            fillBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier( cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &fillBarrier, 0, nullptr, 0, nullptr );
+
+            kernel( cmd );
+
+            VkMemoryBarrier readBarrier{};
+            readBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            readBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            readBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier( cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &readBarrier, 0, nullptr, 0, nullptr );
+
+            VkBufferCopy region{};
+            region.srcOffset = offset;
+            region.size = sizeof( uint32_t );
+            vkCmdCopyBuffer( cmd, result, readback, 1, &region );
+        } );
+
+        return *static_cast< const uint32_t* >( readbackAllocation.mapped );
+    };
+
+    auto report = [&]( const char* name, uint32_t count, double bytesPerElement, double milliseconds, bool correct )
+    {
+        std::cout << "  " << name << ": " << milliseconds << " ms, " << count * bytesPerElement / ( milliseconds * 1e6 ) << " GB/s"
+            << ( correct ? "" : " WRONG RESULT" ) << std::endl;
+    };
+
+    const uint32_t ONE_FLOAT = 0x3f800000;
+
+    for( uint64_t millions = minElements; millions <= maxElements; millions *= 4 )
+    {
+        const uint32_t count = static_cast< uint32_t >( millions * 1024 * 1024 );
+        const VkDeviceSize size = static_cast< VkDeviceSize >( count ) * sizeof( float );
+
+        std::cout << millions << "M elements (" << size / ( 1024 * 1024 ) << " MB per buffer)" << std::endl;
+
+        if( size > properties.limits.maxStorageBufferRange )
+        {
+            std::cout << "  skipped, larger than maxStorageBufferRange" << std::endl;
+            continue;
+        }
+
+        VkDescriptorPoolSize poolSize{};
+        poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSize.descriptorCount = 64;
+
+        VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+        descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        descriptorPoolInfo.maxSets = 32;
+        descriptorPoolInfo.poolSizeCount = 1;
+        descriptorPoolInfo.pPoolSizes = &poolSize;
+
+        if( vkCreateDescriptorPool( device, &descriptorPoolInfo, nullptr, &descriptorPool ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create descriptor pool!" );
+        }
+
+        std::vector<Level> levels;
+
+        try
+        {
+            // SAXPY, y = 2x + y with x = y = 1
+            levels.push_back( createLevel( count ) );
+            levels.push_back( createLevel( count ) );
+            {
+                VkBuffer x = levels[0].buffer;
+                VkBuffer y = levels[1].buffer;
+                VkDescriptorSet set = bindBuffers( x, y );
+
+                auto fill = [&]( VkCommandBuffer cmd )
+                {
+                    vkCmdFillBuffer( cmd, x, 0, VK_WHOLE_SIZE, ONE_FLOAT );
+                    vkCmdFillBuffer( cmd, y, 0, VK_WHOLE_SIZE, ONE_FLOAT );
+                };
+                auto kernel = [&]( VkCommandBuffer cmd )
+                {
+                    recordKernel( cmd, saxpyPipeline, set, count, GROUP_SIZE );
+                };
+
+                double time = measure( fill, kernel );
+                report( "saxpy ", count, 12.0, time, asFloat( verify( fill, kernel, y, size - sizeof( float ) ) ) == SAXPY_A + 1.0f );
+            }
+            destroyLevels( levels );
+
+            // Sum of count ones, exact in float since every partial sum is a multiple of REDUCE_BLOCK
+            levels = createLevels( count, REDUCE_BLOCK );
+            {
+                std::vector<VkDescriptorSet> sets;
+                for( size_t i = 0; i + 1 < levels.size(); i++ )
+                {
+                    sets.push_back( bindBuffers( levels[i].buffer, levels[i + 1].buffer ) );
+                }
+
+                auto fill = [&]( VkCommandBuffer cmd )
+                {
+                    vkCmdFillBuffer( cmd, levels[0].buffer, 0, VK_WHOLE_SIZE, ONE_FLOAT );
+                };
+                auto kernel = [&]( VkCommandBuffer cmd )
+                {
+                    for( size_t i = 0; i < sets.size(); i++ )
+                    {
+                        if( i > 0 )
+                        {
+                            RecordComputeBarrier( cmd );
+                        }
+                        recordKernel( cmd, reducePipeline, sets[i], levels[i].count, REDUCE_BLOCK );
+                    }
+                };
+
+                double time = measure( fill, kernel );
+                report( "reduce", count, 4.0, time, asFloat( verify( fill, kernel, levels.back().buffer, 0 ) ) == static_cast< float >( count ) );
+            }
+            destroyLevels( levels );
+
+            // Exclusive scan of count ones, the last value is count - 1
+            levels = createLevels( count, SCAN_BLOCK );
+            {
+                std::vector<VkDescriptorSet> sets;
+                for( size_t i = 0; i + 1 < levels.size(); i++ )
+                {
+                    sets.push_back( bindBuffers( levels[i].buffer, levels[i + 1].buffer ) );
+                }
+
+                auto fill = [&]( VkCommandBuffer cmd )
+                {
+                    vkCmdFillBuffer( cmd, levels[0].buffer, 0, VK_WHOLE_SIZE, 1 );
+                };
+                auto kernel = [&]( VkCommandBuffer cmd )
+                {
+                    // Scan down to a single block, then add each level's offsets back up
+                    for( size_t i = 0; i < sets.size(); i++ )
+                    {
+                        if( i > 0 )
+                        {
+                            RecordComputeBarrier( cmd );
+                        }
+                        recordKernel( cmd, scanPipeline, sets[i], levels[i].count, SCAN_BLOCK );
+                    }
+                    for( size_t i = sets.size() - 1; i-- > 0; )
+                    {
+                        RecordComputeBarrier( cmd );
+                        recordKernel( cmd, scanAddPipeline, sets[i], levels[i].count, SCAN_BLOCK );
+                    }
+                };
+
+                double time = measure( fill, kernel );
+                report( "scan  ", count, 16.0, time, verify( fill, kernel, levels[0].buffer, size - sizeof( uint32_t ) ) == count - 1 );
+            }
+            destroyLevels( levels );
+        }
+        catch( const std::exception& e )
+        {
+            // Most likely out of device memory at the largest sizes
+            vkDeviceWaitIdle( device );
+            destroyLevels( levels );
+            std::cout << "  stopped: " << e.what() << std::endl;
+            vkDestroyDescriptorPool( device, descriptorPool, nullptr );
+            break;
+        }
+
+        vkDestroyDescriptorPool( device, descriptorPool, nullptr );
+    }
+
+    destroyBuffer( readback, readbackAllocation );
+    if( queryPool != VK_NULL_HANDLE )
+    {
+        vkDestroyQueryPool( device, queryPool, nullptr );
+    }
+    vkDestroyFence( device, fence, nullptr );
+    vkDestroyCommandPool( device, commandPool, nullptr );
+    for( size_t i = 0; i < pipelines.size(); i++ )
+    {
+        vkDestroyPipeline( device, pipelines[i], nullptr );
+    }
+}
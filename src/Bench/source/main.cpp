@@ -0,0 +1,113 @@
+#include <bench.h>
+
+Bench::Bench( const std::vector<std::string>& args ) :
+    core( "Bench" ),
+    m_args( args )
+{
+    EnableHeadless( 800, 600, 0 );
+    ParseCommandLine( args );
+}
+
+bool Bench::hasArg( const std::string& name ) const
+{
+    return std::find( m_args.begin(), m_args.end(), name ) != m_args.end();
+}
+
+uint32_t Bench::argValue( const std::string& name, uint32_t defaultValue ) const
+{
+    return ArgValue( m_args, name, defaultValue );
+}
+
+void Bench::initDevice()
+{
+    createInstance();
+    pickPhysicalDevice();
+    createLogicalDevice();
+
+    std::cout << "Device: " << GetDeviceSnapshot().properties.deviceName << std::endl;
+}
+
+// Offscreen targets, render pass and a vertex-buffer-free pipeline for benchmarks that draw
+void Bench::initRendering()
+{
+    createSwapchain( nullptr );
+    createImageViews();
+    createRenderPass();
+    createGraphicsPipeline( std::string( SPIRV_DIR ) + "/bench.vert.spv", std::string( SPIRV_DIR ) + "/bench.frag.spv" );
+    createFramebuffers();
+    createCommandPool();
+    createCommandBuffer();
+    createSyncObjects();
+}
+
+void Bench::run()
+{
+    const std::string benchmark = m_args.empty() ? "" : m_args[0];
+
+    if( benchmark == "memory" )
+    {
+        initDevice();
+        memoryBenchmark();
+    }
+    else if( benchmark == "upload" )
+    {
+        initDevice();
+        uploadBenchmark();
+    }
+    else if( benchmark == "record" )
+    {
+        initDevice();
+        initRendering();
+        recordBenchmark();
+    }
+    else if( benchmark == "compute" )
+    {
+        initDevice();
+        computeBenchmark();
+    }
+    else if( benchmark == "descriptors" )
+    {
+        initDevice();
+        descriptorBenchmark();
+    }
+    else if( benchmark == "pipelines" )
+    {
+        initDevice();
+        initRendering();
+        pipelineBenchmark();
+    }
+    else if( benchmark == "specialization" )
+    {
+        initDevice();
+        initRendering();
+        specializationBenchmark();
+    }
+    else if( benchmark == "vertices" )
+    {
+        initDevice();
+        initRendering();
+        vertexBenchmark();
+    }
+    else
+    {
+        throw std::runtime_error( "Usage: Bench memory [--count N] | upload [--mb N] [--chunk-kb N] | record [--draws N] [--iterations N] [--threads N] | compute [--min-m N] [--max-m N] [--iterations N] | descriptors [--sets N] [--frames N] | pipelines [--count N] [--threads N] | specialization [--iterations N] [--draws N] [--frames N] | vertices [--vertices N] [--frames N]" );
+    }
+
+    cleanup();
+}
+
+int main( int argc, char** argv )
+{
+    try
+    {
+        Bench bench( std::vector<std::string>( argv + 1, argv + argc ) );
+        bench.run();
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+#include <bench.h>
+
+#include <random>
+
+// Creates and destroys N small vertex buffers, once with a vkAllocateMemory per buffer and
+// once through core's DeviceAllocator.
+void Bench::memoryBenchmark()
+{
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    const uint32_t count = argValue( "--count", 100000 );
+
+    const VkPhysicalDeviceProperties& properties = GetDeviceSnapshot().properties;
+
+    // The per-buffer path cannot keep more than maxMemoryAllocationCount buffers alive at once
+    const uint32_t batch = std::min( count, properties.limits.maxMemoryAllocationCount - 64 );
+
+    std::mt19937 random( 1 );
+    std::uniform_int_distribution<uint32_t> sizeDistribution( 256, 64 * 1024 );
+    std::vector<VkDeviceSize> sizes( count );
+    for( auto& size : sizes )
+    {
+        size = sizeDistribution( random );
+    }
+
+    auto createBufferHandle = [this]( VkDeviceSize size )
+    {
+        VkBufferCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        createInfo.size = size;
+        createInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkBuffer buffer;
+        if( vkCreateBuffer( GetDevice(), &createInfo, nullptr, &buffer ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Error while creating buffer" );
+        }
+        return buffer;
+    };
+
+    std::vector<VkBuffer> buffers( count );
+
+    // Old path: one VkDeviceMemory per buffer
+    Milliseconds dedicatedAlloc{ 0 };
+    Milliseconds dedicatedFree{ 0 };
+    std::vector<VkDeviceMemory> memories( batch );
+
+    for( uint32_t first = 0; first < count; first += batch )
+    {
+        const uint32_t batchCount = std::min( batch, count - first );
+
+        Clock::time_point start = Clock::now();
+        for( uint32_t i = 0; i < batchCount; i++ )
+        {
+            buffers[i] = createBufferHandle( sizes[first + i] );
+
+            VkMemoryRequirements memoryRequirements;
+            vkGetBufferMemoryRequirements( GetDevice(), buffers[i], &memoryRequirements );
+
+            VkMemoryAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = memoryRequirements.size;
+            allocInfo.memoryTypeIndex = GetAllocator().findMemoryType( memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+
+            if( vkAllocateMemory( GetDevice(), &allocInfo, nullptr, &memories[i] ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Error while allocating memory for buffer " + std::to_string( first + i ) );
+            }
+
+            vkBindBufferMemory( GetDevice(), buffers[i], memories[i], 0 );
+        }
+        Clock::time_point allocated = Clock::now();
+
+        for( uint32_t i = 0; i < batchCount; i++ )
+        {
+            vkDestroyBuffer( GetDevice(), buffers[i], nullptr );
+            vkFreeMemory( GetDevice(), memories[i], nullptr );
+        }
+
+        dedicatedAlloc += allocated - start;
+        dedicatedFree += Clock::now() - allocated;
+    }
+
+    // New path: every buffer alive at once, sub-allocated from shared blocks
+    std::vector<Allocation> allocations( count );
+    const uint64_t blocksBefore = GetAllocator().deviceAllocationCount();
+
+    Clock::time_point start = Clock::now();
+    for( uint32_t i = 0; i < count; i++ )
+    {
+        buffers[i] = createBufferHandle( sizes[i] );
+
+        VkMemoryRequirements memoryRequirements;
+        vkGetBufferMemoryRequirements( GetDevice(), buffers[i], &memoryRequirements );
+
+        allocations[i] = GetAllocator().allocate( memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+        vkBindBufferMemory( GetDevice(), buffers[i], allocations[i].memory, allocations[i].offset );
+    }
+    Clock::time_point allocated = Clock::now();
+
+    const uint64_t blocksUsed = GetAllocator().deviceAllocationCount() - blocksBefore;
+
+    // Free in a scrambled order so coalescing is exercised
+    std::vector<uint32_t> order( count );
+    for( uint32_t i = 0; i < count; i++ )
+    {
+        order[i] = i;
+    }
+    std::shuffle( order.begin(), order.end(), random );
+
+    Clock::time_point freeStart = Clock::now();
+    for( uint32_t i : order )
+    {
+        vkDestroyBuffer( GetDevice(), buffers[i], nullptr );
+        GetAllocator().free( allocations[i] );
+    }
+
+    Milliseconds subAlloc = allocated - start;
+    Milliseconds subFree = Clock::now() - freeStart;
+
+    std::cout << count << " buffers, 256B-64KB" << std::endl;
+    std::cout << "  vkAllocateMemory per buffer: alloc " << dedicatedAlloc.count() << " ms (" << dedicatedAlloc.count() * 1000.0 / count
+        << " us each), free " << dedicatedFree.count() << " ms, " << count << " device allocations in batches of " << batch << std::endl;
+    std::cout << "  DeviceAllocator:             alloc " << subAlloc.count() << " ms (" << subAlloc.count() * 1000.0 / count
+        << " us each), free " << subFree.count() << " ms, " << blocksUsed << " device allocations, all buffers live" << std::endl;
+}
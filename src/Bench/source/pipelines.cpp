@@ -0,0 +1,114 @@
+#include <bench.h>
+
+// Compiles N graphics pipeline permutations one after the other and on 2, 4 ... --threads
+// workers through a PipelineCompiler. No pipeline cache is used, so every step compiles every
+// pipeline from scratch; drivers with their own shader cache (Mesa's disk cache) should have it
+// disabled, e.g. MESA_SHADER_CACHE_DISABLE=true. With --pipeline-library the same descriptions
+// are then built from graphics pipeline library parts and linked, fast and optimized, one by one.
+void Bench::pipelineBenchmark()
+{
+    const uint32_t count = std::max( argValue( "--count", 256 ), 1u );
+
+    const VkPrimitiveTopology topologies[] = { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP };
+    const VkCullModeFlags cullModes[] = { VK_CULL_MODE_NONE, VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_FRONT_BIT };
+    const VkFrontFace frontFaces[] = { VK_FRONT_FACE_CLOCKWISE, VK_FRONT_FACE_COUNTER_CLOCKWISE };
+
+    // The state permutations repeat after 24, an unused vertex binding of growing stride keeps
+    // the descriptions distinct beyond that
+    std::vector<GraphicsPipelineDesc> descs( count );
+    for( uint32_t i = 0; i < count; i++ )
+    {
+        GraphicsPipelineDesc& desc = descs[i];
+        desc.vertSpv = std::string( SPIRV_DIR ) + "/bench.vert.spv";
+        desc.fragSpv = std::string( SPIRV_DIR ) + "/bench.frag.spv";
+        desc.topology = topologies[i % 2];
+        desc.cullMode = cullModes[( i / 2 ) % 3];
+        desc.frontFace = frontFaces[( i / 6 ) % 2];
+        desc.blendEnable = ( i / 12 ) % 2 == 1;
+        desc.layout = GetPipelineLayout();
+
+        if( i >= 24 )
+        {
+            desc.vertexBindings.push_back( { 0, 16 + 4 * ( i / 24 ), VK_VERTEX_INPUT_RATE_VERTEX } );
+        }
+    }
+
+    const PipelineTarget target = GetPipelineTarget();
+
+    PipelineCompiler compiler;
+    compiler.init( GetDevice(), VK_NULL_HANDLE, GetShaderModules() );
+
+    std::vector<uint32_t> steps = { 1 };
+    for( uint32_t threads = 2; threads < WorkerThreads(); threads *= 2 )
+    {
+        steps.push_back( threads );
+    }
+    if( WorkerThreads() > 1 )
+    {
+        steps.push_back( WorkerThreads() );
+    }
+
+    std::cout << count << " pipeline permutations, no pipeline cache" << std::endl;
+
+    double serialWall = 0.0;
+    double serialCompile = 0.0;
+    for( uint32_t threads : steps )
+    {
+        std::unique_ptr<ThreadPool> pool;
+        if( threads > 1 )
+        {
+            pool = std::make_unique<ThreadPool>( threads );
+        }
+
+        PipelineCompiler::BatchStats stats;
+        std::vector<VkPipeline> pipelines = compiler.compileBatch( descs, target, pool.get(), stats );
+        if( threads == 1 )
+        {
+            serialWall = stats.wallMs;
+            serialCompile = stats.compileMs;
+        }
+
+        std::cout << "  " << threads << " thread(s): " << stats.wallMs << " ms wall, " << stats.compileMs << " ms summed compile ("
+            << stats.compileMs / std::max( stats.wallMs, 0.001 ) << "x overlap), slowest " << stats.slowestMs << " ms, "
+            << serialWall / std::max( stats.wallMs, 0.001 ) << "x vs serial, " << count * 1000.0 / std::max( stats.wallMs, 0.001 ) << " pipelines/s" << std::endl;
+
+        for( VkPipeline pipeline : pipelines )
+        {
+            vkDestroyPipeline( GetDevice(), pipeline, nullptr );
+        }
+    }
+
+    if( !IsPipelineLibraryEnabled() )
+    {
+        return;
+    }
+
+    PipelineCompiler libraryCompiler;
+    libraryCompiler.init( GetDevice(), VK_NULL_HANDLE, GetShaderModules() );
+    libraryCompiler.useLibraries();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    libraryCompiler.precompileLibraries( descs, target, &GetThreadPool() );
+    const double partsWall = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+
+    for( bool optimize : { false, true } )
+    {
+        for( const auto& desc : descs )
+        {
+            vkDestroyPipeline( GetDevice(), libraryCompiler.link( desc, target, optimize ), nullptr );
+        }
+    }
+
+    const PipelineCompiler::LibraryStats stats = libraryCompiler.libraryStats();
+    const double fullCompile = serialCompile / count;
+    const double fastLink = stats.fastLinkMs / std::max( stats.fastLinks, 1u );
+    const double optimizedLink = stats.optimizedLinkMs / std::max( stats.optimizedLinks, 1u );
+
+    std::cout << "  libraries: " << stats.parts << " parts in " << partsWall << " ms wall on " << WorkerThreads() << " thread(s), "
+        << stats.partCompileMs << " ms summed" << std::endl;
+    std::cout << "  fast link:      " << fastLink << " ms per pipeline vs " << fullCompile << " ms full compile ("
+        << fullCompile / std::max( fastLink, 0.001 ) << "x)" << std::endl;
+    std::cout << "  optimized link: " << optimizedLink << " ms per pipeline (" << fullCompile / std::max( optimizedLink, 0.001 ) << "x)" << std::endl;
+
+    libraryCompiler.destroy();
+}
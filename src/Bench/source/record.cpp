@@ -0,0 +1,76 @@
+#include <bench.h>
+
+// Records N draws per frame inline on one thread, then through recordParallel with 1, 2, 4 ...
+// up to the worker count, and reports the median CPU recording time of each.
+void Bench::recordBenchmark()
+{
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    const uint32_t draws = argValue( "--draws", 100000 );
+    const uint32_t iterations = std::max( argValue( "--iterations", 20 ), 1u );
+
+    auto recordDraws = []( VkCommandBuffer commandBuffer, uint32_t first, uint32_t count )
+    {
+        for( uint32_t i = first; i < first + count; i++ )
+        {
+            vkCmdDraw( commandBuffer, 3, 1, 0, i );
+        }
+    };
+
+    // threads == 0 records inline into the primary command buffer
+    auto measure = [&]( uint32_t threads )
+    {
+        std::vector<double> samples;
+
+        for( uint32_t i = 0; i < iterations; i++ )
+        {
+            uint32_t imageIndex = drawFrameProlog();
+            recordCommandBufferProlog( imageIndex, threads == 0 ? VK_SUBPASS_CONTENTS_INLINE : VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS );
+
+            Clock::time_point start = Clock::now();
+            if( threads == 0 )
+            {
+                recordDraws( GetCommandBuffer(), 0, draws );
+            }
+            else
+            {
+                recordParallel( draws, recordDraws, threads );
+            }
+            samples.push_back( Milliseconds( Clock::now() - start ).count() );
+
+            recordCommandBufferEpilog();
+            drawFrameEpilog( imageIndex );
+        }
+
+        std::sort( samples.begin(), samples.end() );
+        return samples[samples.size() / 2];
+    };
+
+    std::cout << draws << " draws per frame, median of " << iterations << " frames" << std::endl;
+
+    const double inlineTime = measure( 0 );
+    std::cout << "  inline primary:  " << inlineTime << " ms" << std::endl;
+
+    std::vector<uint32_t> steps;
+    for( uint32_t threads = 1; threads < WorkerThreads(); threads *= 2 )
+    {
+        steps.push_back( threads );
+    }
+    steps.push_back( WorkerThreads() );
+
+    double oneThread = 0.0;
+    for( uint32_t threads : steps )
+    {
+        const double time = measure( threads );
+        if( threads == 1 )
+        {
+            oneThread = time;
+        }
+
+        std::cout << "  " << threads << " thread(s):     " << time << " ms, " << draws / time << " draws/ms, "
+            << oneThread / time << "x" << std::endl;
+    }
+
+    vkDeviceWaitIdle( GetDevice() );
+}
@@ -0,0 +1,126 @@
+#include <bench.h>
+
+// Renders the same fullscreen workload with spec.frag reading its loop count and body from
+// push constants, then with both specialized into the pipeline, for a few loop counts and
+// bodies, and reports the median GPU time of each. The specialized pipelines come from the
+// variant cache, so asking for one twice compiles it once.
+namespace
+{
+    struct SpecParams
+    {
+        uint32_t iterations;
+        uint32_t mode;
+    };
+}
+
+void Bench::specializationBenchmark()
+{
+    const uint32_t frames = std::max( argValue( "--frames", 50 ), 1u );
+    const uint32_t draws = std::max( argValue( "--draws", 4 ), 1u );
+    const uint32_t maxIterations = std::max( argValue( "--iterations", 64 ), 1u );
+
+    GpuTimer& gpuTimer = GetGpuTimer();
+    if( !gpuTimer.isSupported() )
+    {
+        std::cout << "The graphics queue has no timestamps, nothing to measure" << std::endl;
+        return;
+    }
+
+    VkPipelineLayout layout = GetDescriptorLayouts().getPipelineLayout( {}, { { VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof( SpecParams ) } } );
+
+    GraphicsPipelineDesc uniformDesc;
+    uniformDesc.vertSpv = std::string( SPIRV_DIR ) + "/fullscreen.vert.spv";
+    uniformDesc.fragSpv = std::string( SPIRV_DIR ) + "/spec.frag.spv";
+    uniformDesc.cullMode = VK_CULL_MODE_NONE;
+    uniformDesc.layout = layout;
+    VkPipeline uniformPipeline = GetPipelineVariant( uniformDesc );
+
+    std::vector<uint32_t> iterationSteps;
+    for( uint32_t iterations = std::min( 4u, maxIterations ); iterations < maxIterations; iterations *= 4 )
+    {
+        iterationSteps.push_back( iterations );
+
+        // The next step would wrap around before reaching maxIterations
+        if( iterations > maxIterations / 4 )
+        {
+            break;
+        }
+    }
+    iterationSteps.push_back( maxIterations );
+
+    auto render = [&]( VkPipeline pipeline, const SpecParams& params, uint32_t scope )
+    {
+        for( uint32_t i = 0; i < frames; i++ )
+        {
+            uint32_t imageIndex = drawFrameProlog();
+            recordCommandBufferProlog( imageIndex );
+
+            VkCommandBuffer commandBuffer = GetCommandBuffer();
+            vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
+            vkCmdPushConstants( commandBuffer, layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof( params ), &params );
+            {
+                GpuScope gpuScope( gpuTimer, commandBuffer, scope );
+                for( uint32_t draw = 0; draw < draws; draw++ )
+                {
+                    vkCmdDraw( commandBuffer, 3, 1, 0, 0 );
+                }
+            }
+
+            recordCommandBufferEpilog();
+            drawFrameEpilog( imageIndex );
+        }
+    };
+
+    struct Case
+    {
+        SpecParams params;
+        std::string uniformSeries;
+        std::string specializedSeries;
+    };
+    std::vector<Case> cases;
+
+    for( uint32_t iterations : iterationSteps )
+    {
+        for( uint32_t mode = 1; mode <= 3; mode++ )
+        {
+            Case test;
+            test.params = { iterations, mode };
+            const std::string name = "spec_i" + std::to_string( iterations ) + "_m" + std::to_string( mode );
+            test.uniformSeries = name + "_uniform";
+            test.specializedSeries = name + "_specialized";
+
+            GraphicsPipelineDesc specializedDesc = uniformDesc;
+            specializedDesc.fragConstants.setUint( 0, iterations ).setUint( 1, mode );
+            VkPipeline specializedPipeline = GetPipelineVariant( specializedDesc );
+
+            render( uniformPipeline, test.params, gpuTimer.registerScope( test.uniformSeries ) );
+            // The push constants must not matter here; zeros would stop the loop if they did
+            render( specializedPipeline, { 0, 0 }, gpuTimer.registerScope( test.specializedSeries ) );
+
+            cases.push_back( test );
+        }
+    }
+
+    // Timestamps are collected when a frame slot comes around again
+    for( uint32_t i = 0; i < FramesInFlight(); i++ )
+    {
+        uint32_t imageIndex = drawFrameProlog();
+        recordCommandBufferProlog( imageIndex );
+        recordCommandBufferEpilog();
+        drawFrameEpilog( imageIndex );
+    }
+    vkDeviceWaitIdle( GetDevice() );
+
+    const PipelineCompiler::VariantStats stats = GetPipelineCompiler().variantStats();
+    std::cout << draws << " fullscreen draws per frame, median GPU time of " << frames << " frames, "
+        << stats.variants << " pipeline variants compiled in " << stats.compileMs << " ms" << std::endl;
+
+    for( const Case& test : cases )
+    {
+        const double uniformTime = Timing().summarize( Timing().findSeries( "gpu." + test.uniformSeries ) ).p50;
+        const double specializedTime = Timing().summarize( Timing().findSeries( "gpu." + test.specializedSeries ) ).p50;
+
+        std::cout << "  " << test.params.iterations << " iterations, mode " << test.params.mode << ": uniform " << uniformTime
+            << " ms, specialized " << specializedTime << " ms, " << uniformTime / std::max( specializedTime, 0.0001 ) << "x" << std::endl;
+    }
+}
@@ -0,0 +1,69 @@
+#include <bench.h>
+
+// Writes the same data into a HOST_VISIBLE buffer with memcpy and into a DEVICE_LOCAL buffer
+// through core's staging ring, and reports both as MB/s.
+void Bench::uploadBenchmark()
+{
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    const VkDeviceSize size = static_cast< VkDeviceSize >( std::max( argValue( "--mb", 64 ), 1u ) ) * 1024 * 1024;
+    const VkDeviceSize chunk = static_cast< VkDeviceSize >( std::max( argValue( "--chunk-kb", 64 ), 1u ) ) * 1024;
+    const uint32_t iterations = 10;
+
+    std::vector<uint8_t> source( static_cast< size_t >( size ) );
+    for( size_t i = 0; i < source.size(); i++ )
+    {
+        source[i] = static_cast< uint8_t >( i * 2654435761u >> 24 );
+    }
+
+    VkBuffer hostBuffer;
+    Allocation hostAllocation;
+    createBuffer( size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, hostBuffer, hostAllocation );
+
+    VkBuffer deviceBuffer;
+    Allocation deviceAllocation;
+    createBuffer( size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, deviceBuffer, deviceAllocation );
+
+    auto megabytesPerSecond = [size, iterations]( Milliseconds elapsed )
+    {
+        return size * iterations / ( 1024.0 * 1024.0 ) / ( elapsed.count() / 1000.0 );
+    };
+
+    // Old path: the CPU writes straight into memory the GPU later reads over the bus
+    Clock::time_point start = Clock::now();
+    for( uint32_t i = 0; i < iterations; i++ )
+    {
+        for( VkDeviceSize offset = 0; offset < size; offset += chunk )
+        {
+            memcpy( static_cast< uint8_t* >( hostAllocation.mapped ) + offset, source.data() + offset,
+                static_cast< size_t >( std::min( chunk, size - offset ) ) );
+        }
+    }
+    Milliseconds hostTime = Clock::now() - start;
+
+    // New path: memcpy into the ring, vkCmdCopyBuffer into VRAM, timed until the GPU is done
+    flushUploads();
+    const uint64_t stalls = UploadStalls();
+    start = Clock::now();
+    for( uint32_t i = 0; i < iterations; i++ )
+    {
+        for( VkDeviceSize offset = 0; offset < size; offset += chunk )
+        {
+            uploadBuffer( deviceBuffer, offset, source.data() + offset, std::min( chunk, size - offset ) );
+        }
+    }
+    flushUploads();
+    Milliseconds ringTime = Clock::now() - start;
+
+    std::cout << iterations << " x " << size / ( 1024 * 1024 ) << " MB in " << chunk / 1024 << " KB chunks, "
+        << GetUploadRing().capacity() / ( 1024 * 1024 ) << " MB staging ring" << std::endl;
+    std::cout << "  memcpy to HOST_VISIBLE:        " << megabytesPerSecond( hostTime ) << " MB/s" << std::endl;
+    std::cout << "  staging ring to DEVICE_LOCAL:  " << megabytesPerSecond( ringTime ) << " MB/s, "
+        << UploadStalls() - stalls << " stalls on a full ring" << std::endl;
+
+    destroyBuffer( deviceBuffer, deviceAllocation );
+    destroyBuffer( hostBuffer, hostAllocation );
+}
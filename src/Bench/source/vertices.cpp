@@ -0,0 +1,249 @@
+#include <bench.h>
+
+#include <vertexlayout.h>
+
+// Draws one large non-indexed mesh (no vertex reuse, every vertex fetched once) from device
+// local memory in four layouts: full precision and quantized, each interleaved (AoS) and as
+// one stream per attribute (SoA). Every layout is drawn with all attributes read and with the
+// position alone, as a depth prepass would. Reports the median GPU time and the buffer bytes
+// behind each vertex; the shaders clip everything, so the draws are bound by vertex fetch.
+namespace
+{
+    using FloatInterleaved = VertexLayout<VertexStream<VertexAttribute<0, glm::vec3>, VertexAttribute<1, glm::vec3>, VertexAttribute<2, glm::vec4>>>;
+    using FloatSplit = VertexLayout<VertexStream<VertexAttribute<0, glm::vec3>>, VertexStream<VertexAttribute<1, glm::vec3>>, VertexStream<VertexAttribute<2, glm::vec4>>>;
+    using CompactInterleaved = VertexLayout<VertexStream<VertexAttribute<0, Half4>, VertexAttribute<1, Octahedral16>, VertexAttribute<2, Unorm8x4>>>;
+    using CompactSplit = VertexLayout<VertexStream<VertexAttribute<0, Half4>>, VertexStream<VertexAttribute<1, Octahedral16>>, VertexStream<VertexAttribute<2, Unorm8x4>>>;
+
+    struct Mesh
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec4> colors;
+    };
+
+    struct PackedMesh
+    {
+        std::string name;
+        std::string vertSpv;
+        std::vector<VkVertexInputBindingDescription> bindings;
+        std::vector<VkVertexInputAttributeDescription> attributes;
+        std::vector<std::vector<uint8_t>> streams;
+        // Bytes per vertex the position-only pass pulls in: the whole stride when interleaved
+        uint32_t positionBytes = 0;
+    };
+
+    // Triangles scattered over a unit sphere shell
+    Mesh makeMesh( uint32_t vertexCount )
+    {
+        Mesh mesh;
+        mesh.positions.resize( vertexCount );
+        mesh.normals.resize( vertexCount );
+        mesh.colors.resize( vertexCount );
+
+        for( uint32_t i = 0; i < vertexCount; i++ )
+        {
+            const float theta = i * 2.399963f;
+            const float z = 1.0f - 2.0f * ( i + 0.5f ) / vertexCount;
+            const float radius = std::sqrt( std::max( 1.0f - z * z, 0.0f ) );
+
+            mesh.normals[i] = glm::vec3( radius * std::cos( theta ), radius * std::sin( theta ), z );
+            mesh.positions[i] = mesh.normals[i] * 0.9f;
+            mesh.colors[i] = glm::vec4( ( i % 7 ) / 6.0f, ( i % 11 ) / 10.0f, ( i % 13 ) / 12.0f, 1.0f );
+        }
+
+        return mesh;
+    }
+
+    template<typename Layout>
+    PackedMesh describe( const std::string& name, const std::string& vertSpv, size_t vertexCount )
+    {
+        PackedMesh packed;
+        packed.name = name;
+        packed.vertSpv = vertSpv;
+        packed.bindings.assign( Layout::bindings.begin(), Layout::bindings.end() );
+        packed.attributes.assign( Layout::attributes.begin(), Layout::attributes.end() );
+        packed.positionBytes = Layout::strides[Layout::find( 0 ).binding];
+
+        for( uint32_t stride : Layout::strides )
+        {
+            packed.streams.emplace_back( stride * vertexCount );
+        }
+        return packed;
+    }
+
+    template<typename Layout>
+    PackedMesh packFloat( const std::string& name, const Mesh& mesh )
+    {
+        PackedMesh packed = describe<Layout>( name, std::string( SPIRV_DIR ) + "/mesh_float.vert.spv", mesh.positions.size() );
+
+        std::vector<uint8_t*> streams;
+        for( auto& stream : packed.streams )
+        {
+            streams.push_back( stream.data() );
+        }
+
+        for( size_t i = 0; i < mesh.positions.size(); i++ )
+        {
+            Layout::template write<0>( streams.data(), i, mesh.positions[i] );
+            Layout::template write<1>( streams.data(), i, mesh.normals[i] );
+            Layout::template write<2>( streams.data(), i, mesh.colors[i] );
+        }
+        return packed;
+    }
+
+    template<typename Layout>
+    PackedMesh packCompact( const std::string& name, const Mesh& mesh )
+    {
+        PackedMesh packed = describe<Layout>( name, std::string( SPIRV_DIR ) + "/mesh_compact.vert.spv", mesh.positions.size() );
+
+        std::vector<uint8_t*> streams;
+        for( auto& stream : packed.streams )
+        {
+            streams.push_back( stream.data() );
+        }
+
+        for( size_t i = 0; i < mesh.positions.size(); i++ )
+        {
+            Layout::template write<0>( streams.data(), i, toHalf4( glm::vec4( mesh.positions[i], 1.0f ) ) );
+            Layout::template write<1>( streams.data(), i, toOctahedral( mesh.normals[i] ) );
+            Layout::template write<2>( streams.data(), i, toUnorm8x4( mesh.colors[i] ) );
+        }
+        return packed;
+    }
+}
+
+void Bench::vertexBenchmark()
+{
+    // Whole triangles
+    const uint32_t vertexCount = std::max( argValue( "--vertices", 4 * 1024 * 1024 ) / 3, 1u ) * 3;
+    const uint32_t frames = std::max( argValue( "--frames", 20 ), 1u );
+
+    GpuTimer& gpuTimer = GetGpuTimer();
+    if( !gpuTimer.isSupported() )
+    {
+        std::cout << "The graphics queue has no timestamps, nothing to measure" << std::endl;
+        return;
+    }
+
+    const Mesh mesh = makeMesh( vertexCount );
+
+    // Packed one at a time, so only one copy of the mesh sits in device memory
+    const std::vector<std::function<PackedMesh()>> layouts = {
+        [&] { return packFloat<FloatInterleaved>( "float interleaved", mesh ); },
+        [&] { return packFloat<FloatSplit>( "float split", mesh ); },
+        [&] { return packCompact<CompactInterleaved>( "compact interleaved", mesh ); },
+        [&] { return packCompact<CompactSplit>( "compact split", mesh ); },
+    };
+
+    struct Result
+    {
+        std::string name;
+        uint32_t vertexBytes = 0;
+        uint32_t positionBytes = 0;
+        std::string fullSeries;
+        std::string positionSeries;
+    };
+    std::vector<Result> results;
+
+    for( const auto& pack : layouts )
+    {
+        const PackedMesh packed = pack();
+
+        std::vector<VkBuffer> buffers( packed.streams.size() );
+        std::vector<Allocation> allocations( packed.streams.size() );
+        for( size_t i = 0; i < packed.streams.size(); i++ )
+        {
+            createBuffer( packed.streams[i].size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffers[i], allocations[i] );
+            uploadBuffer( buffers[i], 0, packed.streams[i].data(), packed.streams[i].size() );
+        }
+
+        GraphicsPipelineDesc desc;
+        desc.vertSpv = packed.vertSpv;
+        desc.fragSpv = std::string( SPIRV_DIR ) + "/bench.frag.spv";
+        desc.vertexBindings = packed.bindings;
+        desc.vertexAttributes = packed.attributes;
+        desc.cullMode = VK_CULL_MODE_NONE;
+        VkPipeline fullPipeline = GetPipelineVariant( desc );
+
+        // Same vertex input state; the shader leaves everything but location 0 unread
+        desc.vertSpv = std::string( SPIRV_DIR ) + "/mesh_position.vert.spv";
+        VkPipeline positionPipeline = GetPipelineVariant( desc );
+
+        Result result;
+        result.name = packed.name;
+        result.positionBytes = packed.positionBytes;
+        for( const auto& binding : packed.bindings )
+        {
+            result.vertexBytes += binding.stride;
+        }
+        result.fullSeries = "vertices_" + std::to_string( results.size() ) + "_full";
+        result.positionSeries = "vertices_" + std::to_string( results.size() ) + "_position";
+
+        const std::vector<VkDeviceSize> offsets( buffers.size(), 0 );
+
+        for( bool positionOnly : { false, true } )
+        {
+            const uint32_t scope = gpuTimer.registerScope( positionOnly ? result.positionSeries : result.fullSeries );
+
+            // The first frame also copies the last of the uploads, it only warms up
+            for( uint32_t i = 0; i <= frames; i++ )
+            {
+                uint32_t imageIndex = drawFrameProlog();
+                recordCommandBufferProlog( imageIndex );
+
+                VkCommandBuffer commandBuffer = GetCommandBuffer();
+                vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, positionOnly ? positionPipeline : fullPipeline );
+                vkCmdBindVertexBuffers( commandBuffer, 0, static_cast< uint32_t >( buffers.size() ), buffers.data(), offsets.data() );
+
+                if( i == 0 )
+                {
+                    vkCmdDraw( commandBuffer, vertexCount, 1, 0, 0 );
+                }
+                else
+                {
+                    GpuScope gpuScope( gpuTimer, commandBuffer, scope );
+                    vkCmdDraw( commandBuffer, vertexCount, 1, 0, 0 );
+                }
+
+                recordCommandBufferEpilog();
+                drawFrameEpilog( imageIndex );
+            }
+        }
+
+        results.push_back( result );
+
+        vkDeviceWaitIdle( GetDevice() );
+        for( size_t i = 0; i < buffers.size(); i++ )
+        {
+            destroyBuffer( buffers[i], allocations[i] );
+        }
+    }
+
+    // Timestamps are collected when a frame slot comes around again
+    for( uint32_t i = 0; i < FramesInFlight(); i++ )
+    {
+        uint32_t imageIndex = drawFrameProlog();
+        recordCommandBufferProlog( imageIndex );
+        recordCommandBufferEpilog();
+        drawFrameEpilog( imageIndex );
+    }
+    vkDeviceWaitIdle( GetDevice() );
+
+    std::cout << vertexCount << " vertices, median GPU time of " << frames << " draws" << std::endl;
+
+    for( const Result& result : results )
+    {
+        const double fullTime = Timing().summarize( Timing().findSeries( "gpu." + result.fullSeries ) ).p50;
+        const double positionTime = Timing().summarize( Timing().findSeries( "gpu." + result.positionSeries ) ).p50;
+
+        auto rate = [vertexCount]( uint32_t bytes, double milliseconds )
+        {
+            return static_cast< double >( vertexCount ) * bytes / std::max( milliseconds, 0.0001 ) / 1e6;
+        };
+
+        std::cout << "  " << result.name << ": " << result.vertexBytes << " B/vertex, all attributes " << fullTime << " ms ("
+            << rate( result.vertexBytes, fullTime ) << " GB/s), position only " << positionTime << " ms ("
+            << rate( result.positionBytes, positionTime ) << " GB/s of " << result.positionBytes << " B/vertex)" << std::endl;
+    }
+}
@@ -0,0 +1,19 @@
+#version 450
+
+layout( location = 0 ) in vec2 inPosition;
+layout( location = 1 ) in vec3 inColor;
+
+// Per object, written by cull.comp: xy position in NDC, zw scale; color.w is the bindless
+// material index in --bindless mode
+layout( location = 2 ) in vec4 inTransform;
+layout( location = 3 ) in vec4 inObjectColor;
+
+layout( location = 0 ) out vec3 fragColor;
+layout( location = 1 ) flat out uint fragMaterial;
+
+void main()
+{
+	gl_Position = vec4( inTransform.xy + inPosition * inTransform.zw, 0.0, 1.0 );
+	fragColor = inColor * inObjectColor.rgb;
+	fragMaterial = uint( inObjectColor.w );
+}
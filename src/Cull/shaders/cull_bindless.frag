@@ -0,0 +1,19 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout( location = 0 ) in vec3 fragColor;
+layout( location = 1 ) flat in uint fragMaterial;
+
+layout( location = 0 ) out vec4 outColor;
+
+// Storage buffer array of the bindless heap, one buffer per material
+layout( std430, set = 0, binding = 1 ) readonly buffer Material
+{
+	vec4 tint;
+} materials[];
+
+void main()
+{
+	// Objects of one indirect draw call use different materials
+	outColor = vec4( fragColor * materials[nonuniformEXT( fragMaterial )].tint.rgb, 1.0 );
+}
\ No newline at end of file
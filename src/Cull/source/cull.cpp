@@ -0,0 +1,675 @@
+#include <core.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <random>
+
+// GPU-driven rendering: a compute pass frustum culls every object and compacts the survivors
+// into an indirect buffer, and one vkCmdDrawIndexedIndirectCount draws them. CPU cost per
+// frame does not depend on the object count. --cpu-cull culls on the CPU and issues one
+// vkCmdDrawIndexed per visible object instead, for comparison. --bindless gives every object
+// one of MATERIAL_COUNT material buffers, read through the bindless heap by index.
+class Cull : core
+{
+public:
+    Cull( HINSTANCE hInst, int sWnd, bool fscreen, const std::vector<std::string>& args ) :
+        core( "Cull Application" ),
+        hInstance( hInst ),
+        showWnd( sWnd ),
+        fullscreen( fscreen )
+    {
+        ParseCommandLine( args );
+
+        m_objectCount = std::max( ArgValue( args, "--objects", m_objectCount ), 1u );
+
+        m_cpuCull = std::find( args.begin(), args.end(), "--cpu-cull" ) != args.end();
+        m_bindless = std::find( args.begin(), args.end(), "--bindless" ) != args.end();
+
+        if( m_bindless )
+        {
+            EnableBindless();
+        }
+
+        RequestDeviceExtension( VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME );
+    }
+
+    void run()
+    {
+        if( !IsHeadless() )
+        {
+            initWindow();
+        }
+        initVulkan();
+        Mainloop();
+        reportVisible();
+        cleanup();
+    }
+
+    void drawFrame()
+    {
+        updateCamera();
+
+        uint32_t imageIndex = drawFrameProlog();
+
+        // Runs the cull dispatch through recordPreRenderPass
+        recordCommandBufferProlog( imageIndex );
+
+        recordCmds();
+
+        recordCommandBufferEpilog();
+
+        drawFrameEpilog( imageIndex );
+    }
+
+private:
+    enum DrawMode
+    {
+        // One vkCmdDrawIndexedIndirectCountKHR, the GPU reads the draw count
+        DRAW_INDIRECT_COUNT,
+        // One vkCmdDrawIndexedIndirect over every slot, culled slots have no instances
+        DRAW_MULTI_INDIRECT,
+        // One vkCmdDrawIndexedIndirect per slot, for devices without multiDrawIndirect
+        DRAW_INDIRECT_LOOP,
+        // Culled on the CPU, one vkCmdDrawIndexed per visible object
+        DRAW_CPU_CULL
+    };
+
+    struct Vertex
+    {
+        glm::vec2 pos;
+        glm::vec3 color;
+    };
+
+    // Matches the std430 structs in cull.comp
+    struct Object
+    {
+        glm::vec4 sphere;
+        glm::vec4 color;
+        uint32_t mesh;
+        uint32_t pad[3];
+    };
+
+    struct Mesh
+    {
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t pad;
+    };
+
+    struct Instance
+    {
+        glm::vec4 transform;
+        glm::vec4 color;
+    };
+
+    // Matches Material in cull_bindless.frag
+    struct Material
+    {
+        glm::vec4 tint;
+    };
+
+    struct CullConstants
+    {
+        glm::mat4 viewProj;
+        glm::vec2 projScale;
+        uint32_t objectCount;
+        uint32_t pad;
+    };
+
+    static constexpr uint32_t CULL_GROUP_SIZE = 64;
+    // Polygons with 3 to 3 + MESH_COUNT - 1 sides
+    static constexpr uint32_t MESH_COUNT = 6;
+    static constexpr uint32_t MATERIAL_COUNT = 256;
+
+    HINSTANCE hInstance;
+    HWND hWindow = nullptr;
+    bool fullscreen;
+    int showWnd;
+
+    uint32_t m_objectCount = 100000;
+    bool m_cpuCull = false;
+    bool m_bindless = false;
+    DrawMode m_drawMode = DRAW_INDIRECT_COUNT;
+    PFN_vkCmdDrawIndexedIndirectCountKHR m_drawIndexedIndirectCount = nullptr;
+    uint32_t m_maxDrawIndirectCount = 1;
+
+    std::vector<Mesh> m_meshes;
+    std::vector<Object> m_objects;
+    CullConstants m_constants{};
+    float m_time = 0.0f;
+
+    VkBuffer m_vertexBuffer = VK_NULL_HANDLE;
+    Allocation m_vertexAllocation;
+    VkBuffer m_indexBuffer = VK_NULL_HANDLE;
+    Allocation m_indexAllocation;
+    VkBuffer m_objectBuffer = VK_NULL_HANDLE;
+    Allocation m_objectAllocation;
+    VkBuffer m_meshBuffer = VK_NULL_HANDLE;
+    Allocation m_meshAllocation;
+
+    // Written by the cull pass every frame. A single copy is enough: every frame's cull waits
+    // for the previous frame's draws on the same queue before overwriting them.
+    VkBuffer m_drawBuffer = VK_NULL_HANDLE;
+    Allocation m_drawAllocation;
+    VkBuffer m_instanceBuffer = VK_NULL_HANDLE;
+    Allocation m_instanceAllocation;
+    VkBuffer m_countBuffer = VK_NULL_HANDLE;
+    Allocation m_countAllocation;
+    // Draw count of each frame slot's last frame, copied back for reporting
+    VkBuffer m_readbackBuffer = VK_NULL_HANDLE;
+    Allocation m_readbackAllocation;
+
+    // --cpu-cull: one range of instance records per frame slot, written by the CPU
+    VkBuffer m_cpuInstanceBuffer = VK_NULL_HANDLE;
+    Allocation m_cpuInstanceAllocation;
+    uint32_t m_cpuVisible = 0;
+
+    // --bindless: one small buffer per material, bindless heap index per material
+    std::vector<VkBuffer> m_materialBuffers;
+    std::vector<Allocation> m_materialAllocations;
+    std::vector<uint32_t> m_materialIndices;
+
+    VkDescriptorSetLayout m_cullSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_cullDescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_cullSet = VK_NULL_HANDLE;
+    VkPipelineLayout m_cullPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_cullPipeline = VK_NULL_HANDLE;
+
+    uint32_t m_cullScope;
+    uint32_t m_drawScope;
+
+    void initWindow()
+    {
+#ifdef _WIN32
+        hWindow = InitWindow( hInstance, "CullWindow", ApplicationName().c_str(), WndProc, 800, 600, fullscreen, showWnd );
+#endif
+    }
+
+    void chooseDrawMode()
+    {
+        m_maxDrawIndirectCount = std::max( GetDeviceSnapshot().properties.limits.maxDrawIndirectCount, 1u );
+
+        if( m_cpuCull )
+        {
+            m_drawMode = DRAW_CPU_CULL;
+        }
+        else if( !EnabledFeatures().drawIndirectFirstInstance )
+        {
+            // cull.vert finds its instance record through firstInstance
+            std::cout << "drawIndirectFirstInstance not supported, culling on the CPU" << std::endl;
+            m_drawMode = DRAW_CPU_CULL;
+        }
+        else if( IsDeviceExtensionEnabled( VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME ) && m_objectCount <= m_maxDrawIndirectCount )
+        {
+            m_drawIndexedIndirectCount = reinterpret_cast< PFN_vkCmdDrawIndexedIndirectCountKHR >(
+                vkGetDeviceProcAddr( GetDevice(), "vkCmdDrawIndexedIndirectCountKHR" ) );
+            m_drawMode = m_drawIndexedIndirectCount ? DRAW_INDIRECT_COUNT : DRAW_MULTI_INDIRECT;
+        }
+        else
+        {
+            m_drawMode = EnabledFeatures().multiDrawIndirect ? DRAW_MULTI_INDIRECT : DRAW_INDIRECT_LOOP;
+        }
+
+        const char* names[] = { "vkCmdDrawIndexedIndirectCount", "multi-draw indirect", "indirect draw per object", "CPU cull" };
+        std::cout << "Drawing " << m_objectCount << " objects with " << names[m_drawMode] << std::endl;
+    }
+
+    // Regular polygons as triangle fans around a center vertex, clockwise like triangle.vert
+    void createMeshes()
+    {
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+
+        for( uint32_t i = 0; i < MESH_COUNT; i++ )
+        {
+            const uint32_t sides = 3 + i;
+
+            Mesh mesh{};
+            mesh.indexCount = sides * 3;
+            mesh.firstIndex = static_cast< uint32_t >( indices.size() );
+            mesh.vertexOffset = static_cast< int32_t >( vertices.size() );
+            m_meshes.push_back( mesh );
+
+            vertices.push_back( { { 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } } );
+            for( uint32_t side = 0; side < sides; side++ )
+            {
+                float angle = 2.0f * 3.14159265f * side / sides;
+                vertices.push_back( { { std::cos( angle ), std::sin( angle ) }, { 0.5f, 0.5f, 0.5f } } );
+
+                indices.push_back( 0 );
+                indices.push_back( 1 + side );
+                indices.push_back( 1 + ( side + 1 ) % sides );
+            }
+        }
+
+        createDeviceBuffer( vertices.data(), sizeof( Vertex ) * vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_vertexBuffer, m_vertexAllocation );
+        createDeviceBuffer( indices.data(), sizeof( uint32_t ) * indices.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, m_indexBuffer, m_indexAllocation );
+        createDeviceBuffer( m_meshes.data(), sizeof( Mesh ) * m_meshes.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_meshBuffer, m_meshAllocation );
+    }
+
+    // Scattered through a cube whose volume grows with the count, so density stays the same
+    void createObjects()
+    {
+        std::mt19937 random( 1 );
+        const float halfSize = 2.0f * std::cbrt( static_cast< float >( m_objectCount ) );
+        std::uniform_real_distribution<float> position( -halfSize, halfSize );
+        std::uniform_real_distribution<float> radius( 0.3f, 1.0f );
+        std::uniform_real_distribution<float> channel( 0.2f, 1.0f );
+        std::uniform_int_distribution<uint32_t> material( 0, MATERIAL_COUNT - 1 );
+
+        m_objects.resize( m_objectCount );
+        for( uint32_t i = 0; i < m_objectCount; i++ )
+        {
+            Object& object = m_objects[i];
+            object.sphere = glm::vec4( position( random ), position( random ), position( random ), radius( random ) );
+            object.color = glm::vec4( channel( random ), channel( random ), channel( random ), 1.0f );
+            if( m_bindless )
+            {
+                object.color.w = static_cast< float >( m_materialIndices[material( random )] );
+            }
+            object.mesh = i % MESH_COUNT;
+        }
+
+        createDeviceBuffer( m_objects.data(), sizeof( Object ) * m_objects.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_objectBuffer, m_objectAllocation );
+    }
+
+    // Separate buffers on purpose: bound per draw they would need a descriptor set each
+    void createMaterials()
+    {
+        std::mt19937 random( 2 );
+        std::uniform_real_distribution<float> channel( 0.4f, 1.0f );
+
+        m_materialBuffers.resize( MATERIAL_COUNT );
+        m_materialAllocations.resize( MATERIAL_COUNT );
+        for( uint32_t i = 0; i < MATERIAL_COUNT; i++ )
+        {
+            Material material = { glm::vec4( channel( random ), channel( random ), channel( random ), 1.0f ) };
+            createDeviceBuffer( &material, sizeof( Material ), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_materialBuffers[i], m_materialAllocations[i] );
+            m_materialIndices.push_back( GetBindlessHeap().addBuffer( m_materialBuffers[i] ) );
+        }
+    }
+
+    void createDeviceBuffer( const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, Allocation& allocation )
+    {
+        createBuffer( size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, allocation );
+        uploadBuffer( buffer, 0, data, size );
+    }
+
+    void createCullResources()
+    {
+        const VkDeviceSize drawSize = sizeof( VkDrawIndexedIndirectCommand ) * m_objectCount;
+        const VkDeviceSize instanceSize = sizeof( Instance ) * m_objectCount;
+
+        if( m_drawMode == DRAW_CPU_CULL )
+        {
+            createBuffer( instanceSize * FramesInFlight(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                m_cpuInstanceBuffer, m_cpuInstanceAllocation );
+            return;
+        }
+
+        createBuffer( drawSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_drawBuffer, m_drawAllocation );
+        createBuffer( instanceSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_instanceBuffer, m_instanceAllocation );
+        createBuffer( sizeof( uint32_t ), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_countBuffer, m_countAllocation );
+        createBuffer( sizeof( uint32_t ) * FramesInFlight(), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            m_readbackBuffer, m_readbackAllocation );
+        memset( m_readbackAllocation.mapped, 0, sizeof( uint32_t ) * FramesInFlight() );
+
+        std::vector<VkDescriptorSetLayoutBinding> bindings( 5 );
+        for( uint32_t i = 0; i < bindings.size(); i++ )
+        {
+            bindings[i].binding = i;
+            bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+
+        m_cullSetLayout = GetDescriptorLayouts().getSetLayout( bindings );
+
+        // The set lives as long as the buffers, so it gets its own pool rather than a per-frame one
+        VkDescriptorPoolSize poolSize{};
+        poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSize.descriptorCount = static_cast< uint32_t >( bindings.size() );
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+
+        if( vkCreateDescriptorPool( GetDevice(), &poolInfo, nullptr, &m_cullDescriptorPool ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create descriptor pool!" );
+        }
+
+        VkDescriptorSetAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateInfo.descriptorPool = m_cullDescriptorPool;
+        allocateInfo.descriptorSetCount = 1;
+        allocateInfo.pSetLayouts = &m_cullSetLayout;
+
+        if( vkAllocateDescriptorSets( GetDevice(), &allocateInfo, &m_cullSet ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to allocate descriptor set!" );
+        }
+
+        VkBuffer buffers[] = { m_objectBuffer, m_meshBuffer, m_drawBuffer, m_instanceBuffer, m_countBuffer };
+
+        DescriptorWriter writer;
+        for( uint32_t i = 0; i < bindings.size(); i++ )
+        {
+            writer.writeBuffer( i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffers[i] );
+        }
+        writer.update( GetDevice(), m_cullSet );
+
+        m_cullPipeline = createComputePipeline( std::string( SPIRV_DIR ) + "/cull.comp.spv", 1, &m_cullSetLayout,
+            sizeof( CullConstants ), m_cullPipelineLayout );
+    }
+
+    void initVulkan()
+    {
+        std::string vertSpv = std::string( SPIRV_DIR ) + "/cull.vert.spv";
+        std::string fragSpv = std::string( SPIRV_DIR ) + "/cull.frag.spv";
+
+        std::array<VkVertexInputBindingDescription, 2> bindings{};
+        bindings[0].binding = 0;
+        bindings[0].stride = sizeof( Vertex );
+        bindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        bindings[1].binding = 1;
+        bindings[1].stride = sizeof( Instance );
+        bindings[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        std::array<VkVertexInputAttributeDescription, 4> attributes{};
+        attributes[0] = { 0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof( Vertex, pos ) };
+        attributes[1] = { 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof( Vertex, color ) };
+        attributes[2] = { 2, 1, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof( Instance, transform ) };
+        attributes[3] = { 3, 1, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof( Instance, color ) };
+
+        createInstance();
+        createSurface( hInstance, hWindow );
+        pickPhysicalDevice();
+        createLogicalDevice();
+        chooseDrawMode();
+
+        // Without descriptor indexing core says so and the plain shaders are used
+        m_bindless = m_bindless && IsBindlessEnabled();
+        if( m_bindless )
+        {
+            SetGraphicsPipelineLayout( { GetBindlessHeap().layout() }, {} );
+            fragSpv = std::string( SPIRV_DIR ) + "/cull_bindless.frag.spv";
+        }
+        createSwapchain( hWindow );
+        createImageViews();
+        createRenderPass();
+        createGraphicsPipeline( vertSpv, fragSpv, static_cast< uint32_t >( bindings.size() ), bindings.data(),
+            static_cast< uint32_t >( attributes.size() ), attributes.data() );
+        createFramebuffers();
+        createCommandPool();
+        createMeshes();
+        if( m_bindless )
+        {
+            createMaterials();
+        }
+        createObjects();
+        createCullResources();
+        createCommandBuffer();
+        createSyncObjects();
+
+        m_cullScope = GetGpuTimer().registerScope( "cull" );
+        m_drawScope = GetGpuTimer().registerScope( "cull_draw" );
+    }
+
+    // Camera at the center of the cloud, turning slowly
+    void updateCamera()
+    {
+        VkExtent2D extent = GetSwapchainExtent();
+        const float aspect = static_cast< float >( extent.width ) / std::max( extent.height, 1u );
+        const float halfSize = 2.0f * std::cbrt( static_cast< float >( m_objectCount ) );
+
+        glm::vec3 direction( std::cos( m_time ), 0.3f * std::sin( m_time * 0.7f ), std::sin( m_time ) );
+        glm::mat4 view = glm::lookAt( glm::vec3( 0.0f ), direction, glm::vec3( 0.0f, 1.0f, 0.0f ) );
+        glm::mat4 proj = glm::perspective( glm::radians( 60.0f ), aspect, 0.1f, 2.0f * halfSize );
+
+        m_constants.viewProj = proj * view;
+        m_constants.projScale = glm::vec2( proj[0][0], proj[1][1] );
+        m_constants.objectCount = m_objectCount;
+
+        m_time += 0.005f;
+    }
+
+    void recordPreRenderPass( VkCommandBuffer commandBuffer ) override
+    {
+        if( m_drawMode == DRAW_CPU_CULL )
+        {
+            return;
+        }
+
+        GpuScope scope( GetGpuTimer(), commandBuffer, m_cullScope );
+
+        // The previous frame's draws must have read the buffers before they are rewritten
+        RecordGraphicsToComputeBarrier( commandBuffer );
+
+        // and the previous frame's readback copy must have read the count before it is cleared
+        vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, 0, nullptr );
+
+        vkCmdFillBuffer( commandBuffer, m_countBuffer, 0, sizeof( uint32_t ), 0 );
+
+        // Without a count buffer every slot is drawn, so the ones past the count need instanceCount 0
+        if( m_drawMode != DRAW_INDIRECT_COUNT )
+        {
+            vkCmdFillBuffer( commandBuffer, m_drawBuffer, 0, VK_WHOLE_SIZE, 0 );
+        }
+
+        VkMemoryBarrier clearBarrier{};
+        clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &clearBarrier, 0, nullptr, 0, nullptr );
+
+        vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline );
+        vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 0, 1, &m_cullSet, 0, nullptr );
+        vkCmdPushConstants( commandBuffer, m_cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( CullConstants ), &m_constants );
+        dispatch( commandBuffer, ( m_objectCount + CULL_GROUP_SIZE - 1 ) / CULL_GROUP_SIZE );
+
+        RecordComputeToGraphicsBarrier( commandBuffer );
+
+        VkMemoryBarrier readbackBarrier{};
+        readbackBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        readbackBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        readbackBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 1, &readbackBarrier, 0, nullptr, 0, nullptr );
+
+        // Read on the CPU once this slot's fence has signalled
+        VkBufferCopy region{};
+        region.dstOffset = sizeof( uint32_t ) * CurrentFrame();
+        region.size = sizeof( uint32_t );
+        vkCmdCopyBuffer( commandBuffer, m_countBuffer, m_readbackBuffer, 1, &region );
+    }
+
+    void recordCmds()
+    {
+        VkCommandBuffer commandBuffer = GetCommandBuffer();
+        GpuScope scope( GetGpuTimer(), commandBuffer, m_drawScope );
+
+        VkDeviceSize vertexOffset = 0;
+        vkCmdBindVertexBuffers( commandBuffer, 0, 1, &m_vertexBuffer, &vertexOffset );
+        vkCmdBindIndexBuffer( commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32 );
+
+        // Once for every draw, whatever material each object has
+        if( m_bindless )
+        {
+            VkDescriptorSet set = GetBindlessHeap().set();
+            vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GetPipelineLayout(), 0, 1, &set, 0, nullptr );
+        }
+
+        if( m_drawMode == DRAW_CPU_CULL )
+        {
+            recordCpuCull( commandBuffer );
+            return;
+        }
+
+        VkDeviceSize instanceOffset = 0;
+        vkCmdBindVertexBuffers( commandBuffer, 1, 1, &m_instanceBuffer, &instanceOffset );
+
+        const uint32_t stride = sizeof( VkDrawIndexedIndirectCommand );
+
+        switch( m_drawMode )
+        {
+        case DRAW_INDIRECT_COUNT:
+            m_drawIndexedIndirectCount( commandBuffer, m_drawBuffer, 0, m_countBuffer, 0, m_objectCount, stride );
+            break;
+
+        case DRAW_MULTI_INDIRECT:
+            for( uint32_t first = 0; first < m_objectCount; first += m_maxDrawIndirectCount )
+            {
+                vkCmdDrawIndexedIndirect( commandBuffer, m_drawBuffer, static_cast< VkDeviceSize >( first ) * stride,
+                    std::min( m_objectCount - first, m_maxDrawIndirectCount ), stride );
+            }
+            break;
+
+        default:
+            for( uint32_t i = 0; i < m_objectCount; i++ )
+            {
+                vkCmdDrawIndexedIndirect( commandBuffer, m_drawBuffer, static_cast< VkDeviceSize >( i ) * stride, 1, stride );
+            }
+            break;
+        }
+    }
+
+    // Same test and output as cull.comp, one draw call per visible object
+    void recordCpuCull( VkCommandBuffer commandBuffer )
+    {
+        const glm::mat4& m = m_constants.viewProj;
+        glm::vec4 rows[4];
+        for( int i = 0; i < 4; i++ )
+        {
+            rows[i] = glm::vec4( m[0][i], m[1][i], m[2][i], m[3][i] );
+        }
+
+        const glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2], rows[3] - rows[2] };
+
+        Instance* instances = static_cast< Instance* >( m_cpuInstanceAllocation.mapped ) + static_cast< size_t >( CurrentFrame() ) * m_objectCount;
+
+        VkDeviceSize instanceOffset = sizeof( Instance ) * m_objectCount * CurrentFrame();
+        vkCmdBindVertexBuffers( commandBuffer, 1, 1, &m_cpuInstanceBuffer, &instanceOffset );
+
+        uint32_t visible = 0;
+        for( const Object& object : m_objects )
+        {
+            bool inside = true;
+            for( const glm::vec4& plane : planes )
+            {
+                if( glm::dot( glm::vec3( plane ), glm::vec3( object.sphere ) ) + plane.w < -object.sphere.w * glm::length( glm::vec3( plane ) ) )
+                {
+                    inside = false;
+                    break;
+                }
+            }
+
+            if( !inside )
+            {
+                continue;
+            }
+
+            glm::vec4 clip = m * glm::vec4( glm::vec3( object.sphere ), 1.0f );
+            float w = std::max( clip.w, 1e-4f );
+
+            Instance instance;
+            instance.transform = glm::vec4( clip.x / w, clip.y / w, m_constants.projScale * object.sphere.w / w );
+            instance.color = object.color;
+            instances[visible] = instance;
+
+            const Mesh& mesh = m_meshes[object.mesh];
+            vkCmdDrawIndexed( commandBuffer, mesh.indexCount, 1, mesh.firstIndex, mesh.vertexOffset, visible );
+            visible++;
+        }
+
+        m_cpuVisible = visible;
+    }
+
+    void reportVisible()
+    {
+        uint32_t visible = m_cpuVisible;
+        if( m_drawMode != DRAW_CPU_CULL )
+        {
+            // The device is idle after Mainloop, so the last frame's copy has landed
+            visible = static_cast< const uint32_t* >( m_readbackAllocation.mapped )[( CurrentFrame() + FramesInFlight() - 1 ) % FramesInFlight()];
+        }
+
+        std::cout << visible << " of " << m_objectCount << " objects visible in the last frame" << std::endl;
+    }
+
+    void cleanup()
+    {
+        destroyBuffer( m_vertexBuffer, m_vertexAllocation );
+        destroyBuffer( m_indexBuffer, m_indexAllocation );
+        destroyBuffer( m_objectBuffer, m_objectAllocation );
+        destroyBuffer( m_meshBuffer, m_meshAllocation );
+        for( size_t i = 0; i < m_materialBuffers.size(); i++ )
+        {
+            destroyBuffer( m_materialBuffers[i], m_materialAllocations[i] );
+        }
+
+        if( m_drawMode == DRAW_CPU_CULL )
+        {
+            destroyBuffer( m_cpuInstanceBuffer, m_cpuInstanceAllocation );
+        }
+        else
+        {
+            destroyBuffer( m_drawBuffer, m_drawAllocation );
+            destroyBuffer( m_instanceBuffer, m_instanceAllocation );
+            destroyBuffer( m_countBuffer, m_countAllocation );
+            destroyBuffer( m_readbackBuffer, m_readbackAllocation );
+
+            vkDestroyPipeline( GetDevice(), m_cullPipeline, nullptr );
+            vkDestroyDescriptorPool( GetDevice(), m_cullDescriptorPool, nullptr );
+        }
+
+        core::cleanup();
+    }
+};
+
+#ifdef _WIN32
+int CALLBACK WinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPSTR lpCmdLine, _In_ int nShowCmd )
+{
+    Cull cull( hInstance, nShowCmd, false, SplitCommandLine( lpCmdLine ) );
+    try
+    {
+        cull.run();
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+#else
+int main( int argc, char** argv )
+{
+    Cull cull( nullptr, 0, false, std::vector<std::string>( argv + 1, argv + argc ) );
+    try
+    {
+        cull.run();
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+#endif
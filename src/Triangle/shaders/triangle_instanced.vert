@@ -0,0 +1,20 @@
+#version 450
+
+layout( location = 0 ) in vec2 inPosition;
+layout( location = 1 ) in vec3 inColor;
+
+// Per instance: xy offset, uniform scale, rotation in radians
+layout( location = 2 ) in vec4 inTransform;
+layout( location = 3 ) in vec4 inInstanceColor;
+
+layout( location = 0 ) out vec3 fragColor;
+
+void main()
+{
+	float s = sin( inTransform.w );
+	float c = cos( inTransform.w );
+	vec2 rotated = mat2( c, s, -s, c ) * inPosition;
+
+	gl_Position = vec4( inTransform.xy + rotated * inTransform.z, 0.0, 1.0 );
+	fragColor = inColor * inInstanceColor.rgb;
+}
@@ -1,24 +1,48 @@
 #include <core.h>
+#include <vertexlayout.h>
 #include <glm/glm.hpp>
 
 
 class Triangle : core
 {
 public:
-    Triangle( HINSTANCE hInst, int sWnd, bool fscreen ) :
+    Triangle( HINSTANCE hInst, int sWnd, bool fscreen, const std::vector<std::string>& args ) :
         core( "Triangle Application" ),
         hInstance( hInst ),
         showWnd(sWnd),
         fullscreen( fscreen )
     {
-      
+        ParseCommandLine( args );
+
+        m_hostVisibleVertices = hasArg( args, "--host-vertices" );
+        m_compactVertices = hasArg( args, "--compact-vertices" );
+        m_assetSize = static_cast< VkDeviceSize >( ArgValue( args, "--asset-mb", 0 ) ) * 1024 * 1024;
+        m_instanceCount = ArgValue( args, "--instances", 0 );
+        m_instanceSweep = hasArg( args, "--instance-sweep" );
+
+        if( m_instanceSweep )
+        {
+            m_instanceCount = MAX_SWEEP_INSTANCES;
+        }
     }
 
     void run()
     {
-        initWindow();
+        if( !IsHeadless() )
+        {
+            initWindow();
+        }
         initVulkan();
-        Mainloop();
+
+        if( m_instanceSweep )
+        {
+            instanceSweep();
+        }
+        else
+        {
+            Mainloop();
+        }
+
         cleanup();
     }
 
@@ -28,6 +52,16 @@ public:
 
         recordCommandBufferProlog( imageIndex );
 
+        if( m_assetTicket != AsyncUploader::INVALID_TICKET )
+        {
+            m_assetFrames++;
+            if( GetAsyncUploader().isComplete( m_assetTicket ) )
+            {
+                std::cout << "Asset of " << m_assetSize / ( 1024 * 1024 ) << " MB resident after " << m_assetFrames << " frames" << std::endl;
+                m_assetTicket = AsyncUploader::INVALID_TICKET;
+            }
+        }
+
         recordCmds();
 
         recordCommandBufferEpilog();
@@ -36,11 +70,41 @@ public:
     }
 
 private:
+    static constexpr uint32_t MAX_SWEEP_INSTANCES = 1000000;
+    static constexpr uint32_t SWEEP_FRAMES = 100;
+
     HINSTANCE hInstance;
-    HWND hWindow;
+    HWND hWindow = nullptr;
 
     VkBuffer m_vertexBuffer;
-    VkDeviceMemory m_vertexBufferMemory;
+    Allocation m_vertexBufferAllocation;
+    // Old path for comparison: vertices read straight from host memory every frame
+    bool m_hostVisibleVertices = false;
+    bool m_compactVertices = false;
+
+    // Stand-in for a big asset streamed in on the transfer queue while frames keep going
+    VkDeviceSize m_assetSize = 0;
+    VkBuffer m_assetBuffer = VK_NULL_HANDLE;
+    Allocation m_assetAllocation;
+    uint64_t m_assetTicket = AsyncUploader::INVALID_TICKET;
+    uint32_t m_assetFrames = 0;
+    uint32_t m_drawScope;
+
+    // Instanced mode: one persistently mapped, per frame slot range of Instance records
+    struct Instance
+    {
+        glm::vec4 transform;
+        glm::vec4 color;
+    };
+
+    uint32_t m_instanceCount = 0;
+    uint32_t m_instanceCapacity = 0;
+    bool m_instanceSweep = false;
+    VkBuffer m_instanceBuffer = VK_NULL_HANDLE;
+    Allocation m_instanceAllocation;
+    uint32_t m_instanceUpdateSeries;
+    double m_instanceUpdateTotal = 0.0;
+    float m_time = 0.0f;
 
     bool fullscreen;
     int showWnd;
@@ -52,138 +116,300 @@ private:
         glm::vec2 pos;
         glm::vec3 color;
 
-        static VkVertexInputBindingDescription getBindingDescription()
+        // Instanced mode: binding 1 steps once per instance
+        static VkVertexInputBindingDescription getInstanceBindingDescription()
         {
             VkVertexInputBindingDescription bindingDesc = {};
-            bindingDesc.binding = 0;
-            bindingDesc.stride = sizeof( Vertex );
-            bindingDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+            bindingDesc.binding = 1;
+            bindingDesc.stride = sizeof( Instance );
+            bindingDesc.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
 
             return bindingDesc;
         }
 
-        static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescription()
+        static std::array<VkVertexInputAttributeDescription, 2> getInstanceAttributeDescription()
         {
             std::array<VkVertexInputAttributeDescription, 2> attrDesc = {};
-            attrDesc[0].binding = 0;
-            attrDesc[0].location = 0;
-            attrDesc[0].format = VK_FORMAT_R32G32_SFLOAT;
-            attrDesc[0].offset = offsetof( Vertex, pos );
+            attrDesc[0].binding = 1;
+            attrDesc[0].location = 2;
+            attrDesc[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attrDesc[0].offset = offsetof( Instance, transform );
 
-            attrDesc[1].binding = 0;
-            attrDesc[1].location = 1;
-            attrDesc[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-            attrDesc[1].offset = offsetof( Vertex, color );
+            attrDesc[1].binding = 1;
+            attrDesc[1].location = 3;
+            attrDesc[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attrDesc[1].offset = offsetof( Instance, color );
 
             return attrDesc;
         }
     };
 
+    // Binding 0 as the vertex buffer stores it: Vertex as is, 20 bytes, or with --compact-vertices
+    // half float positions and 8 bit colors, 8 bytes. triangle.vert reads both.
+    using FloatLayout = VertexLayout<VertexStream<VertexAttribute<0, glm::vec2>, VertexAttribute<1, glm::vec3>>>;
+    using CompactLayout = VertexLayout<VertexStream<VertexAttribute<0, Half2>, VertexAttribute<1, Unorm8x4>>>;
+    static_assert( FloatLayout::vertexSize() == sizeof( Vertex ), "Vertex no longer matches FloatLayout" );
+
     const std::vector<Vertex> vertices = {
     { {0.0f, -0.5f}, {1.0, 0.0, 0.0} },
     { {0.5f, 0.5f}, {0.0, 1.0, 0.0} },
     { {-0.5f, 0.5f}, {0.0, 0.0, 1.0} } };
 
+    static bool hasArg( const std::vector<std::string>& args, const std::string& name )
+    {
+        return std::find( args.begin(), args.end(), name ) != args.end();
+    }
+
     void initWindow()
     {
+#ifdef _WIN32
         hWindow = InitWindow( hInstance, "TriangleWindow", ApplicationName().c_str(), WndProc, 800, 600, fullscreen, showWnd);
+#endif
     }
 
-    uint32_t findMemoryType( uint32_t typeFilter, VkMemoryPropertyFlags properties )
+    template<typename Layout>
+    std::vector<uint8_t> packVertices()
     {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties( GetPhysicalDevice(), &memProperties );
+        std::vector<uint8_t> packed( Layout::vertexSize() * vertices.size() );
+        uint8_t* streams[] = { packed.data() };
 
-        for( int i = 0; i < memProperties.memoryTypeCount; i++ )
+        for( size_t i = 0; i < vertices.size(); i++ )
         {
-            if( ( typeFilter & ( 1 << i ) ) &&
-                ( memProperties.memoryTypes[i].propertyFlags & properties ) == properties )
+            if constexpr( std::is_same_v<Layout, CompactLayout> )
             {
-                return i;
+                Layout::template write<0>( streams, i, toHalf2( vertices[i].pos ) );
+                Layout::template write<1>( streams, i, toUnorm8x4( glm::vec4( vertices[i].color, 1.0f ) ) );
+            }
+            else
+            {
+                Layout::template write<0>( streams, i, vertices[i].pos );
+                Layout::template write<1>( streams, i, vertices[i].color );
             }
         }
 
-        throw std::runtime_error( "Error while finding suitable memory type" );
+        return packed;
     }
 
     void createVertexBuffers()
     {
-        VkBufferCreateInfo createInfo = {};
-        createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        createInfo.size = sizeof( vertices[0] ) * vertices.size();
-        createInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        const std::vector<uint8_t> packed = m_compactVertices ? packVertices<CompactLayout>() : packVertices<FloatLayout>();
+        VkDeviceSize size = packed.size();
 
-        if( vkCreateBuffer( GetDevice(), &createInfo, NULL, &m_vertexBuffer ) != VK_SUCCESS )
+        if( m_hostVisibleVertices )
         {
-            throw std::runtime_error( "Error while creating vertex buffer" );
+            createBuffer( size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                m_vertexBuffer, m_vertexBufferAllocation );
+
+            // Host visible blocks stay mapped for their whole lifetime
+            memcpy( m_vertexBufferAllocation.mapped, packed.data(), size );
+            return;
         }
 
-        VkMemoryRequirements memoryRequirements;
-        vkGetBufferMemoryRequirements( GetDevice(), m_vertexBuffer, &memoryRequirements );
+        createBuffer( size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vertexBuffer, m_vertexBufferAllocation );
 
-        VkMemoryAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memoryRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType( memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT );
+        // Copied from the staging ring at the start of the first frame
+        uploadBuffer( m_vertexBuffer, 0, packed.data(), size );
+    }
 
-        if( vkAllocateMemory( GetDevice(), &allocInfo, nullptr, &m_vertexBufferMemory ) != VK_SUCCESS )
+    void createInstanceBuffer()
+    {
+        if( m_instanceCount == 0 )
         {
-            throw std::runtime_error( "Error while allocating memory for vertex buffer" );
+            return;
         }
 
-        vkBindBufferMemory( GetDevice(), m_vertexBuffer, m_vertexBufferMemory, 0 );
+        // The CPU rewrites a slot's range while the GPU reads the ranges of the other slots
+        m_instanceCapacity = m_instanceCount;
+        VkDeviceSize size = sizeof( Instance ) * m_instanceCapacity * FramesInFlight();
 
-        void* data = nullptr;
+        createBuffer( size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            m_instanceBuffer, m_instanceAllocation );
+    }
+
+    // Lays the instances out on a square grid and spins each one, every frame
+    void updateInstances()
+    {
+        TimingStats::Clock::time_point start = TimingStats::Clock::now();
 
-        vkMapMemory( GetDevice(), m_vertexBufferMemory, 0, createInfo.size, 0, &data );
-        memcpy( data, vertices.data(), createInfo.size );
-        vkUnmapMemory( GetDevice(), m_vertexBufferMemory );
+        Instance* instances = static_cast< Instance* >( m_instanceAllocation.mapped ) + static_cast< size_t >( CurrentFrame() ) * m_instanceCapacity;
+
+        const uint32_t side = static_cast< uint32_t >( std::ceil( std::sqrt( static_cast< double >( m_instanceCount ) ) ) );
+        const float cell = 2.0f / side;
+
+        for( uint32_t i = 0; i < m_instanceCount; i++ )
+        {
+            const uint32_t x = i % side;
+            const uint32_t y = i / side;
+
+            Instance instance;
+            instance.transform = glm::vec4( -1.0f + ( x + 0.5f ) * cell, -1.0f + ( y + 0.5f ) * cell, cell * 0.8f, m_time + i * 0.001f );
+            instance.color = glm::vec4( static_cast< float >( x ) / side, static_cast< float >( y ) / side, 1.0f, 1.0f );
+
+            // Write-combined memory: store whole records, never read back
+            instances[i] = instance;
+        }
+
+        m_time += 0.01f;
+
+        TimingStats::Clock::time_point end = TimingStats::Clock::now();
+        Timing().record( m_instanceUpdateSeries, start, end );
+        m_instanceUpdateTotal += std::chrono::duration<double, std::milli>( end - start ).count();
+    }
+
+    // Renders SWEEP_FRAMES frames at 1, 10, ... 1M instances and reports the mean frame time and
+    // the CPU time spent writing instance data, both in milliseconds
+    void instanceSweep()
+    {
+        std::cout << "instances, frame ms, update ms" << std::endl;
+
+        for( uint32_t count = 1; count <= MAX_SWEEP_INSTANCES; count *= 10 )
+        {
+            m_instanceCount = count;
+            m_instanceUpdateTotal = 0.0;
+
+            TimingStats::Clock::time_point start = TimingStats::Clock::now();
+
+            for( uint32_t i = 0; i < SWEEP_FRAMES; i++ )
+            {
+                drawFrame();
+            }
+
+            // Include the GPU work of the last frames in flight
+            vkDeviceWaitIdle( GetDevice() );
+            double total = std::chrono::duration<double, std::milli>( TimingStats::Clock::now() - start ).count();
+
+            std::cout << count << ", " << total / SWEEP_FRAMES << ", " << m_instanceUpdateTotal / SWEEP_FRAMES << std::endl;
+        }
+    }
+
+    void createAssetBuffer()
+    {
+        if( m_assetSize == 0 )
+        {
+            return;
+        }
+
+        createBuffer( m_assetSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_assetBuffer, m_assetAllocation );
+
+        std::vector<uint8_t> data( static_cast< size_t >( m_assetSize ), 0x5a );
+        m_assetTicket = GetAsyncUploader().upload( m_assetBuffer, 0, data.data(), m_assetSize );
     }
 
     void initVulkan()
     {
-        std::string vertSpv = "D:\\Workspace\\source\\repos\\VkSamples\\out\\bin\\Debug\\shaders\\triangle.vert.spv";
-        std::string fragSpv = "D:\\Workspace\\source\\repos\\VkSamples\\out\\bin\\Debug\\shaders\\triangle.frag.spv";
-        auto bindings = Vertex::getBindingDescription();
-        auto attributes = Vertex::getAttributeDescription();
-
-        createInstance();
-        createSurface( hInstance, hWindow );
-        pickPhysicalDevice();
-        createLogicalDevice();
-        createSwapchain( hWindow );
-        createImageViews();
-        createRenderPass();
-        createGraphicsPipeline(vertSpv, fragSpv, 1, &bindings, attributes.size(), attributes.data());
-        createFramebuffers();
-        createCommandPool();
-        createVertexBuffers();
-        createCommandBuffer();
-        createSyncObjects();
+        std::string vertSpv = std::string( SPIRV_DIR ) + ( m_instanceCount > 0 ? "/triangle_instanced.vert.spv" : "/triangle.vert.spv" );
+        std::string fragSpv = std::string( SPIRV_DIR ) + "/triangle.frag.spv";
+
+        const auto& vertexBinding = m_compactVertices ? CompactLayout::bindings : FloatLayout::bindings;
+        const auto& vertexAttributes = m_compactVertices ? CompactLayout::attributes : FloatLayout::attributes;
+        std::array<VkVertexInputBindingDescription, 2> bindings = { vertexBinding[0], Vertex::getInstanceBindingDescription() };
+        std::array<VkVertexInputAttributeDescription, 4> attributes;
+        auto instanceAttributes = Vertex::getInstanceAttributeDescription();
+        std::copy( vertexAttributes.begin(), vertexAttributes.end(), attributes.begin() );
+        std::copy( instanceAttributes.begin(), instanceAttributes.end(), attributes.begin() + vertexAttributes.size() );
+
+        uint32_t bindingCount = m_instanceCount > 0 ? 2 : 1;
+        uint32_t attributeCount = m_instanceCount > 0 ? 4 : 2;
+
+        StartupStep( "instance", [&] { createInstance(); } );
+        StartupStep( "surface", [&] { createSurface( hInstance, hWindow ); } );
+        StartupStep( "physical_device", [&] { pickPhysicalDevice(); } );
+        StartupStep( "logical_device", [&] { createLogicalDevice(); } );
+
+        // Three chains that meet at the end. The swapchain format is chosen with the device, so the
+        // render pass and pipeline compile while the swapchain is created and the rest is set up and
+        // the buffers upload. The swapchain and buffer chains both allocate memory, so the buffers
+        // wait for the framebuffers.
+        TaskGraph graph;
+        TaskGraph::TaskId shaders = graph.add( "shader_modules", [&]
+        {
+            GetShaderModules().get( vertSpv );
+            GetShaderModules().get( fragSpv );
+        } );
+        TaskGraph::TaskId swapchain = graph.add( "swapchain", [&] { createSwapchain( hWindow ); } );
+        TaskGraph::TaskId renderPass = graph.add( "render_pass", [&] { createRenderPass(); } );
+        graph.add( "pipeline", [&]
+        {
+            createGraphicsPipeline( vertSpv, fragSpv, bindingCount, bindings.data(), attributeCount, attributes.data() );
+        }, { shaders, renderPass } );
+        TaskGraph::TaskId imageViews = graph.add( "image_views", [&] { createImageViews(); }, { swapchain } );
+        TaskGraph::TaskId framebuffers = graph.add( "framebuffers", [&] { createFramebuffers(); }, { renderPass, imageViews } );
+        TaskGraph::TaskId commandPool = graph.add( "command_pool", [&] { createCommandPool(); }, { framebuffers } );
+        TaskGraph::TaskId vertexBuffers = graph.add( "vertex_buffers", [&] { createVertexBuffers(); }, { commandPool } );
+        TaskGraph::TaskId assetBuffer = graph.add( "asset_buffer", [&] { createAssetBuffer(); }, { vertexBuffers } );
+        TaskGraph::TaskId instanceBuffer = graph.add( "instance_buffer", [&] { createInstanceBuffer(); }, { assetBuffer } );
+        TaskGraph::TaskId commandBuffer = graph.add( "command_buffers", [&] { createCommandBuffer(); }, { instanceBuffer } );
+        graph.add( "sync_objects", [&] { createSyncObjects(); }, { commandBuffer } );
+
+        RunStartupTasks( graph );
+
+        m_drawScope = GetGpuTimer().registerScope( "triangle_draw" );
+        m_instanceUpdateSeries = Timing().addSeries( "cpu.instance_update" );
     }
 
     void recordCmds()
     {
+        GpuScope scope( GetGpuTimer(), GetCommandBuffer(), m_drawScope );
+
         VkBuffer vertexBuffers[] = { m_vertexBuffer };
         VkDeviceSize offsets[] = { 0 };
 
         vkCmdBindVertexBuffers( GetCommandBuffer(), 0, 1, vertexBuffers, offsets );
 
-        vkCmdDraw( GetCommandBuffer(), 3, 1, 0, 0 );
+        if( m_instanceCount == 0 )
+        {
+            vkCmdDraw( GetCommandBuffer(), 3, 1, 0, 0 );
+            return;
+        }
+
+        updateInstances();
+
+        // This frame slot's range of the instance buffer
+        VkDeviceSize instanceOffset = sizeof( Instance ) * m_instanceCapacity * CurrentFrame();
+        vkCmdBindVertexBuffers( GetCommandBuffer(), 1, 1, &m_instanceBuffer, &instanceOffset );
+
+        vkCmdDraw( GetCommandBuffer(), 3, m_instanceCount, 0, 0 );
     }
 
     void cleanup()
     {
-        vkDestroyBuffer( GetDevice(), m_vertexBuffer, nullptr );
-        vkFreeMemory( GetDevice(), m_vertexBufferMemory, nullptr );
+        destroyBuffer( m_vertexBuffer, m_vertexBufferAllocation );
+        if( m_assetBuffer != VK_NULL_HANDLE )
+        {
+            destroyBuffer( m_assetBuffer, m_assetAllocation );
+        }
+        if( m_instanceBuffer != VK_NULL_HANDLE )
+        {
+            destroyBuffer( m_instanceBuffer, m_instanceAllocation );
+        }
         core::cleanup();
     }
 };
 
+#ifdef _WIN32
 int CALLBACK WinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPSTR lpCmdLine, _In_ int nShowCmd )
 {
-    Triangle triangle( hInstance, nShowCmd, false );
+    Triangle triangle( hInstance, nShowCmd, false, SplitCommandLine( lpCmdLine ) );
+    try
+    {
+        triangle.run();
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+#else
+int main( int argc, char** argv )
+{
+    Triangle triangle( nullptr, 0, false, std::vector<std::string>( argv + 1, argv + argc ) );
     try
     {
         triangle.run();
@@ -196,3 +422,4 @@ int CALLBACK WinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
 
     return EXIT_SUCCESS;
 }
+#endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <devicesnapshot.h>
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A sub-allocation handed out by DeviceAllocator. Bind resources at memory + offset.
+struct Allocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // Persistently mapped pointer to offset, null unless the memory type is host visible
+    void* mapped = nullptr;
+    uint32_t memoryType = 0;
+
+    // Bookkeeping for free()
+    uint32_t pool = UINT32_MAX;
+    uint32_t block = UINT32_MAX;
+    VkDeviceSize chunkOffset = 0;
+    VkDeviceSize chunkSize = 0;
+};
+
+// Carves resources out of large VkDeviceMemory blocks instead of one vkAllocateMemory per
+// resource. Every memory type has two pools, one for buffers and linear images and one for
+// optimal images, so neighbours in a block never violate bufferImageGranularity. Free space
+// in a block is tracked by offset (for coalescing) and by size (for O(log n) best fit).
+class DeviceAllocator
+{
+public:
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+    struct HeapStats
+    {
+        uint32_t blockCount = 0;
+        VkDeviceSize blockBytes = 0;
+        uint32_t allocationCount = 0;
+        VkDeviceSize allocatedBytes = 0;
+    };
+
+    void init( VkDevice device, const DeviceSnapshot& physicalDevice );
+    void destroy();
+
+    uint32_t findMemoryType( uint32_t typeFilter, VkMemoryPropertyFlags properties ) const;
+    const VkPhysicalDeviceMemoryProperties& memoryProperties() const;
+
+    Allocation allocate( const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool optimalImage = false );
+    void free( Allocation& allocation );
+
+    HeapStats heapStats( uint32_t heap ) const;
+    uint64_t deviceAllocationCount() const;
+
+private:
+    struct Block
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint8_t* mapped = nullptr;
+        uint32_t allocationCount = 0;
+        bool dedicated = false;
+        std::map<VkDeviceSize, VkDeviceSize> freeByOffset;
+        std::set<std::pair<VkDeviceSize, VkDeviceSize>> freeBySize;
+    };
+
+    struct Pool
+    {
+        uint32_t memoryType = 0;
+        std::vector<std::unique_ptr<Block>> blocks;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+    VkDeviceSize m_bufferImageGranularity = 1;
+    // Indexed by memoryType * 2 + optimalImage
+    std::vector<Pool> m_pools;
+    std::vector<HeapStats> m_heapStats;
+    uint64_t m_deviceAllocations = 0;
+    mutable std::mutex m_mutex;
+
+    VkDeviceSize blockSizeFor( uint32_t memoryType ) const;
+    uint32_t createBlock( Pool& pool, VkDeviceSize size, bool dedicated );
+    void destroyBlock( Pool& pool, uint32_t blockIndex );
+    bool allocateFromBlock( Block& block, VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation );
+    void insertFree( Block& block, VkDeviceSize offset, VkDeviceSize size );
+    void releaseChunk( Block& block, VkDeviceSize offset, VkDeviceSize size );
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <allocator.h>
+#include <timeline.h>
+
+#include <cstdint>
+#include <vector>
+
+// Uploads big buffers on the transfer queue without blocking frame submission. Each job gets
+// its own staging allocation, command buffer, fence and semaphore, and is submitted at once.
+// Once its fence has signalled, the next graphics frame acquires the buffer: with a dedicated
+// transfer family that is a queue family ownership transfer (release on the transfer queue,
+// acquire in the frame) ordered by the semaphore; on a shared family the copy's own barrier
+// and submission order are enough. Jobs are retired when the acquiring frame slot comes round.
+// With a timeline semaphore the jobs need no fence or semaphore of their own: every submit
+// signals the timeline with its ticket, and a frame waits once for the highest ticket it acquires.
+class AsyncUploader
+{
+public:
+    static constexpr uint64_t INVALID_TICKET = 0;
+
+    void init( VkDevice device, DeviceAllocator& allocator, VkQueue transferQueue, uint32_t transferFamily, uint32_t graphicsFamily );
+    void destroy();
+
+    // Switches to timeline synchronization; must be called before the first upload
+    void useTimeline( TimelineSemaphore& timeline );
+
+    bool hasDedicatedQueue() const;
+
+    // Copies data into a new staging buffer and submits the copy to dst right away
+    uint64_t upload( VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size );
+
+    // True once the data is visible to commands recorded after the frame's prolog
+    bool isComplete( uint64_t ticket ) const;
+
+    // Frees jobs acquired by the slot's previous frame. Its fence must have signalled.
+    void beginFrame( uint32_t slot );
+
+    // Acquires every finished job into this frame. Must be recorded outside a render pass.
+    void record( VkCommandBuffer commandBuffer, uint32_t slot );
+
+    // Semaphores the frame recorded by record() has to wait on, with their stages and the
+    // values to wait for, which are only meaningful for the timeline
+    const std::vector<VkSemaphore>& waitSemaphores() const;
+    const std::vector<VkPipelineStageFlags>& waitStages() const;
+    const std::vector<uint64_t>& waitValues() const;
+
+    uint64_t jobCount() const;
+
+private:
+    enum JobState
+    {
+        JOB_SUBMITTED,
+        JOB_ACQUIRED
+    };
+
+    struct Job
+    {
+        uint64_t ticket = INVALID_TICKET;
+        JobState state = JOB_SUBMITTED;
+        uint32_t slot = 0;
+        VkBuffer dst = VK_NULL_HANDLE;
+        VkDeviceSize dstOffset = 0;
+        VkDeviceSize size = 0;
+        VkBuffer staging = VK_NULL_HANDLE;
+        Allocation stagingAllocation;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    DeviceAllocator* m_allocator = nullptr;
+    VkQueue m_transferQueue = VK_NULL_HANDLE;
+    uint32_t m_transferFamily = 0;
+    uint32_t m_graphicsFamily = 0;
+    VkCommandPool m_commandPool = VK_NULL_HANDLE;
+    TimelineSemaphore* m_timeline = nullptr;
+
+    std::vector<Job> m_jobs;
+    uint64_t m_nextTicket = 1;
+
+    std::vector<VkSemaphore> m_waitSemaphores;
+    std::vector<VkPipelineStageFlags> m_waitStages;
+    std::vector<uint64_t> m_waitValues;
+
+    bool isFinished( const Job& job );
+    void destroyJob( Job& job );
+};
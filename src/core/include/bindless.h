@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <descriptors.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// One update-after-bind descriptor set holding every sampled image, storage buffer and sampler
+// a sample registers. Shaders index the arrays with an index taken from a push constant or an
+// instance attribute, so the set is bound once per frame whatever the draws use:
+//
+//   layout( set = 0, binding = 0 ) uniform texture2D images[];
+//   layout( set = 0, binding = 1 ) buffer Buffers { ... } buffers[];
+//   layout( set = 0, binding = 2 ) uniform sampler samplers[];
+//
+// Slots are written as they are added, which update-after-bind allows while the set is bound
+// by frames in flight. A removed index is reused by the next add, so remove through
+// core::deferDestroy once no frame in flight can still read it.
+class BindlessHeap
+{
+public:
+    static constexpr uint32_t IMAGE_BINDING = 0;
+    static constexpr uint32_t BUFFER_BINDING = 1;
+    static constexpr uint32_t SAMPLER_BINDING = 2;
+
+    void init( VkDevice device, DescriptorLayoutCache& layouts, uint32_t imageCapacity, uint32_t bufferCapacity, uint32_t samplerCapacity );
+    void destroy();
+
+    uint32_t addImage( VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+    uint32_t addBuffer( VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE );
+    uint32_t addSampler( VkSampler sampler );
+
+    void removeImage( uint32_t index );
+    void removeBuffer( uint32_t index );
+    void removeSampler( uint32_t index );
+
+    VkDescriptorSetLayout layout() const;
+    VkDescriptorSet set() const;
+
+    uint32_t imageCount() const;
+    uint32_t bufferCount() const;
+    uint32_t samplerCount() const;
+
+private:
+    // Hands out array elements of one binding, lowest free index first after a removal
+    struct Slots
+    {
+        const char* name = "";
+        uint32_t capacity = 0;
+        uint32_t next = 0;
+        uint32_t live = 0;
+        std::vector<uint32_t> freeIndices;
+        // One per index below next, so a removal of a free or never added index is caught
+        std::vector<bool> inUse;
+
+        uint32_t take();
+        void release( uint32_t index );
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+    VkDescriptorPool m_pool = VK_NULL_HANDLE;
+    VkDescriptorSet m_set = VK_NULL_HANDLE;
+    Slots m_images;
+    Slots m_buffers;
+    Slots m_samplers;
+    mutable std::mutex m_mutex;
+
+    void write( uint32_t binding, uint32_t index, VkDescriptorType type, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo );
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// Workgroup grid for groupCount groups of a 1D problem. Past maxGroupCountX the groups wrap into
+// y, so shaders flatten with gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x and skip
+// the groups past the end of the last row.
+VkExtent2D ComputeGroupGrid( uint64_t groupCount, uint32_t maxGroupCountX );
+
+// Compute shader writes made visible to later compute shader reads and writes
+void RecordComputeBarrier( VkCommandBuffer commandBuffer );
+
+// Compute shader writes made visible to indirect draws, vertex and index fetch and graphics
+// shader reads, for a compute pass feeding the render pass that follows it
+void RecordComputeToGraphicsBarrier( VkCommandBuffer commandBuffer );
+
+// Graphics reads done before compute or transfer writes overwrite the same buffers. An
+// execution dependency only, write-after-read needs no memory barrier.
+void RecordGraphicsToComputeBarrier( VkCommandBuffer commandBuffer );
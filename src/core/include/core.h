@@ -5,7 +5,13 @@
 #include <glm/glm.hpp>
 #include <glm/mat4x4.hpp>
 
+#ifdef _WIN32
 #include <Windows.h>
+#else
+// Only the headless backend exists off Win32; the handles are never dereferenced
+typedef void* HINSTANCE;
+typedef void* HWND;
+#endif
 
 #include <iostream>
 #include <string>
@@ -16,17 +22,53 @@
 #include <limits>
 #include <algorithm>
 #include <fstream>
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
+#include <sstream>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <thread>
 
+#include <timing.h>
+#include <gputimer.h>
+#include <shadercache.h>
+#include <allocator.h>
+#include <upload.h>
+#include <asyncupload.h>
+#include <threadpool.h>
+#include <deletionqueue.h>
+#include <presentpolicy.h>
+#include <compute.h>
+#include <descriptors.h>
+#include <bindless.h>
+#include <timeline.h>
+#include <pipelinecompiler.h>
+#include <devicesnapshot.h>
+#include <startup.h>
+#include <taskgraph.h>
+
+#ifdef _WIN32
 HWND InitWindow(const HINSTANCE hInstance, const LPCTSTR windowName, const LPCTSTR windowTitle, const WNDPROC WndProc, const int width, const int height, const bool fullscreen, int showWnd);
 LRESULT CALLBACK WndProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam );
+#endif
+
+std::vector<std::string> SplitCommandLine( const std::string& commandLine );
 
 class core
 {
 public:
+    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
     struct QueueFamilyIndices
     {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        // Only set for families without graphics: a copy engine and an async compute queue
+        std::optional<uint32_t> transferFamily;
+        std::optional<uint32_t> computeFamily;
 
         bool isComplete()
         {
@@ -46,64 +88,281 @@ public:
         }
     };
 
+    // Everything one frame needs while the GPU may still be working on it. Slots are
+    // used round-robin so the CPU can record frame N+1 while frame N executes.
+    struct FrameSlot
+    {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
+        VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE;
+        VkFence inflightFence = VK_NULL_HANDLE;
+        // One pool and secondary per worker thread slot for recordParallel
+        std::vector<VkCommandPool> workerPools;
+        std::vector<VkCommandBuffer> secondaryBuffers;
+        // Number of the frame last submitted from this slot
+        uint64_t submittedFrame = 0;
+    };
+
+    // CPU phases of a frame, timed every frame into m_timing
+    enum FramePhase
+    {
+        PHASE_FRAME_PROLOG,
+        PHASE_RECORD_PROLOG,
+        PHASE_RECORD,
+        PHASE_RECORD_EPILOG,
+        PHASE_FRAME_EPILOG,
+        PHASE_FRAME,
+        PHASE_COUNT
+    };
+
     core( std::string appName ) :
         applicationName( appName )
     {
-
+#ifndef _WIN32
+        m_headless = true;
+#endif
+        initTiming();
     }
 protected:
     VkInstance GetInstance();
     VkDevice GetDevice();
     VkPhysicalDevice GetPhysicalDevice();
+    const DeviceSnapshot& GetDeviceSnapshot();
     VkCommandBuffer GetCommandBuffer();
+    VkExtent2D GetSwapchainExtent();
     void EnableValidationLayers();
+    void SetFramesInFlight( uint32_t count );
+    uint32_t FramesInFlight();
+    uint32_t CurrentFrame();
+    void SetWorkerThreads( uint32_t count );
+    uint32_t WorkerThreads();
+    ThreadPool& GetThreadPool();
+    StartupProfiler& Startup();
+    void StartupStep( const std::string& name, const std::function<void()>& work );
+    void RunStartupTasks( TaskGraph& graph );
+    void RequestSwapchainRecreate();
+    void SetPresentGoal( PresentGoal goal );
+    void RequestDeviceExtension( const char* name );
+    bool IsDeviceExtensionEnabled( const std::string& name );
+    const VkPhysicalDeviceFeatures& EnabledFeatures();
+    void EnableBindless( uint32_t imageCapacity = 16384, uint32_t bufferCapacity = 16384, uint32_t samplerCapacity = 64 );
+    bool IsBindlessEnabled();
+    BindlessHeap& GetBindlessHeap();
+    // Runs destroy once every frame that may still use the object has completed, including the
+    // one being recorded
+    void deferDestroy( std::function<void()> destroy );
+    uint64_t SubmittedFrame();
+    uint64_t CompletedFrame();
+    bool IsFrameComplete( uint64_t frame );
+    void EnableTimelineSync();
+    bool IsTimelineSyncEnabled();
+    void EnableDynamicRendering();
+    bool IsDynamicRenderingEnabled();
+    void EnablePipelineLibrary();
+    bool IsPipelineLibraryEnabled();
+    void EnableHeadless( uint32_t width, uint32_t height, uint32_t frameCount );
+    bool IsHeadless();
+    void ParseCommandLine( const std::vector<std::string>& args );
+    // The number after name in args, or defaultValue without name; a missing or malformed value
+    // throws, as it does for the options ParseCommandLine reads
+    static uint32_t ArgValue( const std::vector<std::string>& args, const std::string& name, uint32_t defaultValue );
+    TimingStats& Timing();
+    GpuTimer& GetGpuTimer();
+    DeviceAllocator& GetAllocator();
+    UploadRing& GetUploadRing();
+    uint64_t UploadStalls();
+    AsyncUploader& GetAsyncUploader();
+    DescriptorLayoutCache& GetDescriptorLayouts();
+    DescriptorAllocator& GetDescriptorAllocator();
+    void SetGraphicsPipelineLayout( const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges );
+    VkPipelineLayout GetPipelineLayout();
+    std::vector<VkPipeline> CompileGraphicsPipelines( std::vector<GraphicsPipelineDesc> descs );
+    VkPipeline GetPipelineVariant( GraphicsPipelineDesc desc );
+    PipelineCompiler& GetPipelineCompiler();
+    ShaderModuleCache& GetShaderModules();
+    PipelineTarget GetPipelineTarget();
+    VkQueue GetComputeQueue();
+    uint32_t GetComputeFamily();
     std::string ApplicationName();
 
     void createInstance();
     void createSurface(HINSTANCE hInstance, HWND window);
     void pickPhysicalDevice();
     void createLogicalDevice();
+    void chooseSwapchainFormat();
     void createSwapchain(HWND window);
+    void createOffscreenSwapchain();
+    void recreateSwapchain();
     void createImageViews();
+    void createPipelineCache();
+    void savePipelineCache();
     void createGraphicsPipeline(std::string vertSpv, std::string fragSpv);
-    void createGraphicsPipeline( std::string vertSpv, std::string fragSpv, uint32_t numVertexInputBindings, VkVertexInputBindingDescription* vertexInputBindings, uint32_t numVertexInputAttributes, VkVertexInputAttributeDescription* vertexInputAttributes );
+    void createGraphicsPipeline( std::string vertSpv, std::string fragSpv, uint32_t numVertexInputBindings, VkVertexInputBindingDescription* vertexInputBindings, uint32_t numVertexInputAttributes, VkVertexInputAttributeDescription* vertexInputAttributes,
+        const VkSpecializationInfo* vertSpecialization = nullptr, const VkSpecializationInfo* fragSpecialization = nullptr );
+    VkPipeline createComputePipeline( std::string compSpv, uint32_t numSetLayouts, VkDescriptorSetLayout* setLayouts, uint32_t pushConstantSize, VkPipelineLayout& pipelineLayout );
+    void dispatch( VkCommandBuffer commandBuffer, uint64_t groupCount );
     void createRenderPass();
     void createFramebuffers();
     void createCommandPool();
     void createCommandBuffer();
     uint32_t drawFrameProlog();
     void recordCommandBufferProlog( uint32_t imageIndex );
+    void recordCommandBufferProlog( uint32_t imageIndex, VkSubpassContents contents );
+    void recordParallel( uint32_t itemCount, const std::function<void( VkCommandBuffer, uint32_t, uint32_t )>& record, uint32_t threads = 0 );
     void recordCommandBufferEpilog();
     void drawFrameEpilog( uint32_t imageIndex);
     virtual void drawFrame();
+    virtual void recordPreRenderPass( VkCommandBuffer commandBuffer );
     void recordCommandBufferEpilog( VkCommandBuffer commandBuffer, uint32_t imageIndex );
     void createSyncObjects();
+    void createBuffer( VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& allocation );
+    void destroyBuffer( VkBuffer& buffer, Allocation& allocation );
+    void uploadBuffer( VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size );
+    void flushUploads();
     void Mainloop();
     void cleanup();
 
 private:
 
-    VkInstance m_instance;
-    VkSurfaceKHR m_surface;
-    VkPhysicalDevice m_physicalDevice;
+    VkInstance m_instance = VK_NULL_HANDLE;
+    VkSurfaceKHR m_surface = VK_NULL_HANDLE;
+    VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    // Captured by pickPhysicalDevice, read instead of querying the driver again
+    DeviceSnapshot m_deviceSnapshot;
+    QueueFamilyIndices m_queueFamilies;
+    // --device, or VKSAMPLES_DEVICE when not given
+    std::string m_deviceSelector;
     VkDevice m_device = VK_NULL_HANDLE;
     VkQueue m_presentQueue;
     VkQueue m_graphicsQueue;
-    VkSwapchainKHR m_swapchain;
+    // Dedicated queues where the device has them, the graphics queue otherwise
+    VkQueue m_transferQueue = VK_NULL_HANDLE;
+    VkQueue m_computeQueue = VK_NULL_HANDLE;
+    uint32_t m_graphicsFamily = 0;
+    uint32_t m_transferFamily = 0;
+    uint32_t m_computeFamily = 0;
+    VkSwapchainKHR m_swapchain = VK_NULL_HANDLE;
     std::vector<VkImage> m_swapchainImages;
     VkExtent2D m_swapchainExtent;
-    VkFormat m_swapchainFormat;
+    VkSurfaceFormatKHR m_surfaceFormat{};
+    VkFormat m_swapchainFormat = VK_FORMAT_UNDEFINED;
     std::vector<VkImageView> m_swapchainImageViews;
-    VkRenderPass m_renderPass;
-    VkPipelineLayout m_pipelineLayout;
-    VkPipeline m_pipeline;
+    VkRenderPass m_renderPass = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
     std::vector<VkFramebuffer> m_swapchainFramebuffers;
-    VkCommandPool m_commandPool;
-    VkCommandBuffer m_commandBuffer;
-    VkSemaphore m_imageAvailableSemaphore;
-    VkSemaphore m_renderFinishedSemaphore;
-    VkFence m_inflightFence;
+    std::vector<FrameSlot> m_frames;
+    // Number of the frame that last rendered to each swapchain image, 0 if none
+    std::vector<uint64_t> m_imageFrames;
+    uint32_t m_framesInFlight = 2;
+    uint32_t m_currentFrame = 0;
+    uint32_t m_currentImage = 0;
+
+    // Frames are numbered by submission; anything retired while frame N was the newest is
+    // destroyed once the slot that submitted N has signalled its fence
+    uint64_t m_submittedFrames = 0;
+    uint64_t m_completedFrame = 0;
+    DeletionQueue m_deletionQueue;
+    // Between drawFrameProlog and the submit in drawFrameEpilog; the frame being recorded is
+    // m_submittedFrames + 1 and may still use whatever is retired meanwhile
+    bool m_recordingFrame = false;
+
+    // Timeline backend: the graphics queue signals m_frameTimeline with the frame number and
+    // async uploads signal m_transferTimeline with their ticket, replacing slot fences and
+    // per-upload semaphores. Falls back to fences where the device lacks timeline semaphores.
+    bool m_timelineRequested = false;
+    bool m_timelineSync = false;
+    bool m_timelineKhr = false;
+    VkPhysicalDeviceTimelineSemaphoreFeatures m_timelineFeatures{};
+    TimelineSemaphore m_frameTimeline;
+    TimelineSemaphore m_transferTimeline;
+    uint32_t m_frameWaitSeries;
+    uint32_t m_imageWaitSeries;
+
+    // Swapchain recreation on resize / out-of-date. The old swapchain is passed as
+    // oldSwapchain and its views and framebuffers go through m_deletionQueue.
+    HWND m_window = nullptr;
+    VkExtent2D m_windowExtent = { 0, 0 };
+    bool m_swapchainDirty = false;
+    // Old path for comparison: vkDeviceWaitIdle and destroy everything immediately
+    bool m_recreateWaitIdle = false;
+    // Headless only: simulate a resize every N frames
+    uint32_t m_resizeEvery = 0;
+    bool m_recreatedThisFrame = false;
+    uint32_t m_swapchainRecreateSeries;
+    uint32_t m_resizeFrameSeries;
+    uint32_t m_swapchainRecreates = 0;
+
+    // Present mode picked from m_presentGoal unless a supported mode was asked for explicitly
+    PresentGoal m_presentGoal = PRESENT_POWER_SAVING;
+    std::optional<VkPresentModeKHR> m_requestedPresentMode;
+    VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
 
+    // Per-frame latency, measured from the start of drawFrameProlog where input has just been pumped
+    uint32_t m_acquireSeries;
+    uint32_t m_presentSeries;
+    uint32_t m_inputToSubmitSeries;
+    uint32_t m_inputToPresentSeries;
+
+    // Parallel recording into secondary command buffers; 0 threads means one per core
+    uint32_t m_workerThreads = 0;
+    std::unique_ptr<ThreadPool> m_threadPool;
+
+    // Headless mode replaces the surface and swapchain with a ring of plain images
+    bool m_headless = false;
+    uint32_t m_headlessFrameCount = 1000;
+    VkExtent2D m_headlessExtent = { 800, 600 };
+    VkFormat m_headlessFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    std::vector<Allocation> m_offscreenImageAllocations;
+    uint32_t m_offscreenNextImage = 0;
+
+    TimingStats m_timing;
+    // Measured from construction; --serial-init runs startup task graphs inline
+    StartupProfiler m_startup;
+    bool m_serialInit = false;
+    std::array<uint32_t, PHASE_COUNT> m_phaseSeries;
+    TimingStats::Clock::time_point m_frameStart;
+    TimingStats::Clock::time_point m_recordStart;
+    std::string m_timingJsonPath = "timing.json";
+
+    GpuTimer m_gpuTimer{ m_timing };
+    uint32_t m_renderPassScope;
+    uint32_t m_renderPassQuery = GpuTimer::INVALID_QUERY;
+
+    // Pipeline cache persisted between runs; empty path disables it
+    VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+    std::string m_pipelineCachePath = "pipeline_cache.bin";
+    bool m_pipelineCacheWarm = false;
+    uint32_t m_pipelineCreateSeries;
+    uint32_t m_pipelineBatchSeries;
+    uint32_t m_pipelineBatchPipelines = 0;
+    double m_pipelineBatchWallMs = 0.0;
+    double m_pipelineBatchCompileMs = 0.0;
+
+    ShaderModuleCache m_shaderModules;
+    PipelineCompiler m_pipelineCompiler;
+
+    DeviceAllocator m_allocator;
+
+    // Staging ring for uploads into DEVICE_LOCAL buffers, recorded at the start of every frame
+    UploadRing m_uploadRing;
+    VkDeviceSize m_uploadRingSize = UploadRing::DEFAULT_SIZE;
+    uint64_t m_uploadStalls = 0;
+    VkCommandPool m_uploadCommandPool = VK_NULL_HANDLE;
+    VkCommandBuffer m_uploadCommandBuffer = VK_NULL_HANDLE;
+
+    // Large uploads on the transfer queue, handed to the graphics queue when done
+    AsyncUploader m_asyncUploader;
+    std::vector<VkSemaphore> m_submitWaitSemaphores;
+    std::vector<VkPipelineStageFlags> m_submitWaitStages;
+    std::vector<uint64_t> m_submitWaitValues;
+
+    // Layouts are shared and owned by the cache; per-frame sets come from pools reset with their slot
+    DescriptorLayoutCache m_descriptorLayouts;
+    DescriptorAllocator m_descriptorAllocator;
+    std::vector<VkDescriptorSetLayout> m_graphicsSetLayouts;
+    std::vector<VkPushConstantRange> m_graphicsPushConstantRanges;
 
 
     const std::vector<const char*> m_validationLayers = {
@@ -112,27 +371,79 @@ private:
 
     const std::vector<const char*> m_instanceExtensions = {
         VK_KHR_SURFACE_EXTENSION_NAME,
+#ifdef _WIN32
         VK_KHR_WIN32_SURFACE_EXTENSION_NAME
+#endif
     };
 
     const std::vector<const char*> m_deviceExtensions = {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
 
+    // Enabled only where supported, samples check IsDeviceExtensionEnabled before using them
+    std::vector<const char*> m_optionalDeviceExtensions;
+    std::set<std::string> m_enabledDeviceExtensions;
+    VkPhysicalDeviceFeatures m_enabledFeatures{};
+    uint32_t m_maxComputeGroupCountX = 65535;
+    // Instance version, 1.2 where the loader has it; the device may still be older
+    uint32_t m_apiVersion = VK_API_VERSION_1_0;
+
+    // Bindless mode: one update-after-bind set of everything, needs descriptor indexing
+    bool m_bindlessRequested = false;
+    bool m_bindlessEnabled = false;
+    uint32_t m_bindlessImages = 0;
+    uint32_t m_bindlessBuffers = 0;
+    uint32_t m_bindlessSamplers = 0;
+    VkPhysicalDeviceDescriptorIndexingFeatures m_descriptorIndexingFeatures{};
+    BindlessHeap m_bindless;
+
+    // Dynamic rendering: no render pass or framebuffers, the prolog begins rendering straight
+    // on the image view and transitions the image itself. Needs VK_KHR_dynamic_rendering.
+    bool m_dynamicRenderingRequested = false;
+    bool m_dynamicRendering = false;
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR m_dynamicRenderingFeatures{};
+    PFN_vkCmdBeginRenderingKHR m_cmdBeginRendering = nullptr;
+    PFN_vkCmdEndRenderingKHR m_cmdEndRendering = nullptr;
+
+    // Pipeline libraries: createGraphicsPipeline fast-links precompiled parts and swaps in the
+    // optimized link once it finishes in the background
+    bool m_pipelineLibraryRequested = false;
+    bool m_pipelineLibrary = false;
+    bool m_pipelineLibraryFastLinking = false;
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT m_pipelineLibraryFeatures{};
+    std::future<VkPipeline> m_optimizedPipeline;
+    TimingStats::Clock::time_point m_optimizedPipelineStart;
+
     bool enableValidationLayers = false;
 
     std::string applicationName;
 
+    void initTiming();
+    void recordDefaultState( VkCommandBuffer commandBuffer );
+    void writeTimingReport();
     bool checkValidationLayerSupport();
+    std::vector<const char*> requiredInstanceExtensions();
+    std::vector<const char*> requiredDeviceExtensions();
     bool checkInstanceExtensionSupport();
-    QueueFamilyIndices findQueueFamilies( VkPhysicalDevice device );
+    QueueFamilyIndices findQueueFamilies( const DeviceSnapshot& device );
     SwapchainSupportDetails querySwapchainSupport( VkPhysicalDevice device );
-    bool isDeviceSuitable( VkPhysicalDevice device );
-    bool checkDeviceExtensionSupport( VkPhysicalDevice device );
+    bool isDeviceSuitable( const DeviceSnapshot& device );
+    bool checkDeviceExtensionSupport( const DeviceSnapshot& device );
+    uint32_t deviceApiVersion();
+    bool enableTimelineSemaphores( const std::vector<VkExtensionProperties>& availableExtensions, std::vector<const char*>& deviceExtensions, void*& featureChain );
+    void waitForFrame( uint64_t frame );
+    bool enableGraphicsPipelineLibrary( const std::vector<VkExtensionProperties>& availableExtensions, std::vector<const char*>& deviceExtensions, void*& featureChain );
+    void swapInOptimizedPipeline();
+    bool enableDynamicRendering( const std::vector<VkExtensionProperties>& availableExtensions, std::vector<const char*>& deviceExtensions, void*& featureChain );
+    void transitionSwapchainImage( VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout,
+        VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess );
+    bool enableDescriptorIndexing( const std::vector<VkExtensionProperties>& availableExtensions, std::vector<const char*>& deviceExtensions, void*& featureChain );
     VkSurfaceFormatKHR chooseSwapSurfaceFormat( const std::vector<VkSurfaceFormatKHR> availableFormats );
     VkPresentModeKHR chooseSwapPresentMode( const std::vector<VkPresentModeKHR> availablePresentModes );
     VkExtent2D chooseSwapExtent( HWND window, VkSurfaceCapabilitiesKHR& capabilities );
+    uint32_t findMemoryType( uint32_t typeFilter, VkMemoryPropertyFlags properties );
     std::vector<char> readFile( const std::string& fileName );
-    VkShaderModule createShaderModule( const std::vector<char> code );
+    bool isPipelineCacheCompatible( const std::vector<char>& data );
+    VkShaderModule createShaderModule( const std::string& spvPath );
 
 };
\ No newline at end of file
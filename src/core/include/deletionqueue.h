@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+// Destroys GPU objects once the last frame that may still use them has completed, instead of
+// idling the device. Frames are numbered in submission order; entries are pushed with the
+// newest submitted frame number and run once the caller reports that frame as complete.
+class DeletionQueue
+{
+public:
+    void push( uint64_t lastUseFrame, std::function<void()> destroy );
+
+    // Runs every entry whose frame is at or below completedFrame
+    void collect( uint64_t completedFrame );
+
+    // Runs everything. Only valid once the device is idle.
+    void flush();
+
+    size_t size() const;
+
+private:
+    // Frame numbers only grow, so entries stay sorted and collect() pops from the front
+    std::deque<std::pair<uint64_t, std::function<void()>>> m_entries;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <objectkey.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Owns every VkDescriptorSetLayout and VkPipelineLayout, keyed by their contents. Asking twice
+// for the same bindings or the same set layouts and push constant ranges returns the same
+// handle, so pipelines built from equal descriptions share layouts and stay compatible for
+// vkCmdBindDescriptorSets. Immutable samplers are not supported.
+class DescriptorLayoutCache
+{
+public:
+    void init( VkDevice device );
+    void destroy();
+
+    // bindingFlags is empty or has one VkDescriptorBindingFlags per entry of bindings
+    VkDescriptorSetLayout getSetLayout( const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutCreateFlags flags = 0,
+        const std::vector<VkDescriptorBindingFlags>& bindingFlags = {} );
+    VkPipelineLayout getPipelineLayout( const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges );
+
+    uint32_t setLayoutCount() const;
+    uint32_t pipelineLayoutCount() const;
+
+private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::unordered_map<ObjectKey, VkDescriptorSetLayout, ObjectKeyHash> m_setLayouts;
+    std::unordered_map<ObjectKey, VkPipelineLayout, ObjectKeyHash> m_pipelineLayouts;
+};
+
+// Descriptor sets that live for one frame. Every frame slot takes pools from a shared free
+// list and hands them all back with one vkResetDescriptorPool each when the slot comes round,
+// so sets are never freed one by one. A full pool is replaced by the next free one or a new,
+// twice as large one. allocate() may be called from recordParallel workers.
+class DescriptorAllocator
+{
+public:
+    static constexpr uint32_t INITIAL_SETS_PER_POOL = 256;
+    static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+    struct Stats
+    {
+        uint64_t setsAllocated = 0;
+        uint64_t poolsCreated = 0;
+        uint64_t poolResets = 0;
+        // Sets allocated by the last frame that began, and the most any frame has used
+        uint32_t frameSets = 0;
+        uint32_t peakFrameSets = 0;
+    };
+
+    void init( VkDevice device, uint32_t frameSlots );
+    void destroy();
+
+    // Resets the pools the slot used last time around. Its fence must have signalled.
+    void beginFrame( uint32_t slot );
+
+    VkDescriptorSet allocate( VkDescriptorSetLayout layout );
+
+    const Stats& stats() const;
+
+private:
+    struct Slot
+    {
+        std::vector<VkDescriptorPool> usedPools;
+        VkDescriptorPool currentPool = VK_NULL_HANDLE;
+        uint32_t sets = 0;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::vector<Slot> m_slots;
+    uint32_t m_currentSlot = 0;
+    std::vector<VkDescriptorPool> m_freePools;
+    std::vector<VkDescriptorPool> m_allPools;
+    uint32_t m_setsPerPool = INITIAL_SETS_PER_POOL;
+    std::mutex m_mutex;
+    Stats m_stats;
+
+    VkDescriptorPool takePool();
+};
+
+// Collects buffer and image writes for one descriptor set and applies them with a single
+// vkUpdateDescriptorSets. Keeps its storage between sets, so a writer reused for every set
+// of a frame stops allocating once it has seen the largest set.
+class DescriptorWriter
+{
+public:
+    DescriptorWriter& writeBuffer( uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE );
+    DescriptorWriter& writeImage( uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler, VkImageLayout layout );
+
+    // Writes everything collected so far into set and clears the writer
+    void update( VkDevice device, VkDescriptorSet set );
+    void clear();
+
+private:
+    // Infos are referenced by index until update(), as the vectors may still reallocate
+    struct Write
+    {
+        uint32_t binding;
+        VkDescriptorType type;
+        bool image;
+        size_t info;
+    };
+
+    std::vector<Write> m_writes;
+    std::vector<VkDescriptorBufferInfo> m_bufferInfos;
+    std::vector<VkDescriptorImageInfo> m_imageInfos;
+    std::vector<VkWriteDescriptorSet> m_vkWrites;
+};
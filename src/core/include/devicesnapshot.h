@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What a physical device reports about itself, queried once when the device is enumerated.
+// Hot paths read this instead of asking the driver again; none of it changes for the lifetime
+// of the instance. Surface dependent state (present support, swapchain formats) is not in here.
+struct DeviceSnapshot
+{
+    // Orders devices for automatic selection: device type first (discrete, integrated,
+    // virtual, other, CPU), then the largest device local heap, then how many of the optional
+    // features core enables are supported
+    struct Score
+    {
+        uint32_t typeRank = 0;
+        VkDeviceSize deviceLocalBytes = 0;
+        uint32_t features = 0;
+
+        bool operator<( const Score& other ) const;
+    };
+
+    VkPhysicalDevice device = VK_NULL_HANDLE;
+    // Position in vkEnumeratePhysicalDevices order
+    uint32_t index = 0;
+    VkPhysicalDeviceProperties properties{};
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    VkPhysicalDeviceFeatures features{};
+    std::vector<VkQueueFamilyProperties> queueFamilies;
+    std::vector<VkExtensionProperties> extensions;
+    // From VkPhysicalDeviceIDProperties, only when the device and instance are Vulkan 1.1
+    bool hasUuid = false;
+    uint8_t uuid[VK_UUID_SIZE] = {};
+
+    // instanceApiVersion decides whether vkGetPhysicalDeviceProperties2 may be called
+    static DeviceSnapshot capture( VkPhysicalDevice device, uint32_t index, uint32_t instanceApiVersion );
+
+    bool hasExtension( const char* name ) const;
+    VkDeviceSize largestDeviceLocalHeap() const;
+    Score score() const;
+
+    // 32 hex digits, or empty without a UUID
+    std::string uuidString() const;
+    static const char* typeName( VkPhysicalDeviceType type );
+
+    // selector is an enumeration index, a UUID (dashes optional) or part of the device name,
+    // case insensitive
+    bool matches( const std::string& selector ) const;
+};
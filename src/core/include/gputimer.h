@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <devicesnapshot.h>
+#include <timing.h>
+
+#include <string>
+#include <vector>
+
+// Timestamp-query based GPU timers. Every frame slot owns a range of a shared query pool.
+// Results are collected when the slot comes around again, after its fence has signalled,
+// so reading them never waits on the GPU. Durations land in TimingStats as "gpu.<name>".
+class GpuTimer
+{
+public:
+    static constexpr uint32_t MAX_QUERIES_PER_FRAME = 64;
+    static constexpr uint32_t INVALID_QUERY = UINT32_MAX;
+
+    GpuTimer( TimingStats& stats ) :
+        m_stats( stats )
+    {
+    }
+
+    void init( VkDevice device, const DeviceSnapshot& physicalDevice, uint32_t queueFamily, uint32_t frameSlots );
+    void destroy();
+    bool isSupported() const;
+
+    uint32_t registerScope( const std::string& name );
+
+    // Collects the slot's previous results and resets its queries. Must be recorded
+    // outside a render pass, before any begin()/end() for this slot.
+    void beginFrame( VkCommandBuffer commandBuffer, uint32_t slot );
+
+    uint32_t begin( VkCommandBuffer commandBuffer, uint32_t scope );
+    void end( VkCommandBuffer commandBuffer, uint32_t query );
+
+private:
+    struct PendingScope
+    {
+        uint32_t scope;
+        uint32_t query;
+    };
+
+    struct SlotQueries
+    {
+        uint32_t used = 0;
+        std::vector<PendingScope> scopes;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkQueryPool m_queryPool = VK_NULL_HANDLE;
+    TimingStats& m_stats;
+    double m_timestampPeriod = 1.0;
+    uint64_t m_timestampMask = ~0ull;
+    std::vector<SlotQueries> m_slots;
+    std::vector<uint32_t> m_scopeSeries;
+    std::vector<uint64_t> m_results;
+    uint32_t m_currentSlot = 0;
+
+    void collect( uint32_t slot );
+};
+
+// Brackets the commands recorded during its lifetime with a pair of timestamps
+class GpuScope
+{
+public:
+    GpuScope( GpuTimer& timer, VkCommandBuffer commandBuffer, uint32_t scope ) :
+        m_timer( timer ),
+        m_commandBuffer( commandBuffer ),
+        m_query( timer.begin( commandBuffer, scope ) )
+    {
+    }
+
+    ~GpuScope()
+    {
+        m_timer.end( m_commandBuffer, m_query );
+    }
+
+private:
+    GpuTimer& m_timer;
+    VkCommandBuffer m_commandBuffer;
+    uint32_t m_query;
+};
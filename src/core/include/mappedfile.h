@@ -0,0 +1,40 @@
+#pragma once
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The contents are used in place, nothing is copied.
+class MappedFile
+{
+public:
+    MappedFile( const std::string& path );
+    ~MappedFile();
+
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile& operator=( const MappedFile& ) = delete;
+
+    const void* data() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+private:
+    const void* m_data = nullptr;
+    size_t m_size = 0;
+
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
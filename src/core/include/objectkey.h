@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A create info flattened into words: the fields that matter, one uint64_t each. Used by the
+// caches that hand out one Vulkan object per distinct description.
+struct ObjectKey
+{
+    std::vector<uint64_t> words;
+
+    bool operator==( const ObjectKey& other ) const
+    {
+        return words == other.words;
+    }
+};
+
+struct ObjectKeyHash
+{
+    size_t operator()( const ObjectKey& key ) const;
+};
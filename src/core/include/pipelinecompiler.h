@@ -0,0 +1,168 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <objectkey.h>
+#include <shadercache.h>
+#include <threadpool.h>
+
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Values for a stage's specialization constants, by constant_id. Entries are kept sorted by id
+// and the values are copied, so equal constants compare equal and a description owns what its
+// VkSpecializationInfo points to.
+struct SpecializationConstants
+{
+    std::vector<VkSpecializationMapEntry> entries;
+    std::vector<uint8_t> data;
+
+    SpecializationConstants() = default;
+    // Copies an existing VkSpecializationInfo, nullptr gives no constants
+    explicit SpecializationConstants( const VkSpecializationInfo* info );
+
+    SpecializationConstants& set( uint32_t constantId, const void* value, size_t size );
+    SpecializationConstants& setInt( uint32_t constantId, int32_t value );
+    SpecializationConstants& setUint( uint32_t constantId, uint32_t value );
+    SpecializationConstants& setFloat( uint32_t constantId, float value );
+    SpecializationConstants& setBool( uint32_t constantId, bool value );
+
+    bool empty() const;
+    // Points into this object, valid until it is modified
+    VkSpecializationInfo info() const;
+};
+
+// Shaders and fixed function state of one graphics pipeline. Viewport and scissor are always
+// dynamic, so a description does not depend on the target size.
+struct GraphicsPipelineDesc
+{
+    std::string vertSpv;
+    std::string fragSpv;
+    SpecializationConstants vertConstants;
+    SpecializationConstants fragConstants;
+    std::vector<VkVertexInputBindingDescription> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+    bool blendEnable = false;
+    // core::CompileGraphicsPipelines fills in the graphics pipeline layout when left null
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+};
+
+// What pipelines render into: a render pass, or with dynamic rendering (no render pass) the
+// color attachment format
+struct PipelineTarget
+{
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+};
+
+// Compiles graphics pipelines against one pipeline cache. vkCreateGraphicsPipelines and the
+// cache are thread safe, so a batch is spread over a thread pool, one pipeline per task.
+//
+// With VK_EXT_graphics_pipeline_library a description is split into its vertex input,
+// pre-rasterization, fragment shader and fragment output parts. Each part is compiled once into
+// a library and shared by every description that has the same part; link() then only links
+// four libraries. A link without optimization is fast but may run slower on the GPU, so the
+// optimized link is meant to be done in the background and swapped in once it is ready.
+//
+// getVariant() keeps the pipelines it compiles, keyed by the whole description including the
+// specialization constants, so every shader and constant combination is compiled once.
+class PipelineCompiler
+{
+public:
+    struct BatchStats
+    {
+        uint32_t pipelines = 0;
+        uint32_t threads = 0;
+        double wallMs = 0.0;
+        // Sum and maximum of the per-pipeline vkCreateGraphicsPipelines times
+        double compileMs = 0.0;
+        double slowestMs = 0.0;
+    };
+
+    struct VariantStats
+    {
+        uint32_t variants = 0;
+        uint32_t hits = 0;
+        double compileMs = 0.0;
+    };
+
+    struct LibraryStats
+    {
+        uint32_t parts = 0;
+        double partCompileMs = 0.0;
+        uint32_t fastLinks = 0;
+        double fastLinkMs = 0.0;
+        uint32_t optimizedLinks = 0;
+        double optimizedLinkMs = 0.0;
+    };
+
+    enum Part
+    {
+        PART_VERTEX_INPUT,
+        PART_PRE_RASTERIZATION,
+        PART_FRAGMENT_SHADER,
+        PART_FRAGMENT_OUTPUT,
+        PART_COUNT
+    };
+
+    // cache may be VK_NULL_HANDLE to compile every pipeline from scratch
+    void init( VkDevice device, VkPipelineCache cache, ShaderModuleCache& shaders );
+    // Destroys the library parts and variants; other pipelines belong to the caller
+    void destroy();
+
+    VkPipeline compile( const GraphicsPipelineDesc& desc, const PipelineTarget& target, double* compileMs = nullptr );
+
+    // Pipelines come back in description order and belong to the caller. Runs inline when pool
+    // is null. If any compile fails the others are destroyed and the error is rethrown.
+    std::vector<VkPipeline> compileBatch( const std::vector<GraphicsPipelineDesc>& descs, const PipelineTarget& target, ThreadPool* pool, BatchStats& stats );
+
+    // The cached pipeline for the description, compiled on first use. Thread safe; the pipeline
+    // belongs to the compiler.
+    VkPipeline getVariant( const GraphicsPipelineDesc& desc, const PipelineTarget& target );
+    VariantStats variantStats();
+
+    // Needs VK_EXT_graphics_pipeline_library enabled on the device
+    void useLibraries();
+    bool usesLibraries() const;
+
+    // Compiles the parts of every description that are not in the library yet, on the pool
+    // or inline when pool is null
+    void precompileLibraries( const std::vector<GraphicsPipelineDesc>& descs, const PipelineTarget& target, ThreadPool* pool );
+
+    // Links the description's parts, compiling missing ones first. Thread safe.
+    VkPipeline link( const GraphicsPipelineDesc& desc, const PipelineTarget& target, bool optimize, double* linkMs = nullptr );
+
+    // The optimized link on its own thread. The caller owns the pipeline and must get() the
+    // future before destroy().
+    std::future<VkPipeline> linkOptimizedAsync( const GraphicsPipelineDesc& desc, const PipelineTarget& target );
+
+    LibraryStats libraryStats();
+
+private:
+    // Every create info of a monolithic pipeline, filled from a description; the library
+    // parts take the subsets they need
+    struct State;
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkPipelineCache m_cache = VK_NULL_HANDLE;
+    ShaderModuleCache* m_shaders = nullptr;
+
+    bool m_libraries = false;
+    std::mutex m_mutex;
+    std::unordered_map<ObjectKey, VkPipeline, ObjectKeyHash> m_parts;
+    LibraryStats m_libraryStats;
+    std::unordered_map<ObjectKey, VkPipeline, ObjectKeyHash> m_variants;
+    VariantStats m_variantStats;
+
+    void fillState( const GraphicsPipelineDesc& desc, const PipelineTarget& target, State& state );
+    ObjectKey partKey( Part part, const GraphicsPipelineDesc& desc, const PipelineTarget& target );
+    VkPipeline compilePart( Part part, const GraphicsPipelineDesc& desc, const PipelineTarget& target );
+    VkPipeline getPart( Part part, const GraphicsPipelineDesc& desc, const PipelineTarget& target );
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+
+// What the application wants from presentation. Each goal maps to an ordered list of present
+// modes, the first one the surface supports wins. FIFO is always supported and ends every list.
+enum PresentGoal
+{
+    // MAILBOX, IMMEDIATE, FIFO_RELAXED: newest frame on screen soonest, tearing as a last resort
+    PRESENT_LOW_LATENCY,
+    // IMMEDIATE, MAILBOX: never block on vblank
+    PRESENT_THROUGHPUT,
+    // FIFO: one frame per vblank, the CPU and GPU sleep in between
+    PRESENT_POWER_SAVING
+};
+
+VkPresentModeKHR ChoosePresentMode( PresentGoal goal, const std::vector<VkPresentModeKHR>& availableModes );
+
+// An explicitly requested mode, falling back to the goal when the surface does not support it
+VkPresentModeKHR ChoosePresentMode( VkPresentModeKHR requested, PresentGoal goal, const std::vector<VkPresentModeKHR>& availableModes );
+
+const char* PresentModeName( VkPresentModeKHR mode );
+const char* PresentGoalName( PresentGoal goal );
+
+// Parse "latency" / "throughput" / "power" and "fifo" / "fifo_relaxed" / "mailbox" / "immediate"
+PresentGoal ParsePresentGoal( const std::string& name );
+VkPresentModeKHR ParsePresentMode( const std::string& name );
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <mappedfile.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Shader modules shared by every pipeline core builds. Modules are keyed by a hash of their
+// SPIR-V, so the same code reached through different paths still yields a single module; the
+// code is kept to tell a real match from a hash collision. Files are memory mapped, handed to
+// the driver in place and stay mapped for that comparison. get() is thread safe, so pipelines
+// can be compiled on several threads.
+class ShaderModuleCache
+{
+public:
+    struct Stats
+    {
+        uint64_t bytesMapped = 0;
+        uint32_t filesMapped = 0;
+        uint32_t modulesCreated = 0;
+        uint32_t cacheHits = 0;
+    };
+
+    void init( VkDevice device );
+    void destroy();
+
+    VkShaderModule get( const std::string& spvPath );
+    VkShaderModule get( const uint32_t* code, size_t size );
+
+    const Stats& stats() const;
+
+    static uint64_t hash( const uint32_t* code, size_t size );
+
+private:
+    struct Entry
+    {
+        VkShaderModule module;
+        // Points into mapping for modules loaded from a file, into copy otherwise
+        const uint32_t* code;
+        size_t size;
+        std::unique_ptr<MappedFile> mapping;
+        std::vector<uint32_t> copy;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::unordered_map<uint64_t, Entry> m_modules;
+    std::unordered_map<std::string, VkShaderModule> m_paths;
+    std::vector<VkShaderModule> m_uncached;
+    Stats m_stats;
+    std::mutex m_mutex;
+
+    VkShaderModule getLocked( const uint32_t* code, size_t size, std::unique_ptr<MappedFile> mapping );
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <timing.h>
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Wall clock profile of application startup. Steps are kept with their start offset from when
+// the profiler was created, their duration and the worker that ran them, so overlapping steps
+// of a parallel startup show up as such. Recording is thread safe.
+class StartupProfiler
+{
+public:
+    struct Step
+    {
+        std::string name;
+        double startMs = 0.0;
+        double durationMs = 0.0;
+        uint32_t worker = 0;
+    };
+
+    StartupProfiler();
+
+    // Runs work and records it as one step
+    void step( const std::string& name, const std::function<void()>& work, uint32_t worker = 0 );
+    void record( const std::string& name, TimingStats::Clock::time_point start, TimingStats::Clock::time_point end, uint32_t worker = 0 );
+
+    // The first call wins; returns whether this was it
+    bool markFirstFrame();
+    bool firstFrameMarked() const;
+    double firstFrameMs() const;
+
+    // Steps ordered by start time
+    std::vector<Step> steps() const;
+    // Sum of the step durations, larger than the wall time when steps overlapped
+    double busyMs() const;
+
+    void report( std::ostream& out ) const;
+
+private:
+    TimingStats::Clock::time_point m_start;
+    mutable std::mutex m_mutex;
+    std::vector<Step> m_steps;
+    bool m_firstFrameMarked = false;
+    double m_firstFrameMs = 0.0;
+
+    double sinceStart( TimingStats::Clock::time_point time ) const;
+};
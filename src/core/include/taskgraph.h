@@ -0,0 +1,41 @@
+#pragma once
+
+#include <startup.h>
+#include <threadpool.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Tasks with dependencies, each started as soon as all of its dependencies have finished. A task
+// may only depend on tasks added before it, so the order they were added in is always a valid
+// serial order. Tasks that share state which is not thread safe must be ordered by a
+// dependency; the graph knows nothing else about what they touch.
+class TaskGraph
+{
+public:
+    using TaskId = uint32_t;
+
+    TaskId add( const std::string& name, std::function<void()> work, const std::vector<TaskId>& dependencies = {} );
+    uint32_t size() const;
+
+    // Runs every task on the pool's threads, the calling thread included, or inline in the
+    // order added when pool is null. Tasks are timed into profiler when one is given. After a
+    // task throws, tasks that have not started yet are skipped and the first exception is
+    // rethrown once the running ones are done. Tasks must not use the pool themselves.
+    void run( ThreadPool* pool, StartupProfiler* profiler = nullptr );
+
+private:
+    struct Task
+    {
+        std::string name;
+        std::function<void()> work;
+        std::vector<TaskId> dependents;
+        uint32_t dependencyCount = 0;
+    };
+
+    std::vector<Task> m_tasks;
+
+    void runTask( const Task& task, StartupProfiler* profiler, uint32_t worker );
+};
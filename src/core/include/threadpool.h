@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for fork/join work. run() hands out task indices to the workers
+// and the calling thread, and returns once every task has finished. Worker indices are stable,
+// so tasks can own per-worker state such as command pools.
+class ThreadPool
+{
+public:
+    // threadCount includes the calling thread, so 1 runs everything inline
+    explicit ThreadPool( uint32_t threadCount );
+    ~ThreadPool();
+
+    ThreadPool( const ThreadPool& ) = delete;
+    ThreadPool& operator=( const ThreadPool& ) = delete;
+
+    uint32_t size() const;
+
+    // Calls task( taskIndex, workerIndex ) for every taskIndex below taskCount. The first
+    // exception thrown by a task is rethrown here once all tasks are done.
+    void run( uint32_t taskCount, const std::function<void( uint32_t, uint32_t )>& task );
+
+private:
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    const std::function<void( uint32_t, uint32_t )>* m_task = nullptr;
+    uint32_t m_taskCount = 0;
+    std::atomic<uint32_t> m_nextTask{ 0 };
+    uint32_t m_pendingTasks = 0;
+    // Workers that picked up the current generation and have not checked out yet
+    uint32_t m_activeWorkers = 0;
+    uint64_t m_generation = 0;
+    bool m_stop = false;
+    std::exception_ptr m_error;
+
+    void workerLoop( uint32_t workerIndex );
+    void runTasks( uint32_t workerIndex );
+};
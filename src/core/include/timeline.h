@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// A timeline semaphore signalled by one queue with increasing values, e.g. frame numbers on the
+// graphics queue or upload tickets on the transfer queue. Values signalled from one queue in
+// submission order only ever grow, which is what the timeline requires. The entry points come
+// from Vulkan 1.2 or VK_KHR_timeline_semaphore, whichever the device was created with.
+class TimelineSemaphore
+{
+public:
+    void init( VkDevice device, bool khr );
+    void destroy();
+
+    VkSemaphore semaphore() const;
+
+    // Highest value the GPU has signalled so far; asks the device, never blocks
+    uint64_t completedValue();
+    bool isComplete( uint64_t value );
+
+    // Blocks until value is signalled. Returns right away, without a device call, if it already was.
+    void wait( uint64_t value );
+
+private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkSemaphore m_semaphore = VK_NULL_HANDLE;
+    uint64_t m_completed = 0;
+    PFN_vkGetSemaphoreCounterValueKHR m_getCounterValue = nullptr;
+    PFN_vkWaitSemaphoresKHR m_waitSemaphores = nullptr;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Fixed-size ring of timing samples for one series. There is a single writer (the thread
+// that owns the series) and the only shared state is the write index, so pushing a sample
+// is a store plus a release increment. Once more than CAPACITY samples have been pushed
+// the oldest ones are overwritten and statistics cover the most recent CAPACITY.
+class TimingRing
+{
+public:
+    static constexpr uint32_t CAPACITY = 4096;
+
+    void push( float value )
+    {
+        const uint64_t index = m_writeIndex.load( std::memory_order_relaxed );
+        m_samples[index % CAPACITY] = value;
+        m_writeIndex.store( index + 1, std::memory_order_release );
+    }
+
+    uint64_t count() const
+    {
+        return m_writeIndex.load( std::memory_order_acquire );
+    }
+
+    std::vector<float> snapshot() const;
+
+private:
+    std::array<float, CAPACITY> m_samples{};
+    std::atomic<uint64_t> m_writeIndex{ 0 };
+};
+
+// Named timing series with percentile reporting. Series are registered up front and then
+// addressed by index so recording on the hot path never touches a string or a map.
+class TimingStats
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Summary
+    {
+        std::string name;
+        uint64_t count = 0;
+        double mean = 0.0;
+        double min = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    uint32_t addSeries( const std::string& name );
+    uint32_t findSeries( const std::string& name ) const;
+
+    // Values are in milliseconds
+    void record( uint32_t series, double milliseconds )
+    {
+        m_series[series]->samples.push( static_cast< float >( milliseconds ) );
+    }
+
+    void record( uint32_t series, Clock::time_point start, Clock::time_point end )
+    {
+        record( series, std::chrono::duration<double, std::milli>( end - start ).count() );
+    }
+
+    void setInfo( const std::string& key, const std::string& value );
+
+    Summary summarize( uint32_t series ) const;
+    void writeJson( std::ostream& out ) const;
+    void writeJson( const std::string& path ) const;
+
+    static constexpr uint32_t INVALID_SERIES = UINT32_MAX;
+
+private:
+    struct Series
+    {
+        std::string name;
+        TimingRing samples;
+    };
+
+    std::vector<std::unique_ptr<Series>> m_series;
+    std::vector<std::pair<std::string, std::string>> m_info;
+};
+
+// Records the lifetime of the scope into a series
+class ScopedTiming
+{
+public:
+    ScopedTiming( TimingStats& stats, uint32_t series ) :
+        m_stats( stats ),
+        m_series( series ),
+        m_start( TimingStats::Clock::now() )
+    {
+    }
+
+    ~ScopedTiming()
+    {
+        m_stats.record( m_series, m_start, TimingStats::Clock::now() );
+    }
+
+private:
+    TimingStats& m_stats;
+    uint32_t m_series;
+    TimingStats::Clock::time_point m_start;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <allocator.h>
+
+#include <cstdint>
+#include <vector>
+
+// Streams data into DEVICE_LOCAL buffers through one persistently mapped staging buffer used
+// as a ring. upload() only memcpys into the ring and queues a VkBufferCopy; record() emits all
+// queued copies into a frame's command buffer. The bytes a frame slot used are handed back
+// when that slot comes around again, after its fence has signalled.
+class UploadRing
+{
+public:
+    static constexpr VkDeviceSize DEFAULT_SIZE = 16ull * 1024 * 1024;
+
+    struct Stats
+    {
+        uint64_t bytesUploaded = 0;
+        uint64_t copies = 0;
+        uint64_t flushes = 0;
+    };
+
+    void init( VkDevice device, DeviceAllocator& allocator, VkDeviceSize size, VkDeviceSize alignment, uint32_t frameSlots );
+    void destroy();
+
+    // Releases the ring space the slot's previous copies used. Its fence must have signalled.
+    void beginFrame( uint32_t slot );
+
+    // Returns false when the ring has no room left for size bytes; nothing is queued then
+    bool upload( VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size );
+    bool hasPending() const;
+
+    // Records the queued copies between barriers against vertex, index, uniform and shader
+    // reads. Must be recorded outside a render pass. The space stays owned by slot.
+    void record( VkCommandBuffer commandBuffer, uint32_t slot );
+
+    // Makes the whole ring available again. Only valid once the queue is idle.
+    void reset();
+
+    VkDeviceSize capacity() const;
+    const Stats& stats() const;
+
+private:
+    struct PendingCopy
+    {
+        VkBuffer dst;
+        VkBufferCopy region;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    DeviceAllocator* m_allocator = nullptr;
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    Allocation m_allocation;
+    VkDeviceSize m_capacity = 0;
+    VkDeviceSize m_alignment = 1;
+
+    // Monotonic byte counters, wrap padding included. written - released is what's in use.
+    uint64_t m_written = 0;
+    uint64_t m_released = 0;
+    // m_written at the time each slot last recorded its copies
+    std::vector<uint64_t> m_slotMarkers;
+
+    std::vector<PendingCopy> m_pending;
+    Stats m_stats;
+};
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+// Vertex layouts described as types, with the Vulkan vertex input descriptions generated from
+// them at compile time:
+//
+//     using Interleaved = VertexLayout<VertexStream<VertexAttribute<0, Half4>, VertexAttribute<1, Unorm8x4>>>;
+//     using Split = VertexLayout<VertexStream<VertexAttribute<0, Half4>>, VertexStream<VertexAttribute<1, Unorm8x4>>>;
+//
+// Every stream is one binding, numbered in order, its attributes packed back to back in the
+// order listed. Layout::bindings and Layout::attributes go straight into a pipeline, and
+// Layout::write puts a value where the layout says its location lives.
+
+// Storage types for quantized attributes. The shader sees floats either way: SFLOAT and
+// UNORM/SNORM formats are converted by the vertex fetch.
+struct Half2
+{
+    uint16_t x, y;
+};
+
+struct Half4
+{
+    uint16_t x, y, z, w;
+};
+
+struct Unorm8x4
+{
+    uint8_t r, g, b, a;
+};
+
+// A unit vector folded onto the octahedron, two snorm components; decoded in the shader
+struct Octahedral16
+{
+    int16_t x, y;
+};
+
+template<typename T>
+struct VertexFormat;
+
+template<> struct VertexFormat<float> { static constexpr VkFormat format = VK_FORMAT_R32_SFLOAT; };
+template<> struct VertexFormat<glm::vec2> { static constexpr VkFormat format = VK_FORMAT_R32G32_SFLOAT; };
+template<> struct VertexFormat<glm::vec3> { static constexpr VkFormat format = VK_FORMAT_R32G32B32_SFLOAT; };
+template<> struct VertexFormat<glm::vec4> { static constexpr VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT; };
+template<> struct VertexFormat<Half2> { static constexpr VkFormat format = VK_FORMAT_R16G16_SFLOAT; };
+template<> struct VertexFormat<Half4> { static constexpr VkFormat format = VK_FORMAT_R16G16B16A16_SFLOAT; };
+template<> struct VertexFormat<Unorm8x4> { static constexpr VkFormat format = VK_FORMAT_R8G8B8A8_UNORM; };
+template<> struct VertexFormat<Octahedral16> { static constexpr VkFormat format = VK_FORMAT_R16G16_SNORM; };
+
+template<uint32_t Location, typename T>
+struct VertexAttribute
+{
+    using Type = T;
+    static constexpr uint32_t location = Location;
+    static constexpr VkFormat format = VertexFormat<T>::format;
+
+    // Keeps every offset a multiple of 4, which is what fetch units are happy with
+    static_assert( sizeof( T ) % 4 == 0, "Vertex attributes must be a multiple of 4 bytes" );
+};
+
+template<typename... Attributes>
+struct VertexStream
+{
+    static constexpr uint32_t attributeCount = sizeof...( Attributes );
+    static constexpr uint32_t stride = ( 0 + ... + static_cast< uint32_t >( sizeof( typename Attributes::Type ) ) );
+
+    // Adds this stream's attributes for the given binding to out, starting at out[first]
+    template<size_t N>
+    static constexpr void describe( std::array<VkVertexInputAttributeDescription, N>& out, uint32_t first, uint32_t binding )
+    {
+        uint32_t offset = 0;
+        ( ( out[first++] = { Attributes::location, binding, Attributes::format, offset }, offset += sizeof( typename Attributes::Type ) ), ... );
+    }
+};
+
+template<typename... Streams>
+struct VertexLayout
+{
+    static constexpr uint32_t bindingCount = sizeof...( Streams );
+    static constexpr uint32_t attributeCount = ( 0 + ... + Streams::attributeCount );
+    static constexpr std::array<uint32_t, bindingCount> strides = { Streams::stride... };
+
+    static constexpr std::array<VkVertexInputBindingDescription, bindingCount> makeBindings()
+    {
+        std::array<VkVertexInputBindingDescription, bindingCount> bindings{};
+        for( uint32_t i = 0; i < bindingCount; i++ )
+        {
+            bindings[i] = { i, strides[i], VK_VERTEX_INPUT_RATE_VERTEX };
+        }
+        return bindings;
+    }
+
+    static constexpr std::array<VkVertexInputAttributeDescription, attributeCount> makeAttributes()
+    {
+        std::array<VkVertexInputAttributeDescription, attributeCount> attributes{};
+        uint32_t first = 0;
+        uint32_t binding = 0;
+        ( ( Streams::describe( attributes, first, binding ), first += Streams::attributeCount, binding++ ), ... );
+        return attributes;
+    }
+
+    static constexpr std::array<VkVertexInputBindingDescription, bindingCount> bindings = makeBindings();
+    static constexpr std::array<VkVertexInputAttributeDescription, attributeCount> attributes = makeAttributes();
+
+    // Fails to compile when the layout has no such location
+    static constexpr VkVertexInputAttributeDescription find( uint32_t location )
+    {
+        for( const auto& attribute : attributes )
+        {
+            if( attribute.location == location )
+            {
+                return attribute;
+            }
+        }
+        throw std::logic_error( "Location not in vertex layout" );
+    }
+
+    // Bytes per vertex over all streams
+    static constexpr uint32_t vertexSize()
+    {
+        uint32_t size = 0;
+        for( uint32_t stride : strides )
+        {
+            size += stride;
+        }
+        return size;
+    }
+
+    // streams[b] points at the start of binding b's data
+    template<uint32_t Location, typename T>
+    static void write( uint8_t* const* streams, size_t vertex, const T& value )
+    {
+        constexpr VkVertexInputAttributeDescription attribute = find( Location );
+        static_assert( attribute.format == VertexFormat<T>::format, "Value type does not match the attribute format" );
+
+        memcpy( streams[attribute.binding] + vertex * strides[attribute.binding] + attribute.offset, &value, sizeof( T ) );
+    }
+};
+
+// Round to nearest even; tiny values flush to zero, huge ones become infinity
+inline uint16_t toHalf( float value )
+{
+    uint32_t bits;
+    memcpy( &bits, &value, sizeof( bits ) );
+
+    const uint32_t sign = ( bits >> 16 ) & 0x8000;
+    const int32_t exponent = static_cast< int32_t >( ( bits >> 23 ) & 0xff ) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if( ( ( bits >> 23 ) & 0xff ) == 0xff )
+    {
+        return static_cast< uint16_t >( sign | 0x7c00 | ( mantissa != 0 ? 0x200 : 0 ) );
+    }
+    if( exponent <= 0 )
+    {
+        return static_cast< uint16_t >( sign );
+    }
+    if( exponent >= 31 )
+    {
+        return static_cast< uint16_t >( sign | 0x7c00 );
+    }
+
+    uint32_t half = sign | ( static_cast< uint32_t >( exponent ) << 10 ) | ( mantissa >> 13 );
+    const uint32_t rest = mantissa & 0x1fff;
+    if( rest > 0x1000 || ( rest == 0x1000 && ( half & 1 ) ) )
+    {
+        // May carry into the exponent, which is still the right answer
+        half++;
+    }
+    return static_cast< uint16_t >( half );
+}
+
+inline Half2 toHalf2( const glm::vec2& value )
+{
+    return { toHalf( value.x ), toHalf( value.y ) };
+}
+
+inline Half4 toHalf4( const glm::vec4& value )
+{
+    return { toHalf( value.x ), toHalf( value.y ), toHalf( value.z ), toHalf( value.w ) };
+}
+
+inline Unorm8x4 toUnorm8x4( const glm::vec4& value )
+{
+    auto channel = []( float c )
+    {
+        return static_cast< uint8_t >( std::lround( std::fmin( std::fmax( c, 0.0f ), 1.0f ) * 255.0f ) );
+    };
+    return { channel( value.r ), channel( value.g ), channel( value.b ), channel( value.a ) };
+}
+
+// The shader undoes it with:
+//     vec3 n = vec3( e, 1.0 - abs( e.x ) - abs( e.y ) );
+//     if( n.z < 0.0 ) n.xy = ( 1.0 - abs( n.yx ) ) * mix( vec2( -1.0 ), vec2( 1.0 ), step( vec2( 0.0 ), n.xy ) );
+//     n = normalize( n );
+// A zero vector has no direction and encodes as +Z.
+inline Octahedral16 toOctahedral( const glm::vec3& normal )
+{
+    const float length = std::fabs( normal.x ) + std::fabs( normal.y ) + std::fabs( normal.z );
+    if( !( length > 0.0f ) )
+    {
+        return { 0, 0 };
+    }
+
+    glm::vec2 e = glm::vec2( normal.x, normal.y ) / length;
+    if( normal.z < 0.0f )
+    {
+        e = glm::vec2( ( 1.0f - std::fabs( e.y ) ) * ( e.x >= 0.0f ? 1.0f : -1.0f ),
+            ( 1.0f - std::fabs( e.x ) ) * ( e.y >= 0.0f ? 1.0f : -1.0f ) );
+    }
+
+    auto snorm = []( float c )
+    {
+        return static_cast< int16_t >( std::lround( std::fmin( std::fmax( c, -1.0f ), 1.0f ) * 32767.0f ) );
+    };
+    return { snorm( e.x ), snorm( e.y ) };
+}
@@ -0,0 +1,313 @@
+#include <allocator.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+static VkDeviceSize alignUp( VkDeviceSize value, VkDeviceSize alignment )
+{
+    return ( value + alignment - 1 ) / alignment * alignment;
+}
+
+void DeviceAllocator::init( VkDevice device, const DeviceSnapshot& physicalDevice )
+{
+    m_device = device;
+
+    // Copied from the snapshot, every findMemoryType after this is a table lookup
+    m_memoryProperties = physicalDevice.memoryProperties;
+    m_bufferImageGranularity = physicalDevice.properties.limits.bufferImageGranularity;
+
+    m_pools.resize( m_memoryProperties.memoryTypeCount * 2 );
+    for( uint32_t i = 0; i < m_pools.size(); i++ )
+    {
+        m_pools[i].memoryType = i / 2;
+    }
+
+    m_heapStats.assign( m_memoryProperties.memoryHeapCount, HeapStats() );
+}
+
+void DeviceAllocator::destroy()
+{
+    for( auto& pool : m_pools )
+    {
+        for( uint32_t i = 0; i < pool.blocks.size(); i++ )
+        {
+            if( pool.blocks[i] )
+            {
+                destroyBlock( pool, i );
+            }
+        }
+    }
+
+    m_pools.clear();
+}
+
+uint32_t DeviceAllocator::findMemoryType( uint32_t typeFilter, VkMemoryPropertyFlags properties ) const
+{
+    for( uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++ )
+    {
+        if( ( typeFilter & ( 1 << i ) ) &&
+            ( m_memoryProperties.memoryTypes[i].propertyFlags & properties ) == properties )
+        {
+            return i;
+        }
+    }
+
+    throw std::runtime_error( "Error while finding suitable memory type" );
+}
+
+const VkPhysicalDeviceMemoryProperties& DeviceAllocator::memoryProperties() const
+{
+    return m_memoryProperties;
+}
+
+Allocation DeviceAllocator::allocate( const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool optimalImage )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    Allocation allocation;
+    allocation.memoryType = findMemoryType( requirements.memoryTypeBits, properties );
+    allocation.pool = allocation.memoryType * 2 + ( optimalImage ? 1 : 0 );
+
+    Pool& pool = m_pools[allocation.pool];
+    const VkDeviceSize blockSize = blockSizeFor( allocation.memoryType );
+    const VkDeviceSize alignment = std::max<VkDeviceSize>( requirements.alignment, 1 );
+
+    if( requirements.size > blockSize / 2 )
+    {
+        // Big resources get their own VkDeviceMemory rather than fragmenting a block
+        allocation.block = createBlock( pool, requirements.size, true );
+        Block& block = *pool.blocks[allocation.block];
+
+        block.allocationCount = 1;
+        allocation.memory = block.memory;
+        allocation.size = requirements.size;
+        allocation.chunkSize = requirements.size;
+        allocation.mapped = block.mapped;
+    }
+    else
+    {
+        for( uint32_t i = 0; i < pool.blocks.size() && allocation.block == UINT32_MAX; i++ )
+        {
+            if( pool.blocks[i] && !pool.blocks[i]->dedicated &&
+                allocateFromBlock( *pool.blocks[i], requirements.size, alignment, allocation ) )
+            {
+                allocation.block = i;
+            }
+        }
+
+        if( allocation.block == UINT32_MAX )
+        {
+            uint32_t blockIndex = createBlock( pool, blockSize, false );
+
+            if( !allocateFromBlock( *pool.blocks[blockIndex], requirements.size, alignment, allocation ) )
+            {
+                throw std::runtime_error( "Allocation does not fit into a fresh memory block" );
+            }
+            allocation.block = blockIndex;
+        }
+    }
+
+    HeapStats& stats = m_heapStats[m_memoryProperties.memoryTypes[allocation.memoryType].heapIndex];
+    stats.allocationCount++;
+    stats.allocatedBytes += allocation.size;
+
+    return allocation;
+}
+
+void DeviceAllocator::free( Allocation& allocation )
+{
+    if( allocation.memory == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    HeapStats& stats = m_heapStats[m_memoryProperties.memoryTypes[allocation.memoryType].heapIndex];
+    stats.allocationCount--;
+    stats.allocatedBytes -= allocation.size;
+
+    Pool& pool = m_pools[allocation.pool];
+    Block& block = *pool.blocks[allocation.block];
+    block.allocationCount--;
+
+    if( block.dedicated )
+    {
+        destroyBlock( pool, allocation.block );
+    }
+    else
+    {
+        releaseChunk( block, allocation.chunkOffset, allocation.chunkSize );
+
+        if( block.allocationCount == 0 )
+        {
+            // Keep one empty block per pool around so alloc/free churn doesn't hit the driver
+            bool otherBlock = false;
+            for( uint32_t i = 0; i < pool.blocks.size(); i++ )
+            {
+                otherBlock |= i != allocation.block && pool.blocks[i] && !pool.blocks[i]->dedicated;
+            }
+
+            if( otherBlock )
+            {
+                destroyBlock( pool, allocation.block );
+            }
+        }
+    }
+
+    allocation = Allocation();
+}
+
+DeviceAllocator::HeapStats DeviceAllocator::heapStats( uint32_t heap ) const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_heapStats[heap];
+}
+
+uint64_t DeviceAllocator::deviceAllocationCount() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_deviceAllocations;
+}
+
+VkDeviceSize DeviceAllocator::blockSizeFor( uint32_t memoryType ) const
+{
+    const VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+
+    // Small heaps (e.g. 256MB BAR windows) get proportionally smaller blocks
+    return std::min( DEFAULT_BLOCK_SIZE, alignUp( heapSize / 8, m_bufferImageGranularity ) );
+}
+
+uint32_t DeviceAllocator::createBlock( Pool& pool, VkDeviceSize size, bool dedicated )
+{
+    auto block = std::make_unique<Block>();
+    block->size = size;
+    block->dedicated = dedicated;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = pool.memoryType;
+
+    if( vkAllocateMemory( m_device, &allocInfo, nullptr, &block->memory ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Error while allocating device memory block" );
+    }
+
+    m_deviceAllocations++;
+
+    if( m_memoryProperties.memoryTypes[pool.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT )
+    {
+        void* mapped = nullptr;
+        vkMapMemory( m_device, block->memory, 0, VK_WHOLE_SIZE, 0, &mapped );
+        block->mapped = static_cast< uint8_t* >( mapped );
+    }
+
+    if( !dedicated )
+    {
+        insertFree( *block, 0, size );
+    }
+
+    HeapStats& stats = m_heapStats[m_memoryProperties.memoryTypes[pool.memoryType].heapIndex];
+    stats.blockCount++;
+    stats.blockBytes += size;
+
+    // Reuse a slot left by a destroyed block so live Allocations keep their indices
+    for( uint32_t i = 0; i < pool.blocks.size(); i++ )
+    {
+        if( !pool.blocks[i] )
+        {
+            pool.blocks[i] = std::move( block );
+            return i;
+        }
+    }
+
+    pool.blocks.push_back( std::move( block ) );
+    return static_cast< uint32_t >( pool.blocks.size() - 1 );
+}
+
+void DeviceAllocator::destroyBlock( Pool& pool, uint32_t blockIndex )
+{
+    Block& block = *pool.blocks[blockIndex];
+
+    if( block.mapped )
+    {
+        vkUnmapMemory( m_device, block.memory );
+    }
+    vkFreeMemory( m_device, block.memory, nullptr );
+
+    HeapStats& stats = m_heapStats[m_memoryProperties.memoryTypes[pool.memoryType].heapIndex];
+    stats.blockCount--;
+    stats.blockBytes -= block.size;
+
+    pool.blocks[blockIndex].reset();
+}
+
+bool DeviceAllocator::allocateFromBlock( Block& block, VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation )
+{
+    // Any chunk this large fits the request whatever its offset's alignment
+    auto candidate = block.freeBySize.lower_bound( { size + alignment - 1, 0 } );
+    if( candidate == block.freeBySize.end() )
+    {
+        return false;
+    }
+
+    const VkDeviceSize chunkSize = candidate->first;
+    const VkDeviceSize chunkOffset = candidate->second;
+
+    block.freeBySize.erase( candidate );
+    block.freeByOffset.erase( chunkOffset );
+
+    const VkDeviceSize alignedOffset = alignUp( chunkOffset, alignment );
+    const VkDeviceSize used = alignedOffset + size - chunkOffset;
+
+    // The tail's right neighbour is allocated (free chunks are always coalesced), so no merge
+    if( chunkSize > used )
+    {
+        insertFree( block, chunkOffset + used, chunkSize - used );
+    }
+
+    block.allocationCount++;
+
+    allocation.memory = block.memory;
+    allocation.offset = alignedOffset;
+    allocation.size = size;
+    allocation.chunkOffset = chunkOffset;
+    allocation.chunkSize = used;
+    allocation.mapped = block.mapped ? block.mapped + alignedOffset : nullptr;
+
+    return true;
+}
+
+void DeviceAllocator::insertFree( Block& block, VkDeviceSize offset, VkDeviceSize size )
+{
+    block.freeByOffset.emplace( offset, size );
+    block.freeBySize.emplace( size, offset );
+}
+
+void DeviceAllocator::releaseChunk( Block& block, VkDeviceSize offset, VkDeviceSize size )
+{
+    auto next = block.freeByOffset.lower_bound( offset );
+
+    if( next != block.freeByOffset.end() && next->first == offset + size )
+    {
+        size += next->second;
+        block.freeBySize.erase( { next->second, next->first } );
+        next = block.freeByOffset.erase( next );
+    }
+
+    if( next != block.freeByOffset.begin() )
+    {
+        auto prev = std::prev( next );
+
+        if( prev->first + prev->second == offset )
+        {
+            offset = prev->first;
+            size += prev->second;
+            block.freeBySize.erase( { prev->second, prev->first } );
+            block.freeByOffset.erase( prev );
+        }
+    }
+
+    insertFree( block, offset, size );
+}
@@ -0,0 +1,324 @@
+#include <asyncupload.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static const VkPipelineStageFlags READ_STAGES = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+static const VkAccessFlags READ_ACCESS = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+    VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+void AsyncUploader::init( VkDevice device, DeviceAllocator& allocator, VkQueue transferQueue, uint32_t transferFamily, uint32_t graphicsFamily )
+{
+    m_device = device;
+    m_allocator = &allocator;
+    m_transferQueue = transferQueue;
+    m_transferFamily = transferFamily;
+    m_graphicsFamily = graphicsFamily;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = m_transferFamily;
+
+    if( vkCreateCommandPool( m_device, &poolInfo, nullptr, &m_commandPool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create transfer command pool!" );
+    }
+}
+
+void AsyncUploader::destroy()
+{
+    if( m_commandPool == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    if( m_timeline != nullptr )
+    {
+        m_timeline->wait( m_nextTicket - 1 );
+    }
+    for( auto& job : m_jobs )
+    {
+        if( m_timeline == nullptr )
+        {
+            vkWaitForFences( m_device, 1, &job.fence, VK_TRUE, UINT64_MAX );
+        }
+        destroyJob( job );
+    }
+    m_jobs.clear();
+
+    vkDestroyCommandPool( m_device, m_commandPool, nullptr );
+    m_commandPool = VK_NULL_HANDLE;
+}
+
+void AsyncUploader::useTimeline( TimelineSemaphore& timeline )
+{
+    m_timeline = &timeline;
+}
+
+bool AsyncUploader::hasDedicatedQueue() const
+{
+    return m_transferFamily != m_graphicsFamily;
+}
+
+uint64_t AsyncUploader::upload( VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size )
+{
+    Job job;
+    job.ticket = m_nextTicket++;
+    job.dst = dst;
+    job.dstOffset = dstOffset;
+    job.size = size;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if( vkCreateBuffer( m_device, &bufferInfo, nullptr, &job.staging ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Error while creating staging buffer" );
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements( m_device, job.staging, &memoryRequirements );
+
+    job.stagingAllocation = m_allocator->allocate( memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT );
+    vkBindBufferMemory( m_device, job.staging, job.stagingAllocation.memory, job.stagingAllocation.offset );
+
+    memcpy( job.stagingAllocation.mapped, data, static_cast< size_t >( size ) );
+
+    VkCommandBufferAllocateInfo commandBufferInfo{};
+    commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferInfo.commandPool = m_commandPool;
+    commandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferInfo.commandBufferCount = 1;
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    const bool binary = m_timeline == nullptr;
+
+    if( vkAllocateCommandBuffers( m_device, &commandBufferInfo, &job.commandBuffer ) != VK_SUCCESS ||
+        ( binary && vkCreateFence( m_device, &fenceInfo, nullptr, &job.fence ) != VK_SUCCESS ) ||
+        ( binary && hasDedicatedQueue() && vkCreateSemaphore( m_device, &semaphoreInfo, nullptr, &job.semaphore ) != VK_SUCCESS ) )
+    {
+        throw std::runtime_error( "Failed to create upload job objects" );
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer( job.commandBuffer, &beginInfo );
+
+    VkBufferCopy region{};
+    region.dstOffset = dstOffset;
+    region.size = size;
+    vkCmdCopyBuffer( job.commandBuffer, job.staging, dst, 1, &region );
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.buffer = dst;
+    barrier.offset = dstOffset;
+    barrier.size = size;
+
+    if( hasDedicatedQueue() )
+    {
+        // Release half of the ownership transfer, the graphics frame records the acquire
+        barrier.dstAccessMask = 0;
+        barrier.srcQueueFamilyIndex = m_transferFamily;
+        barrier.dstQueueFamilyIndex = m_graphicsFamily;
+        vkCmdPipelineBarrier( job.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0, 0, nullptr, 1, &barrier, 0, nullptr );
+    }
+    else
+    {
+        // Same queue, so later frames are ordered behind this barrier by submission order
+        barrier.dstAccessMask = READ_ACCESS;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        vkCmdPipelineBarrier( job.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, READ_STAGES,
+            0, 0, nullptr, 1, &barrier, 0, nullptr );
+    }
+
+    if( vkEndCommandBuffer( job.commandBuffer ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to end upload command buffer" );
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &job.commandBuffer;
+    submitInfo.signalSemaphoreCount = job.semaphore != VK_NULL_HANDLE ? 1 : 0;
+    submitInfo.pSignalSemaphores = &job.semaphore;
+
+    // Tickets grow in submission order on this queue, so they can be the timeline values
+    VkSemaphore timelineSemaphore = VK_NULL_HANDLE;
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &job.ticket;
+
+    if( !binary )
+    {
+        timelineSemaphore = m_timeline->semaphore();
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &timelineSemaphore;
+    }
+
+    if( vkQueueSubmit( m_transferQueue, 1, &submitInfo, job.fence ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to submit to Transfer Queue." );
+    }
+
+    m_jobs.push_back( job );
+
+    return job.ticket;
+}
+
+bool AsyncUploader::isComplete( uint64_t ticket ) const
+{
+    if( ticket == INVALID_TICKET || ticket >= m_nextTicket )
+    {
+        return false;
+    }
+
+    for( const auto& job : m_jobs )
+    {
+        if( job.ticket == ticket )
+        {
+            return job.state == JOB_ACQUIRED;
+        }
+    }
+
+    // Retired
+    return true;
+}
+
+void AsyncUploader::beginFrame( uint32_t slot )
+{
+    m_waitSemaphores.clear();
+    m_waitStages.clear();
+    m_waitValues.clear();
+
+    for( auto& job : m_jobs )
+    {
+        if( job.state == JOB_ACQUIRED && job.slot == slot )
+        {
+            destroyJob( job );
+        }
+    }
+
+    m_jobs.erase( std::remove_if( m_jobs.begin(), m_jobs.end(), []( const Job& job )
+    {
+        return job.commandBuffer == VK_NULL_HANDLE;
+    } ), m_jobs.end() );
+}
+
+void AsyncUploader::record( VkCommandBuffer commandBuffer, uint32_t slot )
+{
+    std::vector<VkBufferMemoryBarrier> acquires;
+    uint64_t highestTicket = 0;
+
+    for( auto& job : m_jobs )
+    {
+        // Only finished copies, so the frame's semaphore wait never stalls the graphics queue
+        if( job.state != JOB_SUBMITTED || !isFinished( job ) )
+        {
+            continue;
+        }
+
+        job.state = JOB_ACQUIRED;
+        job.slot = slot;
+
+        if( !hasDedicatedQueue() )
+        {
+            continue;
+        }
+
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = READ_ACCESS;
+        barrier.srcQueueFamilyIndex = m_transferFamily;
+        barrier.dstQueueFamilyIndex = m_graphicsFamily;
+        barrier.buffer = job.dst;
+        barrier.offset = job.dstOffset;
+        barrier.size = job.size;
+        acquires.push_back( barrier );
+
+        if( m_timeline == nullptr )
+        {
+            m_waitSemaphores.push_back( job.semaphore );
+            m_waitStages.push_back( READ_STAGES );
+            m_waitValues.push_back( 0 );
+        }
+        highestTicket = std::max( highestTicket, job.ticket );
+    }
+
+    // The timeline covers every earlier ticket, one wait is enough
+    if( m_timeline != nullptr && highestTicket != 0 )
+    {
+        m_waitSemaphores.push_back( m_timeline->semaphore() );
+        m_waitStages.push_back( READ_STAGES );
+        m_waitValues.push_back( highestTicket );
+    }
+
+    if( !acquires.empty() )
+    {
+        vkCmdPipelineBarrier( commandBuffer, READ_STAGES, READ_STAGES, 0, 0, nullptr,
+            static_cast< uint32_t >( acquires.size() ), acquires.data(), 0, nullptr );
+    }
+}
+
+const std::vector<VkSemaphore>& AsyncUploader::waitSemaphores() const
+{
+    return m_waitSemaphores;
+}
+
+const std::vector<VkPipelineStageFlags>& AsyncUploader::waitStages() const
+{
+    return m_waitStages;
+}
+
+const std::vector<uint64_t>& AsyncUploader::waitValues() const
+{
+    return m_waitValues;
+}
+
+uint64_t AsyncUploader::jobCount() const
+{
+    return m_nextTicket - 1;
+}
+
+bool AsyncUploader::isFinished( const Job& job )
+{
+    if( m_timeline != nullptr )
+    {
+        return m_timeline->isComplete( job.ticket );
+    }
+
+    return vkGetFenceStatus( m_device, job.fence ) == VK_SUCCESS;
+}
+
+void AsyncUploader::destroyJob( Job& job )
+{
+    vkDestroySemaphore( m_device, job.semaphore, nullptr );
+    vkDestroyFence( m_device, job.fence, nullptr );
+    vkFreeCommandBuffers( m_device, m_commandPool, 1, &job.commandBuffer );
+    vkDestroyBuffer( m_device, job.staging, nullptr );
+    m_allocator->free( job.stagingAllocation );
+
+    job.fence = VK_NULL_HANDLE;
+    job.commandBuffer = VK_NULL_HANDLE;
+}
@@ -0,0 +1,203 @@
+#include <bindless.h>
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+uint32_t BindlessHeap::Slots::take()
+{
+    live++;
+
+    if( !freeIndices.empty() )
+    {
+        std::pop_heap( freeIndices.begin(), freeIndices.end(), std::greater<uint32_t>() );
+        uint32_t index = freeIndices.back();
+        freeIndices.pop_back();
+        inUse[index] = true;
+        return index;
+    }
+
+    if( next == capacity )
+    {
+        live--;
+        throw std::runtime_error( std::string( "Bindless heap is out of " ) + name + " slots" );
+    }
+
+    inUse.push_back( true );
+    return next++;
+}
+
+void BindlessHeap::Slots::release( uint32_t index )
+{
+    // Freeing twice would hand the same slot to two later adds
+    if( index >= next || !inUse[index] )
+    {
+        throw std::runtime_error( std::string( "Removing a bindless " ) + name + " slot that is not in use: " + std::to_string( index ) );
+    }
+
+    inUse[index] = false;
+    live--;
+    freeIndices.push_back( index );
+    std::push_heap( freeIndices.begin(), freeIndices.end(), std::greater<uint32_t>() );
+}
+
+void BindlessHeap::init( VkDevice device, DescriptorLayoutCache& layouts, uint32_t imageCapacity, uint32_t bufferCapacity, uint32_t samplerCapacity )
+{
+    m_device = device;
+    m_images = { "image", imageCapacity };
+    m_buffers = { "buffer", bufferCapacity };
+    m_samplers = { "sampler", samplerCapacity };
+
+    const std::pair<VkDescriptorType, uint32_t> arrays[] = {
+        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, imageCapacity },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bufferCapacity },
+        { VK_DESCRIPTOR_TYPE_SAMPLER, samplerCapacity }
+    };
+
+    // Slots that were never written or were removed are fine as long as no shader reads them
+    const VkDescriptorBindingFlags flags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+        VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for( uint32_t i = 0; i < 3; i++ )
+    {
+        VkDescriptorSetLayoutBinding binding{};
+        binding.binding = i;
+        binding.descriptorType = arrays[i].first;
+        binding.descriptorCount = arrays[i].second;
+        binding.stageFlags = VK_SHADER_STAGE_ALL;
+        bindings.push_back( binding );
+
+        poolSizes.push_back( { arrays[i].first, arrays[i].second } );
+    }
+
+    m_layout = layouts.getSetLayout( bindings, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+        std::vector<VkDescriptorBindingFlags>( bindings.size(), flags ) );
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = static_cast< uint32_t >( poolSizes.size() );
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    if( vkCreateDescriptorPool( m_device, &poolInfo, nullptr, &m_pool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create bindless descriptor pool!" );
+    }
+
+    VkDescriptorSetAllocateInfo allocateInfo{};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.descriptorPool = m_pool;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts = &m_layout;
+
+    if( vkAllocateDescriptorSets( m_device, &allocateInfo, &m_set ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to allocate bindless descriptor set!" );
+    }
+}
+
+void BindlessHeap::destroy()
+{
+    // The layout belongs to the layout cache
+    if( m_pool != VK_NULL_HANDLE )
+    {
+        vkDestroyDescriptorPool( m_device, m_pool, nullptr );
+    }
+    m_pool = VK_NULL_HANDLE;
+    m_set = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessHeap::addImage( VkImageView view, VkImageLayout layout )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    uint32_t index = m_images.take();
+    VkDescriptorImageInfo imageInfo = { VK_NULL_HANDLE, view, layout };
+    write( IMAGE_BINDING, index, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, &imageInfo, nullptr );
+    return index;
+}
+
+uint32_t BindlessHeap::addBuffer( VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    uint32_t index = m_buffers.take();
+    VkDescriptorBufferInfo bufferInfo = { buffer, offset, range };
+    write( BUFFER_BINDING, index, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &bufferInfo );
+    return index;
+}
+
+uint32_t BindlessHeap::addSampler( VkSampler sampler )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    uint32_t index = m_samplers.take();
+    VkDescriptorImageInfo imageInfo = { sampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED };
+    write( SAMPLER_BINDING, index, VK_DESCRIPTOR_TYPE_SAMPLER, &imageInfo, nullptr );
+    return index;
+}
+
+void BindlessHeap::removeImage( uint32_t index )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_images.release( index );
+}
+
+void BindlessHeap::removeBuffer( uint32_t index )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_buffers.release( index );
+}
+
+void BindlessHeap::removeSampler( uint32_t index )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_samplers.release( index );
+}
+
+VkDescriptorSetLayout BindlessHeap::layout() const
+{
+    return m_layout;
+}
+
+VkDescriptorSet BindlessHeap::set() const
+{
+    return m_set;
+}
+
+uint32_t BindlessHeap::imageCount() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_images.live;
+}
+
+uint32_t BindlessHeap::bufferCount() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_buffers.live;
+}
+
+uint32_t BindlessHeap::samplerCount() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_samplers.live;
+}
+
+void BindlessHeap::write( uint32_t binding, uint32_t index, VkDescriptorType type, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo )
+{
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_set;
+    write.dstBinding = binding;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = type;
+    write.pImageInfo = imageInfo;
+    write.pBufferInfo = bufferInfo;
+
+    vkUpdateDescriptorSets( m_device, 1, &write, 0, nullptr );
+}
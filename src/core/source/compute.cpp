@@ -0,0 +1,45 @@
+#include <compute.h>
+
+#include <algorithm>
+
+static const VkPipelineStageFlags GRAPHICS_READ_STAGES = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+    VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+VkExtent2D ComputeGroupGrid( uint64_t groupCount, uint32_t maxGroupCountX )
+{
+    maxGroupCountX = std::max( maxGroupCountX, 1u );
+
+    VkExtent2D grid;
+    grid.width = static_cast< uint32_t >( std::min<uint64_t>( std::max<uint64_t>( groupCount, 1 ), maxGroupCountX ) );
+    grid.height = static_cast< uint32_t >( ( std::max<uint64_t>( groupCount, 1 ) + grid.width - 1 ) / grid.width );
+    return grid;
+}
+
+void RecordComputeBarrier( VkCommandBuffer commandBuffer )
+{
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr );
+}
+
+void RecordComputeToGraphicsBarrier( VkCommandBuffer commandBuffer )
+{
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+        VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, GRAPHICS_READ_STAGES,
+        0, 1, &barrier, 0, nullptr, 0, nullptr );
+}
+
+void RecordGraphicsToComputeBarrier( VkCommandBuffer commandBuffer )
+{
+    vkCmdPipelineBarrier( commandBuffer, GRAPHICS_READ_STAGES, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 0, nullptr );
+}
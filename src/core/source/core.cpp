@@ -1,5 +1,6 @@
 #include <core.h>
 
+#ifdef _WIN32
 HWND InitWindow(const HINSTANCE hInstance, const LPCTSTR windowName, const LPCTSTR windowTitle, const WNDPROC WndProc, const int width, const int height, const bool fullscreen, int showWnd)
 {
     HWND window;
@@ -64,13 +65,66 @@ HWND InitWindow(const HINSTANCE hInstance, const LPCTSTR windowName, const LPCTS
 
     return window;
 }
+#endif
+
+std::vector<std::string> SplitCommandLine( const std::string& commandLine )
+{
+    std::istringstream stream( commandLine );
+    std::vector<std::string> args;
+    std::string arg;
+
+    while( stream >> arg )
+    {
+        args.push_back( arg );
+    }
+
+    return args;
+}
 
 void core::Mainloop()
 {
+    const ShaderModuleCache::Stats& shaderStats = m_shaderModules.stats();
+    std::cout << "Startup: " << shaderStats.bytesMapped << " SPIR-V bytes mapped from " << shaderStats.filesMapped << " files, "
+        << shaderStats.modulesCreated << " shader modules created, " << shaderStats.cacheHits << " cache hits" << std::endl;
+
+    if( m_headless )
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        const VkExtent2D baseExtent = m_headlessExtent;
+
+        for( uint32_t i = 0; i < m_headlessFrameCount; i++ )
+        {
+            // Alternate between the requested size and 3/4 of it, like a window being dragged
+            if( m_resizeEvery != 0 && i != 0 && i % m_resizeEvery == 0 )
+            {
+                const bool smaller = ( i / m_resizeEvery ) % 2 == 1;
+                m_headlessExtent.width = smaller ? baseExtent.width * 3 / 4 : baseExtent.width;
+                m_headlessExtent.height = smaller ? baseExtent.height * 3 / 4 : baseExtent.height;
+                RequestSwapchainRecreate();
+            }
+
+            drawFrame();
+        }
+
+        vkDeviceWaitIdle( m_device );
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << applicationName << ": " << m_headlessFrameCount << " headless frames in "
+            << elapsed.count() * 1000.0 << " ms (" << m_headlessFrameCount / elapsed.count() << " fps, "
+            << m_framesInFlight << " frames in flight)" << std::endl;
+        return;
+    }
+
+#ifdef _WIN32
     MSG msg;
 
     ZeroMemory( &msg, sizeof( msg ) );
 
+    RECT initialRect;
+    GetClientRect( m_window, &initialRect );
+    m_windowExtent = { static_cast< uint32_t >( initialRect.right - initialRect.left ), static_cast< uint32_t >( initialRect.bottom - initialRect.top ) };
+
     while( true )
     {
         if( PeekMessage( &msg, NULL, 0, 0, PM_REMOVE ) )
@@ -82,15 +136,34 @@ void core::Mainloop()
 
             TranslateMessage( &msg );
             DispatchMessage( &msg );
+            continue;
+        }
+
+        // Nothing to render into while minimized
+        if( IsIconic( m_window ) )
+        {
+            WaitMessage();
+            continue;
+        }
+
+        RECT rect;
+        GetClientRect( m_window, &rect );
+        VkExtent2D clientExtent = { static_cast< uint32_t >( rect.right - rect.left ), static_cast< uint32_t >( rect.bottom - rect.top ) };
+
+        if( clientExtent.width != m_windowExtent.width || clientExtent.height != m_windowExtent.height )
+        {
+            m_windowExtent = clientExtent;
+            RequestSwapchainRecreate();
         }
 
         drawFrame();
     }
+#endif
 
     vkDeviceWaitIdle( m_device );
 }
 
-
+#ifdef _WIN32
 LRESULT CALLBACK WndProc( HWND hwnd,
     UINT msg,
     WPARAM wParam,
@@ -115,6 +188,7 @@ LRESULT CALLBACK WndProc( HWND hwnd,
         wParam,
         lParam );
 }
+#endif
 
 VkInstance core::GetInstance()
 {
@@ -131,9 +205,19 @@ VkPhysicalDevice core::GetPhysicalDevice()
     return m_physicalDevice;
 }
 
+const DeviceSnapshot& core::GetDeviceSnapshot()
+{
+    return m_deviceSnapshot;
+}
+
 VkCommandBuffer core::GetCommandBuffer()
 {
-    return m_commandBuffer;
+    return m_frames[m_currentFrame].commandBuffer;
+}
+
+VkExtent2D core::GetSwapchainExtent()
+{
+    return m_swapchainExtent;
 }
 
 void core::EnableValidationLayers()
@@ -141,263 +225,1299 @@ void core::EnableValidationLayers()
     enableValidationLayers = true;
 }
 
-std::string  core::ApplicationName()
+void core::SetFramesInFlight( uint32_t count )
 {
-    return applicationName;
+    if( !m_frames.empty() )
+    {
+        throw std::runtime_error( "Frames in flight must be set before creating the command pools" );
+    }
+
+    m_framesInFlight = std::clamp( count, 1u, MAX_FRAMES_IN_FLIGHT );
 }
 
-bool core::checkValidationLayerSupport()
+uint32_t core::FramesInFlight()
 {
-    uint32_t layersCount = 0;
-    vkEnumerateInstanceLayerProperties( &layersCount, nullptr );
+    return m_framesInFlight;
+}
 
-    std::vector<VkLayerProperties> availableLayers( layersCount );
-    vkEnumerateInstanceLayerProperties( &layersCount, availableLayers.data() );
+uint32_t core::CurrentFrame()
+{
+    return m_currentFrame;
+}
 
-    std::set<std::string> requiredLayers( m_validationLayers.begin(), m_validationLayers.end() );
+void core::SetWorkerThreads( uint32_t count )
+{
+    if( m_threadPool )
+    {
+        throw std::runtime_error( "Worker threads must be set before creating the device" );
+    }
 
-    for( const auto& layer : availableLayers )
+    m_workerThreads = count;
+}
+
+uint32_t core::WorkerThreads()
+{
+    return m_threadPool ? m_threadPool->size() : m_workerThreads;
+}
+
+ThreadPool& core::GetThreadPool()
+{
+    return *m_threadPool;
+}
+
+StartupProfiler& core::Startup()
+{
+    return m_startup;
+}
+
+void core::StartupStep( const std::string& name, const std::function<void()>& work )
+{
+    m_startup.step( name, work );
+}
+
+// The worker threads exist once the logical device does, so steps before that run through
+// StartupStep. With --serial-init the graph runs inline in the order its tasks were added.
+void core::RunStartupTasks( TaskGraph& graph )
+{
+    graph.run( m_serialInit ? nullptr : m_threadPool.get(), &m_startup );
+}
+
+void core::RequestSwapchainRecreate()
+{
+    m_swapchainDirty = true;
+}
+
+void core::SetPresentGoal( PresentGoal goal )
+{
+    m_presentGoal = goal;
+}
+
+// Must be called before createLogicalDevice
+void core::RequestDeviceExtension( const char* name )
+{
+    m_optionalDeviceExtensions.push_back( name );
+}
+
+bool core::IsDeviceExtensionEnabled( const std::string& name )
+{
+    return m_enabledDeviceExtensions.count( name ) != 0;
+}
+
+const VkPhysicalDeviceFeatures& core::EnabledFeatures()
+{
+    return m_enabledFeatures;
+}
+
+// Must be called before createLogicalDevice. Capacities are clamped to the device limits; on
+// devices without descriptor indexing IsBindlessEnabled stays false and samples fall back.
+void core::EnableBindless( uint32_t imageCapacity, uint32_t bufferCapacity, uint32_t samplerCapacity )
+{
+    m_bindlessRequested = true;
+    m_bindlessImages = std::max( imageCapacity, 1u );
+    m_bindlessBuffers = std::max( bufferCapacity, 1u );
+    m_bindlessSamplers = std::max( samplerCapacity, 1u );
+}
+
+bool core::IsBindlessEnabled()
+{
+    return m_bindlessEnabled;
+}
+
+BindlessHeap& core::GetBindlessHeap()
+{
+    return m_bindless;
+}
+
+void core::deferDestroy( std::function<void()> destroy )
+{
+    m_deletionQueue.push( m_recordingFrame ? m_submittedFrames + 1 : m_submittedFrames, std::move( destroy ) );
+}
+
+// Frames are numbered from 1 in submission order; 0 means none yet
+uint64_t core::SubmittedFrame()
+{
+    return m_submittedFrames;
+}
+
+// Highest frame the GPU has finished. Polls the timeline or the slot fences, never blocks.
+uint64_t core::CompletedFrame()
+{
+    if( m_timelineSync )
     {
-        requiredLayers.erase( layer.layerName );
+        m_completedFrame = std::max( m_completedFrame, m_frameTimeline.completedValue() );
+        return m_completedFrame;
     }
 
-    return requiredLayers.empty();
+    // Frames finish in submission order, so any signalled slot covers every frame before it
+    for( const auto& frame : m_frames )
+    {
+        if( frame.submittedFrame > m_completedFrame && vkGetFenceStatus( m_device, frame.inflightFence ) == VK_SUCCESS )
+        {
+            m_completedFrame = std::max( m_completedFrame, frame.submittedFrame );
+        }
+    }
+
+    return m_completedFrame;
 }
 
-bool core::checkInstanceExtensionSupport()
+bool core::IsFrameComplete( uint64_t frame )
 {
-    uint32_t extensionCount = 0;
-    vkEnumerateInstanceExtensionProperties( nullptr, &extensionCount, nullptr );
+    return frame <= m_completedFrame || frame <= CompletedFrame();
+}
 
-    std::vector<VkExtensionProperties> availableExtensions( extensionCount );
-    vkEnumerateInstanceExtensionProperties( nullptr, &extensionCount, availableExtensions.data() );
+// Must be called before createLogicalDevice, like --sync timeline
+void core::EnableTimelineSync()
+{
+    m_timelineRequested = true;
+}
 
-    std::set<std::string> requiredExtension( m_instanceExtensions.begin(), m_instanceExtensions.end() );
+bool core::IsTimelineSyncEnabled()
+{
+    return m_timelineSync;
+}
 
-    for( const auto& extension : availableExtensions )
+// Must be called before createLogicalDevice, like --rendering dynamic
+void core::EnableDynamicRendering()
+{
+    m_dynamicRenderingRequested = true;
+}
+
+bool core::IsDynamicRenderingEnabled()
+{
+    return m_dynamicRendering;
+}
+
+// Must be called before createLogicalDevice, like --pipeline-library
+void core::EnablePipelineLibrary()
+{
+    m_pipelineLibraryRequested = true;
+}
+
+bool core::IsPipelineLibraryEnabled()
+{
+    return m_pipelineLibrary;
+}
+
+void core::EnableHeadless( uint32_t width, uint32_t height, uint32_t frameCount )
+{
+    m_headless = true;
+    m_headlessExtent = { width, height };
+    m_headlessFrameCount = frameCount;
+}
+
+bool core::IsHeadless()
+{
+    return m_headless;
+}
+
+// Option values are whole numbers that fit in 32 bits; a sign, a fraction or trailing text is
+// a usage error rather than something to wrap or truncate
+static uint32_t parseArgValue( const std::string& name, const std::string& value )
+{
+    size_t end = 0;
+    unsigned long long number = 0;
+    if( !value.empty() && std::isdigit( static_cast< unsigned char >( value[0] ) ) )
     {
-        requiredExtension.erase( extension.extensionName );
+        try
+        {
+            number = std::stoull( value, &end );
+        }
+        catch( const std::out_of_range& )
+        {
+            end = 0;
+        }
     }
 
-    return requiredExtension.empty();
+    if( end == 0 || end != value.size() || number > std::numeric_limits<uint32_t>::max() )
+    {
+        throw std::runtime_error( "Invalid value " + value + " for " + name );
+    }
+    return static_cast< uint32_t >( number );
 }
 
-void core::createInstance()
+uint32_t core::ArgValue( const std::vector<std::string>& args, const std::string& name, uint32_t defaultValue )
 {
-    if( !checkInstanceExtensionSupport() )
+    auto arg = std::find( args.begin(), args.end(), name );
+    if( arg == args.end() )
     {
-        throw std::runtime_error( "Required Instance extensions not supported!" );
+        return defaultValue;
+    }
+    if( arg + 1 == args.end() )
+    {
+        throw std::runtime_error( "Missing value for " + name );
     }
+    return parseArgValue( name, *( arg + 1 ) );
+}
 
-    VkApplicationInfo appInfo = {};
-    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-    appInfo.pApplicationName = applicationName.c_str();
-    appInfo.applicationVersion = VK_MAKE_VERSION( 1, 0, 0 );
-    appInfo.pEngineName = "Noob Engine";
-    appInfo.engineVersion = VK_MAKE_VERSION( 1, 0, 0 );
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+void core::ParseCommandLine( const std::vector<std::string>& args )
+{
+    auto nextString = [&args]( size_t& i ) -> const std::string&
+    {
+        if( i + 1 >= args.size() )
+        {
+            throw std::runtime_error( "Missing value for " + args[i] );
+        }
+        return args[++i];
+    };
+
+    auto nextValue = [&args, &nextString]( size_t& i ) -> uint32_t
+    {
+        const std::string& name = args[i];
+        return parseArgValue( name, nextString( i ) );
+    };
+
+    for( size_t i = 0; i < args.size(); i++ )
+    {
+        if( args[i] == "--headless" )
+        {
+            m_headless = true;
+        }
+        else if( args[i] == "--frames" )
+        {
+            m_headlessFrameCount = nextValue( i );
+        }
+        else if( args[i] == "--width" )
+        {
+            m_headlessExtent.width = nextValue( i );
+        }
+        else if( args[i] == "--height" )
+        {
+            m_headlessExtent.height = nextValue( i );
+        }
+        else if( args[i] == "--frames-in-flight" )
+        {
+            SetFramesInFlight( nextValue( i ) );
+        }
+        else if( args[i] == "--timing-json" )
+        {
+            m_timingJsonPath = nextString( i );
+        }
+        else if( args[i] == "--pipeline-cache" )
+        {
+            m_pipelineCachePath = nextString( i );
+        }
+        else if( args[i] == "--no-pipeline-cache" )
+        {
+            m_pipelineCachePath.clear();
+        }
+        else if( args[i] == "--resize-every" )
+        {
+            m_resizeEvery = nextValue( i );
+        }
+        else if( args[i] == "--resize-wait-idle" )
+        {
+            m_recreateWaitIdle = true;
+        }
+        else if( args[i] == "--present" )
+        {
+            m_presentGoal = ParsePresentGoal( nextString( i ) );
+        }
+        else if( args[i] == "--present-mode" )
+        {
+            m_requestedPresentMode = ParsePresentMode( nextString( i ) );
+        }
+        else if( args[i] == "--device" )
+        {
+            m_deviceSelector = nextString( i );
+        }
+        else if( args[i] == "--threads" )
+        {
+            SetWorkerThreads( nextValue( i ) );
+        }
+        else if( args[i] == "--staging-mb" )
+        {
+            m_uploadRingSize = static_cast< VkDeviceSize >( std::max( nextValue( i ), 1u ) ) * 1024 * 1024;
+        }
+        else if( args[i] == "--sync" )
+        {
+            const std::string& backend = nextString( i );
+            if( backend != "timeline" && backend != "fence" )
+            {
+                throw std::runtime_error( "Unknown sync backend " + backend + ", expected timeline or fence" );
+            }
+            m_timelineRequested = backend == "timeline";
+        }
+        else if( args[i] == "--pipeline-library" )
+        {
+            m_pipelineLibraryRequested = true;
+        }
+        else if( args[i] == "--serial-init" )
+        {
+            m_serialInit = true;
+        }
+        else if( args[i] == "--rendering" )
+        {
+            const std::string& path = nextString( i );
+            if( path != "dynamic" && path != "render-pass" )
+            {
+                throw std::runtime_error( "Unknown rendering path " + path + ", expected dynamic or render-pass" );
+            }
+            m_dynamicRenderingRequested = path == "dynamic";
+        }
+    }
+}
+
+TimingStats& core::Timing()
+{
+    return m_timing;
+}
+
+GpuTimer& core::GetGpuTimer()
+{
+    return m_gpuTimer;
+}
+
+DeviceAllocator& core::GetAllocator()
+{
+    return m_allocator;
+}
+
+UploadRing& core::GetUploadRing()
+{
+    return m_uploadRing;
+}
+
+// Times uploadBuffer found the ring full and had to flush and wait for it
+uint64_t core::UploadStalls()
+{
+    return m_uploadStalls;
+}
+
+AsyncUploader& core::GetAsyncUploader()
+{
+    return m_asyncUploader;
+}
+
+DescriptorLayoutCache& core::GetDescriptorLayouts()
+{
+    return m_descriptorLayouts;
+}
+
+DescriptorAllocator& core::GetDescriptorAllocator()
+{
+    return m_descriptorAllocator;
+}
+
+// Layout for pipelines made by createGraphicsPipeline afterwards; empty until set
+void core::SetGraphicsPipelineLayout( const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges )
+{
+    m_graphicsSetLayouts = setLayouts;
+    m_graphicsPushConstantRanges = pushConstantRanges;
+}
+
+VkPipelineLayout core::GetPipelineLayout()
+{
+    return m_pipelineLayout;
+}
+
+VkQueue core::GetComputeQueue()
+{
+    return m_computeQueue;
+}
+
+uint32_t core::GetComputeFamily()
+{
+    return m_computeFamily;
+}
+
+void core::initTiming()
+{
+    m_phaseSeries[PHASE_FRAME_PROLOG] = m_timing.addSeries( "cpu.frame_prolog" );
+    m_phaseSeries[PHASE_RECORD_PROLOG] = m_timing.addSeries( "cpu.record_prolog" );
+    m_phaseSeries[PHASE_RECORD] = m_timing.addSeries( "cpu.record" );
+    m_phaseSeries[PHASE_RECORD_EPILOG] = m_timing.addSeries( "cpu.record_epilog" );
+    m_phaseSeries[PHASE_FRAME_EPILOG] = m_timing.addSeries( "cpu.frame_epilog" );
+    m_phaseSeries[PHASE_FRAME] = m_timing.addSeries( "cpu.frame" );
+
+    m_renderPassScope = m_gpuTimer.registerScope( "render_pass" );
+
+    m_pipelineCreateSeries = m_timing.addSeries( "cpu.pipeline_create" );
+    m_pipelineBatchSeries = m_timing.addSeries( "cpu.pipeline_batch" );
+
+    m_swapchainRecreateSeries = m_timing.addSeries( "cpu.swapchain_recreate" );
+    m_resizeFrameSeries = m_timing.addSeries( "cpu.resize_frame" );
+
+    m_acquireSeries = m_timing.addSeries( "cpu.acquire" );
+    m_presentSeries = m_timing.addSeries( "cpu.present" );
+    m_inputToSubmitSeries = m_timing.addSeries( "latency.input_to_submit" );
+    m_inputToPresentSeries = m_timing.addSeries( "latency.input_to_present" );
+
+    // Time blocked on the GPU: for the slot's previous frame, and for the acquired image
+    m_frameWaitSeries = m_timing.addSeries( "cpu.frame_wait" );
+    m_imageWaitSeries = m_timing.addSeries( "cpu.image_wait" );
+}
+
+void core::writeTimingReport()
+{
+    if( m_timingJsonPath.empty() )
+    {
+        return;
+    }
+
+    m_timing.setInfo( "application", applicationName );
+    m_timing.setInfo( "backend", m_headless ? "headless" : "swapchain" );
+    m_timing.setInfo( "framesInFlight", std::to_string( m_framesInFlight ) );
+    m_timing.setInfo( "sync", m_timelineSync ? "timeline" : "fence" );
+    m_timing.setInfo( "rendering", m_dynamicRendering ? "dynamic" : "render-pass" );
+    m_timing.setInfo( "shaderBytesMapped", std::to_string( m_shaderModules.stats().bytesMapped ) );
+    m_timing.setInfo( "shaderModulesCreated", std::to_string( m_shaderModules.stats().modulesCreated ) );
+    if( m_device != VK_NULL_HANDLE )
+    {
+        const VkPhysicalDeviceMemoryProperties& memoryProperties = m_allocator.memoryProperties();
+
+        for( uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++ )
+        {
+            DeviceAllocator::HeapStats heap = m_allocator.heapStats( i );
+            m_timing.setInfo( "memoryHeap" + std::to_string( i ),
+                "blocks=" + std::to_string( heap.blockCount ) +
+                " blockBytes=" + std::to_string( heap.blockBytes ) +
+                " allocations=" + std::to_string( heap.allocationCount ) +
+                " allocatedBytes=" + std::to_string( heap.allocatedBytes ) );
+        }
+        m_timing.setInfo( "deviceMemoryAllocations", std::to_string( m_allocator.deviceAllocationCount() ) );
+        m_timing.setInfo( "uploadBytes", std::to_string( m_uploadRing.stats().bytesUploaded ) );
+        m_timing.setInfo( "uploadCopies", std::to_string( m_uploadRing.stats().copies ) );
+        m_timing.setInfo( "uploadStalls", std::to_string( m_uploadStalls ) );
+        m_timing.setInfo( "asyncUploadJobs", std::to_string( m_asyncUploader.jobCount() ) );
+        m_timing.setInfo( "descriptorSetsAllocated", std::to_string( m_descriptorAllocator.stats().setsAllocated ) );
+        m_timing.setInfo( "descriptorSetsPeakPerFrame", std::to_string( m_descriptorAllocator.stats().peakFrameSets ) );
+        m_timing.setInfo( "descriptorPoolsCreated", std::to_string( m_descriptorAllocator.stats().poolsCreated ) );
+        m_timing.setInfo( "descriptorPoolResets", std::to_string( m_descriptorAllocator.stats().poolResets ) );
+        m_timing.setInfo( "descriptorSetLayouts", std::to_string( m_descriptorLayouts.setLayoutCount() ) );
+        m_timing.setInfo( "pipelineLayouts", std::to_string( m_descriptorLayouts.pipelineLayoutCount() ) );
+        m_timing.setInfo( "bindless", !m_bindlessEnabled ? "off" :
+            "images=" + std::to_string( m_bindless.imageCount() ) + "/" + std::to_string( m_bindlessImages ) +
+            " buffers=" + std::to_string( m_bindless.bufferCount() ) + "/" + std::to_string( m_bindlessBuffers ) +
+            " samplers=" + std::to_string( m_bindless.samplerCount() ) + "/" + std::to_string( m_bindlessSamplers ) );
+        m_timing.setInfo( "transferQueue", m_transferFamily != m_graphicsFamily ? "family " + std::to_string( m_transferFamily ) : "graphics" );
+        m_timing.setInfo( "computeQueue", m_computeFamily != m_graphicsFamily ? "family " + std::to_string( m_computeFamily ) : "graphics" );
+    }
+    m_timing.setInfo( "presentGoal", PresentGoalName( m_presentGoal ) );
+    m_timing.setInfo( "presentMode", m_headless ? "none (headless)" : PresentModeName( m_presentMode ) );
+    m_timing.setInfo( "swapchainRecreates", std::to_string( m_swapchainRecreates ) +
+        ( m_recreateWaitIdle ? " (vkDeviceWaitIdle)" : " (deferred destruction)" ) );
+    m_timing.setInfo( "pipelineCache", m_pipelineCachePath.empty() ? "disabled" : ( m_pipelineCacheWarm ? "warm" : "cold" ) );
+    if( m_pipelineLibrary )
+    {
+        const PipelineCompiler::LibraryStats stats = m_pipelineCompiler.libraryStats();
+        m_timing.setInfo( "pipelineLibrary", std::to_string( stats.parts ) + " parts in " + std::to_string( stats.partCompileMs ) + " ms, " +
+            std::to_string( stats.fastLinks ) + " fast links in " + std::to_string( stats.fastLinkMs ) + " ms, " +
+            std::to_string( stats.optimizedLinks ) + " optimized links in " + std::to_string( stats.optimizedLinkMs ) + " ms" +
+            ( m_pipelineLibraryFastLinking ? "" : " (no fast linking)" ) );
+    }
+    if( m_startup.firstFrameMarked() )
+    {
+        m_timing.setInfo( "timeToFirstFrame", std::to_string( m_startup.firstFrameMs() ) + " ms (" +
+            ( m_serialInit ? "serial" : "parallel" ) + " init)" );
+        for( const auto& step : m_startup.steps() )
+        {
+            m_timing.setInfo( "startup." + step.name, "+" + std::to_string( step.startMs ) + " ms, " + std::to_string( step.durationMs ) +
+                " ms on worker " + std::to_string( step.worker ) );
+        }
+    }
+    const PipelineCompiler::VariantStats variants = m_pipelineCompiler.variantStats();
+    if( variants.variants > 0 )
+    {
+        m_timing.setInfo( "pipelineVariants", std::to_string( variants.variants ) + " variants in " + std::to_string( variants.compileMs ) +
+            " ms, " + std::to_string( variants.hits ) + " cache hits" );
+    }
+    if( m_pipelineBatchPipelines > 0 )
+    {
+        m_timing.setInfo( "pipelineBatches", std::to_string( m_pipelineBatchPipelines ) + " pipelines, " + std::to_string( m_pipelineBatchWallMs ) +
+            " ms wall, " + std::to_string( m_pipelineBatchCompileMs ) + " ms compile" );
+    }
+
+    if( m_physicalDevice != VK_NULL_HANDLE )
+    {
+        m_timing.setInfo( "device", m_deviceSnapshot.properties.deviceName );
+        m_timing.setInfo( "deviceType", DeviceSnapshot::typeName( m_deviceSnapshot.properties.deviceType ) );
+        m_timing.setInfo( "deviceSelection", m_deviceSelector.empty() && std::getenv( "VKSAMPLES_DEVICE" ) == nullptr ? "score" : "override" );
+    }
+
+    // Runs first in cleanup, a bad path must not stop the device from being torn down
+    try
+    {
+        m_timing.writeJson( m_timingJsonPath );
+    }
+    catch( const std::exception& error )
+    {
+        std::cerr << error.what() << std::endl;
+    }
+}
+
+std::string  core::ApplicationName()
+{
+    return applicationName;
+}
+
+bool core::checkValidationLayerSupport()
+{
+    uint32_t layersCount = 0;
+    vkEnumerateInstanceLayerProperties( &layersCount, nullptr );
+
+    std::vector<VkLayerProperties> availableLayers( layersCount );
+    vkEnumerateInstanceLayerProperties( &layersCount, availableLayers.data() );
+
+    std::set<std::string> requiredLayers( m_validationLayers.begin(), m_validationLayers.end() );
+
+    for( const auto& layer : availableLayers )
+    {
+        requiredLayers.erase( layer.layerName );
+    }
+
+    return requiredLayers.empty();
+}
+
+std::vector<const char*> core::requiredInstanceExtensions()
+{
+    return m_headless ? std::vector<const char*>() : m_instanceExtensions;
+}
+
+std::vector<const char*> core::requiredDeviceExtensions()
+{
+    return m_headless ? std::vector<const char*>() : m_deviceExtensions;
+}
+
+bool core::checkInstanceExtensionSupport()
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateInstanceExtensionProperties( nullptr, &extensionCount, nullptr );
+
+    std::vector<VkExtensionProperties> availableExtensions( extensionCount );
+    vkEnumerateInstanceExtensionProperties( nullptr, &extensionCount, availableExtensions.data() );
+
+    std::vector<const char*> instanceExtensions = requiredInstanceExtensions();
+    std::set<std::string> requiredExtension( instanceExtensions.begin(), instanceExtensions.end() );
+
+    for( const auto& extension : availableExtensions )
+    {
+        requiredExtension.erase( extension.extensionName );
+    }
+
+    return requiredExtension.empty();
+}
+
+void core::createInstance()
+{
+    if( !checkInstanceExtensionSupport() )
+    {
+        throw std::runtime_error( "Required Instance extensions not supported!" );
+    }
+
+    VkApplicationInfo appInfo = {};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = applicationName.c_str();
+    appInfo.applicationVersion = VK_MAKE_VERSION( 1, 0, 0 );
+    appInfo.pEngineName = "Noob Engine";
+    appInfo.engineVersion = VK_MAKE_VERSION( 1, 0, 0 );
+
+    // Ask for 1.2 where the loader supports it, so promoted features like descriptor indexing
+    // can be queried; a 1.0 loader has no vkEnumerateInstanceVersion and rejects anything newer
+    m_apiVersion = VK_API_VERSION_1_0;
+    auto enumerateInstanceVersion = reinterpret_cast< PFN_vkEnumerateInstanceVersion >( vkGetInstanceProcAddr( nullptr, "vkEnumerateInstanceVersion" ) );
+    if( enumerateInstanceVersion != nullptr )
+    {
+        uint32_t loaderVersion = VK_API_VERSION_1_0;
+        enumerateInstanceVersion( &loaderVersion );
+        m_apiVersion = std::min( loaderVersion, static_cast< uint32_t >( VK_API_VERSION_1_2 ) );
+    }
+    appInfo.apiVersion = m_apiVersion;
+
+    std::vector<const char*> instanceExtensions = requiredInstanceExtensions();
+
+    VkInstanceCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    createInfo.pApplicationInfo = &appInfo;
+    createInfo.enabledExtensionCount = static_cast< uint32_t >( instanceExtensions.size() );
+    createInfo.ppEnabledExtensionNames = instanceExtensions.data();
+
+    if( enableValidationLayers )
+    {
+        if( !checkValidationLayerSupport() )
+        {
+            throw std::runtime_error( "Validation Layer requested but not supported" );
+        }
+
+        createInfo.enabledLayerCount = static_cast< uint32_t >( m_validationLayers.size() );
+        createInfo.ppEnabledLayerNames = m_validationLayers.data();
+    }
+    else
+    {
+        createInfo.enabledLayerCount = 0;
+    }
+
+    VkResult result = vkCreateInstance( &createInfo, nullptr, &m_instance );
+    if( result != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create Instance!" );
+    }
+}
+
+void core::createSurface( HINSTANCE hInstance, HWND window )
+{
+    if( m_headless )
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    VkWin32SurfaceCreateInfoKHR createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
+    createInfo.hinstance = hInstance;
+    createInfo.hwnd = window;
+
+    if( vkCreateWin32SurfaceKHR( m_instance, &createInfo, nullptr, &m_surface ) )
+    {
+        throw std::runtime_error( "Error creating Win32 surface" );
+    }
+#else
+    throw std::runtime_error( "Windowed mode is only supported on Win32, run with --headless" );
+#endif
+}
+
+// Present support depends on the surface, so it is asked for here rather than snapshotted
+core::QueueFamilyIndices core::findQueueFamilies( const DeviceSnapshot& device )
+{
+    core::QueueFamilyIndices indices;
+    const uint32_t queueFamilyCount = static_cast< uint32_t >( device.queueFamilies.size() );
+
+    for( uint32_t i = 0; i < queueFamilyCount; i++ )
+    {
+        const VkQueueFlags flags = device.queueFamilies[i].queueFlags;
+        VkBool32 presentSupport = false;
+
+        if( !m_headless )
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR( device.device, i, m_surface, &presentSupport );
+        }
+
+        if( flags & VK_QUEUE_GRAPHICS_BIT )
+        {
+            if( !indices.graphicsFamily.has_value() )
+            {
+                indices.graphicsFamily = i;
+            }
+
+            // Headless "presents" are ring bookkeeping on the graphics queue
+            if( m_headless || ( presentSupport && indices.graphicsFamily.value() == i ) )
+            {
+                indices.presentFamily = i;
+            }
+        }
+        else if( flags & VK_QUEUE_COMPUTE_BIT )
+        {
+            // Async compute: compute without graphics
+            if( !indices.computeFamily.has_value() )
+            {
+                indices.computeFamily = i;
+            }
+        }
+        else if( flags & VK_QUEUE_TRANSFER_BIT )
+        {
+            // Dedicated copy engine: transfer only
+            if( !indices.transferFamily.has_value() )
+            {
+                indices.transferFamily = i;
+            }
+        }
+
+        if( presentSupport && !indices.presentFamily.has_value() )
+        {
+            indices.presentFamily = i;
+        }
+    }
+
+    return indices;
+}
+
+core::SwapchainSupportDetails core::querySwapchainSupport( VkPhysicalDevice m_device )
+{
+    core::SwapchainSupportDetails details;
+
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR( m_device, m_surface, &details.capabilities );
+
+    uint32_t formatsCount = 0;
+    vkGetPhysicalDeviceSurfaceFormatsKHR( m_device, m_surface, &formatsCount, nullptr );
+
+    if( formatsCount )
+    {
+        details.formats.resize( formatsCount );
+        vkGetPhysicalDeviceSurfaceFormatsKHR( m_device, m_surface, &formatsCount, details.formats.data() );
+    }
+
+    uint32_t presentModesCount = 0;
+    vkGetPhysicalDeviceSurfacePresentModesKHR( m_device, m_surface, &presentModesCount, nullptr );
+
+    if( presentModesCount )
+    {
+        details.presentModes.resize( presentModesCount );
+        vkGetPhysicalDeviceSurfacePresentModesKHR( m_device, m_surface, &presentModesCount, details.presentModes.data() );
+    }
+
+    return details;
+}
+
+bool core::checkDeviceExtensionSupport( const DeviceSnapshot& device )
+{
+    std::vector<const char*> deviceExtensions = requiredDeviceExtensions();
+
+    return std::all_of( deviceExtensions.begin(), deviceExtensions.end(), [&device]( const char* extension )
+    {
+        return device.hasExtension( extension );
+    } );
+}
+
+
+bool core::isDeviceSuitable( const DeviceSnapshot& device )
+{
+    if( m_headless )
+    {
+        return findQueueFamilies( device ).isComplete() && checkDeviceExtensionSupport( device );
+    }
+
+    return findQueueFamilies( device ).isComplete() && checkDeviceExtensionSupport( device ) && querySwapchainSupport( device.device ).isAdequate();
+}
+
+void core::pickPhysicalDevice()
+{
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices( m_instance, &deviceCount, nullptr );
+
+    if( deviceCount == 0 )
+    {
+        throw std::runtime_error( "Could not find m_device with Vulkan support!" );
+    }
+
+    std::vector<VkPhysicalDevice> devices( deviceCount );
+    vkEnumeratePhysicalDevices( m_instance, &deviceCount, devices.data() );
+
+    std::string selector = m_deviceSelector;
+    if( selector.empty() )
+    {
+        const char* environment = std::getenv( "VKSAMPLES_DEVICE" );
+        selector = environment != nullptr ? environment : "";
+    }
+
+    // The highest scoring suitable device, or the first suitable one the selector matches
+    const DeviceSnapshot* chosen = nullptr;
+    std::vector<DeviceSnapshot> snapshots;
+    snapshots.reserve( deviceCount );
+
+    for( uint32_t i = 0; i < deviceCount; i++ )
+    {
+        snapshots.push_back( DeviceSnapshot::capture( devices[i], i, m_apiVersion ) );
+    }
+
+    for( const auto& snapshot : snapshots )
+    {
+        const bool suitable = isDeviceSuitable( snapshot );
+        const DeviceSnapshot::Score score = snapshot.score();
+
+        std::cout << "GPU " << snapshot.index << ": " << snapshot.properties.deviceName << " (" << DeviceSnapshot::typeName( snapshot.properties.deviceType )
+            << ", " << score.deviceLocalBytes / ( 1024 * 1024 ) << " MB device local, " << score.features << " optional features"
+            << ( snapshot.hasUuid ? ", uuid " + snapshot.uuidString() : "" ) << ")" << ( suitable ? "" : " unsuitable" ) << std::endl;
+
+        if( !suitable )
+        {
+            continue;
+        }
+
+        if( !selector.empty() )
+        {
+            if( chosen == nullptr && snapshot.matches( selector ) )
+            {
+                chosen = &snapshot;
+            }
+        }
+        else if( chosen == nullptr || chosen->score() < score )
+        {
+            chosen = &snapshot;
+        }
+    }
+
+    if( chosen == nullptr )
+    {
+        throw std::runtime_error( selector.empty() ? "Could not find compatible m_device!" : "No suitable device matches " + selector );
+    }
+
+    m_deviceSnapshot = *chosen;
+    m_physicalDevice = m_deviceSnapshot.device;
+    m_queueFamilies = findQueueFamilies( m_deviceSnapshot );
+
+    std::cout << "Using GPU " << m_deviceSnapshot.index << ( selector.empty() ? " (highest score)" : " (selected by " + selector + ")" ) << std::endl;
+}
+
+void core::createLogicalDevice()
+{
+    const QueueFamilyIndices& indices = m_queueFamilies;
+    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+
+    if( indices.transferFamily.has_value() )
+    {
+        uniqueQueueFamilies.insert( indices.transferFamily.value() );
+    }
+    if( indices.computeFamily.has_value() )
+    {
+        uniqueQueueFamilies.insert( indices.computeFamily.value() );
+    }
+    float queuePriority = 1.0f;
+
+    for( const uint32_t queueFamily : uniqueQueueFamilies )
+    {
+        VkDeviceQueueCreateInfo queueCreateInfo{};
+        queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueCreateInfo.queueFamilyIndex = queueFamily;
+        queueCreateInfo.queueCount = 1;
+        queueCreateInfo.pQueuePriorities = &queuePriority;
+
+        queueCreateInfos.push_back( queueCreateInfo );
+    }
+
+    // Indirect draws with more than one command, and firstInstance as a per-draw index
+    const VkPhysicalDeviceFeatures& supportedFeatures = m_deviceSnapshot.features;
+    m_enabledFeatures = {};
+    m_enabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    m_enabledFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
+    std::vector<const char*> deviceExtensions = requiredDeviceExtensions();
+    m_enabledDeviceExtensions = std::set<std::string>( deviceExtensions.begin(), deviceExtensions.end() );
+
+    const std::vector<VkExtensionProperties>& availableExtensions = m_deviceSnapshot.extensions;
+
+    for( const char* extension : m_optionalDeviceExtensions )
+    {
+        bool supported = std::any_of( availableExtensions.begin(), availableExtensions.end(), [extension]( const VkExtensionProperties& properties )
+        {
+            return strcmp( properties.extensionName, extension ) == 0;
+        } );
+
+        if( supported && m_enabledDeviceExtensions.insert( extension ).second )
+        {
+            deviceExtensions.push_back( extension );
+        }
+    }
+
+    // Feature structs for vkCreateDevice, each pushed onto the front of the chain
+    void* featureChain = nullptr;
+
+    m_bindlessEnabled = m_bindlessRequested && enableDescriptorIndexing( availableExtensions, deviceExtensions, featureChain );
+    m_timelineSync = m_timelineRequested && enableTimelineSemaphores( availableExtensions, deviceExtensions, featureChain );
+    m_dynamicRendering = m_dynamicRenderingRequested && enableDynamicRendering( availableExtensions, deviceExtensions, featureChain );
+    m_pipelineLibrary = m_pipelineLibraryRequested && enableGraphicsPipelineLibrary( availableExtensions, deviceExtensions, featureChain );
+
+    VkDeviceCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = featureChain;
+    createInfo.queueCreateInfoCount = static_cast< uint32_t >( queueCreateInfos.size() );
+    createInfo.pQueueCreateInfos = queueCreateInfos.data();
+    createInfo.pEnabledFeatures = &m_enabledFeatures;
+    createInfo.enabledExtensionCount = static_cast< uint32_t >( deviceExtensions.size() );
+    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+
+    if( enableValidationLayers )
+    {
+        createInfo.enabledLayerCount = static_cast< uint32_t >( m_validationLayers.size() );
+        createInfo.ppEnabledLayerNames = m_validationLayers.data();
+    }
+    else
+    {
+        createInfo.enabledLayerCount = 0;
+    }
+
+    if( vkCreateDevice( m_physicalDevice, &createInfo, nullptr, &m_device ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Could not create Vulkan Logical Device!" );
+    }
+
+    if( m_dynamicRendering )
+    {
+        m_cmdBeginRendering = reinterpret_cast< PFN_vkCmdBeginRenderingKHR >( vkGetDeviceProcAddr( m_device, "vkCmdBeginRenderingKHR" ) );
+        m_cmdEndRendering = reinterpret_cast< PFN_vkCmdEndRenderingKHR >( vkGetDeviceProcAddr( m_device, "vkCmdEndRenderingKHR" ) );
+
+        if( m_cmdBeginRendering == nullptr || m_cmdEndRendering == nullptr )
+        {
+            throw std::runtime_error( "Dynamic rendering entry points not found" );
+        }
+    }
+
+    vkGetDeviceQueue( m_device, indices.graphicsFamily.value(), 0, &m_graphicsQueue );
+    vkGetDeviceQueue( m_device, indices.presentFamily.value(), 0, &m_presentQueue );
+
+    // Without dedicated families the graphics queue does the work, in submission order
+    m_graphicsFamily = indices.graphicsFamily.value();
+    m_transferFamily = indices.transferFamily.value_or( m_graphicsFamily );
+    m_computeFamily = indices.computeFamily.value_or( m_graphicsFamily );
+    vkGetDeviceQueue( m_device, m_transferFamily, 0, &m_transferQueue );
+    vkGetDeviceQueue( m_device, m_computeFamily, 0, &m_computeQueue );
+
+    m_allocator.init( m_device, m_deviceSnapshot );
+
+    const VkPhysicalDeviceProperties& properties = m_deviceSnapshot.properties;
+    m_maxComputeGroupCountX = properties.limits.maxComputeWorkGroupCount[0];
+
+    // Sized for the most slots SetFramesInFlight allows, so the ring never needs rebuilding
+    m_uploadRing.init( m_device, m_allocator, m_uploadRingSize, properties.limits.optimalBufferCopyOffsetAlignment, MAX_FRAMES_IN_FLIGHT );
+
+    VkCommandPoolCreateInfo uploadPoolInfo{};
+    uploadPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    uploadPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    uploadPoolInfo.queueFamilyIndex = indices.graphicsFamily.value();
+
+    if( vkCreateCommandPool( m_device, &uploadPoolInfo, nullptr, &m_uploadCommandPool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create upload command pool!" );
+    }
+
+    VkCommandBufferAllocateInfo uploadBufferInfo{};
+    uploadBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    uploadBufferInfo.commandBufferCount = 1;
+    uploadBufferInfo.commandPool = m_uploadCommandPool;
+    uploadBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+    if( vkAllocateCommandBuffers( m_device, &uploadBufferInfo, &m_uploadCommandBuffer ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create upload command buffer!" );
+    }
+
+    m_asyncUploader.init( m_device, m_allocator, m_transferQueue, m_transferFamily, m_graphicsFamily );
+
+    if( m_timelineSync )
+    {
+        m_frameTimeline.init( m_device, m_timelineKhr );
+        m_transferTimeline.init( m_device, m_timelineKhr );
+        m_asyncUploader.useTimeline( m_transferTimeline );
+    }
+
+    m_descriptorLayouts.init( m_device );
+    m_descriptorAllocator.init( m_device, MAX_FRAMES_IN_FLIGHT );
+
+    if( m_bindlessEnabled )
+    {
+        m_bindless.init( m_device, m_descriptorLayouts, m_bindlessImages, m_bindlessBuffers, m_bindlessSamplers );
+    }
+
+    createPipelineCache();
+    m_shaderModules.init( m_device );
+    m_pipelineCompiler.init( m_device, m_pipelineCache, m_shaderModules );
+    if( m_pipelineLibrary )
+    {
+        m_pipelineCompiler.useLibraries();
+    }
+
+    // Shared by parallel command recording and batch pipeline compiles
+    m_threadPool = std::make_unique<ThreadPool>( m_workerThreads != 0 ? m_workerThreads : std::max( std::thread::hardware_concurrency(), 1u ) );
+
+    chooseSwapchainFormat();
+}
+
+static bool hasExtension( const std::vector<VkExtensionProperties>& availableExtensions, const char* name )
+{
+    return std::any_of( availableExtensions.begin(), availableExtensions.end(), [name]( const VkExtensionProperties& properties )
+    {
+        return strcmp( properties.extensionName, name ) == 0;
+    } );
+}
+
+// The version both the instance and the device speak
+uint32_t core::deviceApiVersion()
+{
+    return std::min( m_deviceSnapshot.properties.apiVersion, m_apiVersion );
+}
 
-    VkInstanceCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-    createInfo.pApplicationInfo = &appInfo;
-    createInfo.enabledExtensionCount = static_cast< uint32_t >( m_instanceExtensions.size() );
-    createInfo.ppEnabledExtensionNames = m_instanceExtensions.data();
+// Core in 1.2, VK_KHR_timeline_semaphore on top of 1.1
+bool core::enableTimelineSemaphores( const std::vector<VkExtensionProperties>& availableExtensions, std::vector<const char*>& deviceExtensions, void*& featureChain )
+{
+    const uint32_t apiVersion = deviceApiVersion();
 
-    if( enableValidationLayers )
+    if( apiVersion < VK_API_VERSION_1_1 || ( apiVersion < VK_API_VERSION_1_2 && !hasExtension( availableExtensions, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME ) ) )
     {
-        if( !checkValidationLayerSupport() )
-        {
-            throw std::runtime_error( "Validation Layer requested but not supported" );
-        }
-
-        createInfo.enabledLayerCount = static_cast< uint32_t >( m_validationLayers.size() );
-        createInfo.ppEnabledLayerNames = m_validationLayers.data();
+        std::cout << "Timeline semaphores not supported, synchronizing with fences" << std::endl;
+        return false;
     }
-    else
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &supported;
+    vkGetPhysicalDeviceFeatures2( m_physicalDevice, &features );
+
+    if( !supported.timelineSemaphore )
     {
-        createInfo.enabledLayerCount = 0;
+        std::cout << "Timeline semaphores not supported, synchronizing with fences" << std::endl;
+        return false;
     }
 
-    VkResult result = vkCreateInstance( &createInfo, nullptr, &m_instance );
-    if( result != VK_SUCCESS )
+    m_timelineFeatures = {};
+    m_timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    m_timelineFeatures.pNext = featureChain;
+    m_timelineFeatures.timelineSemaphore = VK_TRUE;
+    featureChain = &m_timelineFeatures;
+
+    m_timelineKhr = apiVersion < VK_API_VERSION_1_2;
+    if( m_timelineKhr && m_enabledDeviceExtensions.insert( VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME ).second )
     {
-        throw std::runtime_error( "Failed to create Instance!" );
+        deviceExtensions.push_back( VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME );
     }
+
+    return true;
 }
 
-void core::createSurface( HINSTANCE hInstance, HWND window )
+// VK_EXT_graphics_pipeline_library on top of VK_KHR_pipeline_library. Without fast linking
+// the unoptimized link still works, it is just not guaranteed to be cheap.
+bool core::enableGraphicsPipelineLibrary( const std::vector<VkExtensionProperties>& availableExtensions, std::vector<const char*>& deviceExtensions, void*& featureChain )
 {
-    VkWin32SurfaceCreateInfoKHR createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
-    createInfo.hinstance = hInstance;
-    createInfo.hwnd = window;
-
-    if( vkCreateWin32SurfaceKHR( m_instance, &createInfo, nullptr, &m_surface ) )
+    if( deviceApiVersion() < VK_API_VERSION_1_1 ||
+        !hasExtension( availableExtensions, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME ) ||
+        !hasExtension( availableExtensions, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME ) )
     {
-        throw std::runtime_error( "Error creating Win32 surface" );
+        std::cout << "Graphics pipeline libraries not supported, compiling whole pipelines" << std::endl;
+        return false;
     }
-}
 
-core::QueueFamilyIndices core::findQueueFamilies( VkPhysicalDevice m_device )
-{
-    core::QueueFamilyIndices indices;
-    uint32_t queueFamilyCount = 0;
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
 
-    vkGetPhysicalDeviceQueueFamilyProperties( m_device, &queueFamilyCount, nullptr );
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &supported;
+    vkGetPhysicalDeviceFeatures2( m_physicalDevice, &features );
 
-    std::vector<VkQueueFamilyProperties> queueFamilies( queueFamilyCount );
-    vkGetPhysicalDeviceQueueFamilyProperties( m_device, &queueFamilyCount, queueFamilies.data() );
+    if( !supported.graphicsPipelineLibrary )
+    {
+        std::cout << "Graphics pipeline libraries not supported, compiling whole pipelines" << std::endl;
+        return false;
+    }
 
-    int i = 0;
+    VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT libraryProperties{};
+    libraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
 
-    for( const auto& queueFamily : queueFamilies )
-    {
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR( m_device, i, m_surface, &presentSupport );
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &libraryProperties;
+    vkGetPhysicalDeviceProperties2( m_physicalDevice, &properties2 );
 
-        if( presentSupport )
-        {
-            indices.presentFamily = i;
-        }
+    m_pipelineLibraryFastLinking = libraryProperties.graphicsPipelineLibraryFastLinking == VK_TRUE;
 
-        if( queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT )
+    m_pipelineLibraryFeatures = {};
+    m_pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    m_pipelineLibraryFeatures.pNext = featureChain;
+    m_pipelineLibraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+    featureChain = &m_pipelineLibraryFeatures;
+
+    for( const char* extension : { VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME } )
+    {
+        if( m_enabledDeviceExtensions.insert( extension ).second )
         {
-            indices.graphicsFamily = i;
-            break;
+            deviceExtensions.push_back( extension );
         }
-
-        i++;
     }
 
-    return indices;
+    return true;
 }
 
-core::SwapchainSupportDetails core::querySwapchainSupport( VkPhysicalDevice m_device )
+// The extension's dependencies, VK_KHR_create_renderpass2 and VK_KHR_depth_stencil_resolve, are
+// core in 1.2, so 1.2 is the minimum here
+bool core::enableDynamicRendering( const std::vector<VkExtensionProperties>& availableExtensions, std::vector<const char*>& deviceExtensions, void*& featureChain )
 {
-    core::SwapchainSupportDetails details;
+    if( deviceApiVersion() < VK_API_VERSION_1_2 || !hasExtension( availableExtensions, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME ) )
+    {
+        std::cout << "Dynamic rendering not supported, using a render pass" << std::endl;
+        return false;
+    }
 
-    vkGetPhysicalDeviceSurfaceCapabilitiesKHR( m_device, m_surface, &details.capabilities );
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
 
-    uint32_t formatsCount = 0;
-    vkGetPhysicalDeviceSurfaceFormatsKHR( m_device, m_surface, &formatsCount, nullptr );
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &supported;
+    vkGetPhysicalDeviceFeatures2( m_physicalDevice, &features );
 
-    if( formatsCount )
+    if( !supported.dynamicRendering )
     {
-        details.formats.resize( formatsCount );
-        vkGetPhysicalDeviceSurfaceFormatsKHR( m_device, m_surface, &formatsCount, details.formats.data() );
+        std::cout << "Dynamic rendering not supported, using a render pass" << std::endl;
+        return false;
     }
 
-    uint32_t presentModesCount = 0;
-    vkGetPhysicalDeviceSurfacePresentModesKHR( m_device, m_surface, &presentModesCount, nullptr );
+    m_dynamicRenderingFeatures = {};
+    m_dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    m_dynamicRenderingFeatures.pNext = featureChain;
+    m_dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+    featureChain = &m_dynamicRenderingFeatures;
 
-    if( presentModesCount )
+    if( m_enabledDeviceExtensions.insert( VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME ).second )
     {
-        details.presentModes.resize( presentModesCount );
-        vkGetPhysicalDeviceSurfacePresentModesKHR( m_device, m_surface, &presentModesCount, details.presentModes.data() );
+        deviceExtensions.push_back( VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME );
     }
 
-    return details;
+    return true;
 }
 
-bool core::checkDeviceExtensionSupport( VkPhysicalDevice m_device )
+// Checks the features bindless mode needs, clamps the heap capacities to the update-after-bind
+// limits and adds what to enable to the device create info
+bool core::enableDescriptorIndexing( const std::vector<VkExtensionProperties>& availableExtensions, std::vector<const char*>& deviceExtensions, void*& featureChain )
 {
-    uint32_t extensionsCount = 0;
-    vkEnumerateDeviceExtensionProperties( m_device, nullptr, &extensionsCount, nullptr );
+    const uint32_t apiVersion = deviceApiVersion();
+
+    // Core in 1.2, an extension on top of 1.1 which has vkGetPhysicalDeviceFeatures2
+    const bool extension = hasExtension( availableExtensions, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME );
+
+    if( apiVersion < VK_API_VERSION_1_1 || ( apiVersion < VK_API_VERSION_1_2 && !extension ) )
+    {
+        std::cout << "Descriptor indexing not supported, bindless mode disabled" << std::endl;
+        return false;
+    }
 
-    std::vector<VkExtensionProperties> availableExtensions( extensionsCount );
-    vkEnumerateDeviceExtensionProperties( m_device, nullptr, &extensionsCount, availableExtensions.data() );
+    VkPhysicalDeviceDescriptorIndexingFeatures supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
 
-    std::set<std::string> requiredExtensions( m_deviceExtensions.begin(), m_deviceExtensions.end() );
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &supported;
+    vkGetPhysicalDeviceFeatures2( m_physicalDevice, &features );
 
-    for( const auto& extension : availableExtensions )
+    if( !supported.runtimeDescriptorArray || !supported.descriptorBindingPartiallyBound ||
+        !supported.descriptorBindingUpdateUnusedWhilePending ||
+        !supported.descriptorBindingSampledImageUpdateAfterBind || !supported.descriptorBindingStorageBufferUpdateAfterBind ||
+        !supported.shaderSampledImageArrayNonUniformIndexing || !supported.shaderStorageBufferArrayNonUniformIndexing )
     {
-        requiredExtensions.erase( extension.extensionName );
+        std::cout << "Descriptor indexing lacks update-after-bind or non-uniform indexing, bindless mode disabled" << std::endl;
+        return false;
     }
 
-    return requiredExtensions.empty();
-}
+    VkPhysicalDeviceDescriptorIndexingProperties limits{};
+    limits.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
 
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &limits;
+    vkGetPhysicalDeviceProperties2( m_physicalDevice, &properties2 );
 
-bool core::isDeviceSuitable( VkPhysicalDevice m_device )
-{
-    return findQueueFamilies( m_device ).isComplete() && checkDeviceExtensionSupport( m_device ) && querySwapchainSupport( m_device ).isAdequate();
+    // Every binding is visible to all stages, so the per-stage limits apply to the whole set
+    m_bindlessSamplers = std::min( { m_bindlessSamplers, limits.maxPerStageDescriptorUpdateAfterBindSamplers, limits.maxDescriptorSetUpdateAfterBindSamplers } );
+    m_bindlessImages = std::min( { m_bindlessImages, limits.maxPerStageDescriptorUpdateAfterBindSampledImages, limits.maxDescriptorSetUpdateAfterBindSampledImages } );
+    m_bindlessBuffers = std::min( { m_bindlessBuffers, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers, limits.maxDescriptorSetUpdateAfterBindStorageBuffers } );
+
+    const uint32_t resources = limits.maxPerStageUpdateAfterBindResources - m_bindlessSamplers;
+    if( m_bindlessImages + m_bindlessBuffers > resources )
+    {
+        m_bindlessImages = std::min( m_bindlessImages, resources / 2 );
+        m_bindlessBuffers = std::min( m_bindlessBuffers, resources - m_bindlessImages );
+    }
+
+    m_descriptorIndexingFeatures = {};
+    m_descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    m_descriptorIndexingFeatures.pNext = featureChain;
+    m_descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+    m_descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+    m_descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    m_descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    m_descriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    m_descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    m_descriptorIndexingFeatures.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+    featureChain = &m_descriptorIndexingFeatures;
+
+    if( apiVersion < VK_API_VERSION_1_2 && m_enabledDeviceExtensions.insert( VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME ).second )
+    {
+        deviceExtensions.push_back( VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME );
+    }
+
+    std::cout << "Bindless: " << m_bindlessImages << " images, " << m_bindlessBuffers << " buffers, " << m_bindlessSamplers << " samplers" << std::endl;
+    return true;
 }
 
-void core::pickPhysicalDevice()
+bool core::isPipelineCacheCompatible( const std::vector<char>& data )
 {
-    uint32_t deviceCount = 0;
-    vkEnumeratePhysicalDevices( m_instance, &deviceCount, nullptr );
+    // VkPipelineCacheHeaderVersionOne: headerSize, headerVersion, vendorID, deviceID, pipelineCacheUUID
+    const size_t headerSize = 4 * sizeof( uint32_t ) + VK_UUID_SIZE;
 
-    if( deviceCount == 0 )
+    if( data.size() < headerSize )
     {
-        throw std::runtime_error( "Could not find m_device with Vulkan support!" );
+        return false;
     }
 
-    std::vector<VkPhysicalDevice> devices( deviceCount );
-    vkEnumeratePhysicalDevices( m_instance, &deviceCount, devices.data() );
+    uint32_t header[4];
+    memcpy( header, data.data(), sizeof( header ) );
+
+    const VkPhysicalDeviceProperties& properties = m_deviceSnapshot.properties;
+
+    return header[0] >= headerSize &&
+        header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        header[2] == properties.vendorID &&
+        header[3] == properties.deviceID &&
+        memcmp( data.data() + sizeof( header ), properties.pipelineCacheUUID, VK_UUID_SIZE ) == 0;
+}
+
+void core::createPipelineCache()
+{
+    std::vector<char> data;
 
-    for( const auto& m_device : devices )
+    if( !m_pipelineCachePath.empty() && std::filesystem::exists( m_pipelineCachePath ) )
     {
-        if( isDeviceSuitable( m_device ) )
-        {
-            m_physicalDevice = m_device;
+        data = readFile( m_pipelineCachePath );
 
-            // stop and use first available physical m_device
-            break;
+        // A cache from another driver or GPU is ignored rather than handed to the driver
+        if( !isPipelineCacheCompatible( data ) )
+        {
+            std::cout << "Discarding incompatible pipeline cache " << m_pipelineCachePath << std::endl;
+            data.clear();
         }
     }
 
-    if( m_physicalDevice == VK_NULL_HANDLE )
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if( vkCreatePipelineCache( m_device, &createInfo, nullptr, &m_pipelineCache ) != VK_SUCCESS )
     {
-        throw std::runtime_error( "Could not find compatible m_device!" );
+        throw std::runtime_error( "Failed to create pipeline cache!" );
     }
+
+    m_pipelineCacheWarm = !data.empty();
 }
 
-void core::createLogicalDevice()
+void core::savePipelineCache()
 {
-    QueueFamilyIndices indices = findQueueFamilies( m_physicalDevice );
-    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
-    float queuePriority = 1.0f;
-
-    for( const uint32_t queueFamily : uniqueQueueFamilies )
+    if( m_pipelineCachePath.empty() || m_pipelineCache == VK_NULL_HANDLE )
     {
-        VkDeviceQueueCreateInfo queueCreateInfo{};
-        queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueCreateInfo.queueFamilyIndex = queueFamily;
-        queueCreateInfo.queueCount = 1;
-        queueCreateInfo.pQueuePriorities = &queuePriority;
-
-        queueCreateInfos.push_back( queueCreateInfo );
+        return;
     }
 
-    VkPhysicalDeviceFeatures deviceFeatures{};
-
-    VkDeviceCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    createInfo.queueCreateInfoCount = static_cast< uint32_t >( queueCreateInfos.size() );
-    createInfo.pQueueCreateInfos = queueCreateInfos.data();
-    createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast< uint32_t >( m_deviceExtensions.size() );
-    createInfo.ppEnabledExtensionNames = m_deviceExtensions.data();
+    size_t size = 0;
+    vkGetPipelineCacheData( m_device, m_pipelineCache, &size, nullptr );
 
-    if( enableValidationLayers )
+    std::vector<char> data( size );
+    if( vkGetPipelineCacheData( m_device, m_pipelineCache, &size, data.data() ) != VK_SUCCESS )
     {
-        createInfo.enabledLayerCount = static_cast< uint32_t >( m_validationLayers.size() );
-        createInfo.ppEnabledLayerNames = m_validationLayers.data();
+        std::cerr << "Failed to read back pipeline cache" << std::endl;
+        return;
     }
-    else
+
+    // Write next to the target and rename over it so a crash never leaves a torn cache
+    const std::string tempPath = m_pipelineCachePath + ".tmp";
     {
-        createInfo.enabledLayerCount = 0;
+        std::ofstream file( tempPath, std::ios::binary | std::ios::trunc );
+        file.write( data.data(), static_cast< std::streamsize >( size ) );
+
+        if( !file.good() )
+        {
+            std::cerr << "Failed to write pipeline cache " << tempPath << std::endl;
+            return;
+        }
     }
 
-    if( vkCreateDevice( m_physicalDevice, &createInfo, nullptr, &m_device ) != VK_SUCCESS )
+    std::error_code error;
+    std::filesystem::rename( tempPath, m_pipelineCachePath, error );
+
+    if( error )
     {
-        throw std::runtime_error( "Could not create Vulkan Logical Device!" );
+        std::cerr << "Failed to replace pipeline cache " << m_pipelineCachePath << ": " << error.message() << std::endl;
+        std::filesystem::remove( tempPath, error );
     }
-
-    vkGetDeviceQueue( m_device, indices.graphicsFamily.value(), 0, &m_graphicsQueue );
-    vkGetDeviceQueue( m_device, indices.presentFamily.value(), 0, &m_presentQueue );
 }
 
 VkSurfaceFormatKHR core::chooseSwapSurfaceFormat( const std::vector<VkSurfaceFormatKHR> availableFormats )
@@ -413,9 +1533,30 @@ VkSurfaceFormatKHR core::chooseSwapSurfaceFormat( const std::vector<VkSurfaceFor
     return availableFormats[0];
 }
 
+// Fixed for the lifetime of the device, so the render pass and pipelines can be created while
+// the swapchain is, and survive every recreation
+void core::chooseSwapchainFormat()
+{
+    if( m_headless )
+    {
+        m_surfaceFormat = { m_headlessFormat, VK_COLORSPACE_SRGB_NONLINEAR_KHR };
+    }
+    else
+    {
+        m_surfaceFormat = chooseSwapSurfaceFormat( querySwapchainSupport( m_physicalDevice ).formats );
+    }
+
+    m_swapchainFormat = m_surfaceFormat.format;
+}
+
 VkPresentModeKHR core::chooseSwapPresentMode( const std::vector<VkPresentModeKHR> availablePresentModes )
 {
-    return VK_PRESENT_MODE_FIFO_KHR;
+    if( m_requestedPresentMode.has_value() )
+    {
+        return ChoosePresentMode( m_requestedPresentMode.value(), m_presentGoal, availablePresentModes );
+    }
+
+    return ChoosePresentMode( m_presentGoal, availablePresentModes );
 }
 
 VkExtent2D core::chooseSwapExtent( HWND window, VkSurfaceCapabilitiesKHR& capabilities )
@@ -426,6 +1567,7 @@ VkExtent2D core::chooseSwapExtent( HWND window, VkSurfaceCapabilitiesKHR& capabi
     }
     else
     {
+#ifdef _WIN32
         RECT rect;
         GetWindowRect( window, &rect );
 
@@ -438,20 +1580,45 @@ VkExtent2D core::chooseSwapExtent( HWND window, VkSurfaceCapabilitiesKHR& capabi
         extent.height = std::clamp( extent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height );
 
         return extent;
+#else
+        return capabilities.minImageExtent;
+#endif
     }
 }
 
+uint32_t core::findMemoryType( uint32_t typeFilter, VkMemoryPropertyFlags properties )
+{
+    // Memory properties are cached by the allocator when the device is created
+    return m_allocator.findMemoryType( typeFilter, properties );
+}
+
 void core::createSwapchain( HWND window )
 {
+    if( m_headless )
+    {
+        createOffscreenSwapchain();
+        return;
+    }
+
+    m_window = window;
+
     SwapchainSupportDetails swapchainSupport = querySwapchainSupport( m_physicalDevice );
 
-    VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat( swapchainSupport.formats );
+    if( chooseSwapSurfaceFormat( swapchainSupport.formats ).format != m_swapchainFormat )
+    {
+        throw std::runtime_error( "Swapchain format changed, the render pass is no longer compatible" );
+    }
+
+    const VkSurfaceFormatKHR surfaceFormat = m_surfaceFormat;
     VkPresentModeKHR presentMode = chooseSwapPresentMode( swapchainSupport.presentModes );
     VkExtent2D extent = chooseSwapExtent( window, swapchainSupport.capabilities );
-    uint32_t imageCount = std::clamp(
-        swapchainSupport.capabilities.minImageCount + 1,
-        swapchainSupport.capabilities.minImageCount,
-        swapchainSupport.capabilities.maxImageCount );
+    uint32_t imageCount = swapchainSupport.capabilities.minImageCount + 1;
+
+    // maxImageCount 0 means no upper limit
+    if( swapchainSupport.capabilities.maxImageCount != 0 )
+    {
+        imageCount = std::min( imageCount, swapchainSupport.capabilities.maxImageCount );
+    }
 
     VkSwapchainCreateInfoKHR createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -465,10 +1632,11 @@ void core::createSwapchain( HWND window )
     createInfo.preTransform = swapchainSupport.capabilities.currentTransform;
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    // Lets the driver hand resources over from the swapchain being replaced, if any
+    createInfo.oldSwapchain = m_swapchain;
     createInfo.minImageCount = imageCount;
 
-    QueueFamilyIndices indices = findQueueFamilies( m_physicalDevice );
+    const QueueFamilyIndices& indices = m_queueFamilies;
 
     if( indices.graphicsFamily != indices.presentFamily )
     {
@@ -497,7 +1665,142 @@ void core::createSwapchain( HWND window )
     vkGetSwapchainImagesKHR( m_device, m_swapchain, &imageCount, m_swapchainImages.data() );
 
     m_swapchainExtent = extent;
-    m_swapchainFormat = surfaceFormat.format;
+
+    if( m_presentMode != presentMode || m_swapchainRecreates == 0 )
+    {
+        std::cout << "Present mode: " << PresentModeName( presentMode ) << " (goal: " << PresentGoalName( m_presentGoal ) << ")" << std::endl;
+    }
+    m_presentMode = presentMode;
+}
+
+// Rebuilds only what depends on the swapchain images: the swapchain itself, image views and
+// framebuffers. Render pass and pipelines are kept, viewport and scissor are dynamic. The old
+// objects are destroyed once every frame submitted so far has completed.
+void core::recreateSwapchain()
+{
+    TimingStats::Clock::time_point start = TimingStats::Clock::now();
+
+    if( !m_headless )
+    {
+#ifdef _WIN32
+        // A minimized window has a zero sized surface; wait until it comes back
+        VkSurfaceCapabilitiesKHR capabilities;
+        vkGetPhysicalDeviceSurfaceCapabilitiesKHR( m_physicalDevice, m_surface, &capabilities );
+
+        while( capabilities.currentExtent.width == 0 || capabilities.currentExtent.height == 0 )
+        {
+            WaitMessage();
+
+            MSG msg;
+            while( PeekMessage( &msg, NULL, 0, 0, PM_REMOVE ) )
+            {
+                TranslateMessage( &msg );
+                DispatchMessage( &msg );
+            }
+
+            vkGetPhysicalDeviceSurfaceCapabilitiesKHR( m_physicalDevice, m_surface, &capabilities );
+        }
+#endif
+    }
+
+    if( m_recreateWaitIdle )
+    {
+        vkDeviceWaitIdle( m_device );
+    }
+
+    std::vector<VkFramebuffer> oldFramebuffers;
+    std::vector<VkImageView> oldImageViews;
+    std::vector<VkImage> oldImages;
+    std::vector<Allocation> oldAllocations;
+    oldFramebuffers.swap( m_swapchainFramebuffers );
+    oldImageViews.swap( m_swapchainImageViews );
+    oldImages.swap( m_swapchainImages );
+    oldAllocations.swap( m_offscreenImageAllocations );
+    VkSwapchainKHR oldSwapchain = m_swapchain;
+
+    createSwapchain( m_window );
+
+    createImageViews();
+    createFramebuffers();
+
+    m_imageFrames.assign( m_swapchainImages.size(), 0 );
+    m_offscreenNextImage = 0;
+
+    const bool headless = m_headless;
+    m_deletionQueue.push( m_submittedFrames, [this, headless, oldFramebuffers, oldImageViews, oldImages, oldAllocations, oldSwapchain]() mutable
+    {
+        for( auto framebuffer : oldFramebuffers )
+        {
+            vkDestroyFramebuffer( m_device, framebuffer, nullptr );
+        }
+        for( auto imageView : oldImageViews )
+        {
+            vkDestroyImageView( m_device, imageView, nullptr );
+        }
+        if( headless )
+        {
+            for( size_t i = 0; i < oldImages.size(); i++ )
+            {
+                vkDestroyImage( m_device, oldImages[i], nullptr );
+                m_allocator.free( oldAllocations[i] );
+            }
+        }
+        else
+        {
+            vkDestroySwapchainKHR( m_device, oldSwapchain, nullptr );
+        }
+    } );
+
+    if( m_recreateWaitIdle )
+    {
+        m_deletionQueue.flush();
+    }
+
+    m_swapchainDirty = false;
+    m_recreatedThisFrame = true;
+    m_swapchainRecreates++;
+
+    m_timing.record( m_swapchainRecreateSeries, start, TimingStats::Clock::now() );
+}
+
+void core::createOffscreenSwapchain()
+{
+    // One image more than frames in flight, mirroring minImageCount + 1 on a real swapchain
+    const uint32_t imageCount = m_framesInFlight + 1;
+
+    m_swapchainImages.resize( imageCount );
+    m_offscreenImageAllocations.resize( imageCount );
+
+    for( uint32_t i = 0; i < imageCount; i++ )
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = m_headlessFormat;
+        imageInfo.extent = { m_headlessExtent.width, m_headlessExtent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if( vkCreateImage( m_device, &imageInfo, nullptr, &m_swapchainImages[i] ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Could not create offscreen render target!" );
+        }
+
+        VkMemoryRequirements memoryRequirements;
+        vkGetImageMemoryRequirements( m_device, m_swapchainImages[i], &memoryRequirements );
+
+        Allocation& allocation = m_offscreenImageAllocations[i];
+        allocation = m_allocator.allocate( memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true );
+
+        vkBindImageMemory( m_device, m_swapchainImages[i], allocation.memory, allocation.offset );
+    }
+
+    m_swapchainExtent = m_headlessExtent;
 }
 
 void core::createImageViews()
@@ -528,8 +1831,14 @@ void core::createImageViews()
     }
 }
 
+// With dynamic rendering there is no render pass; pipelines name the attachment format instead
 void core::createRenderPass()
 {
+    if( m_dynamicRendering )
+    {
+        return;
+    }
+
     VkAttachmentDescription attachment{};
     attachment.format = m_swapchainFormat;
     attachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -538,7 +1847,7 @@ void core::createRenderPass()
     attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    attachment.finalLayout = m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference attachmentRef{};
     attachmentRef.attachment = 0;
@@ -568,184 +1877,228 @@ void core::createRenderPass()
 
     if( vkCreateRenderPass( m_device, &renderPassInfo, nullptr, &m_renderPass ) != VK_SUCCESS )
     {
-        throw std::runtime_error( "Failed to create Render pass!" );
+        throw std::runtime_error( "Failed to create Render pass!" );
+    }
+}
+
+std::vector<char> core::readFile( const std::string& fileName )
+{
+    std::ifstream file( fileName, std::ios::ate | std::ios::binary );
+
+    if( !file.is_open() )
+    {
+        throw std::runtime_error( "Error while opening file" );
+    }
+
+    size_t fileSize = file.tellg();
+    std::vector<char> buffer( fileSize );
+
+    file.seekg( 0 );
+    file.read( buffer.data(), fileSize );
+
+    file.close();
+
+    return buffer;
+}
+
+VkShaderModule core::createShaderModule( const std::string& spvPath )
+{
+    // Owned by the cache and shared between pipelines, destroyed in cleanup()
+    return m_shaderModules.get( spvPath );
+}
+
+void core::createGraphicsPipeline( std::string vertSpv, std::string fragSpv )
+{
+    createGraphicsPipeline( vertSpv, fragSpv, 0, nullptr, 0, nullptr );
+}
+
+// The specialization infos are copied, they only need to live for the call
+void core::createGraphicsPipeline( std::string vertSpv, std::string fragSpv, uint32_t numVertexInputBindings, VkVertexInputBindingDescription* vertexInputBindings, uint32_t numVertexInputAttributes, VkVertexInputAttributeDescription* vertexInputAttributes,
+    const VkSpecializationInfo* vertSpecialization, const VkSpecializationInfo* fragSpecialization )
+{
+    m_pipelineLayout = m_descriptorLayouts.getPipelineLayout( m_graphicsSetLayouts, m_graphicsPushConstantRanges );
+
+    GraphicsPipelineDesc desc;
+    desc.vertSpv = vertSpv;
+    desc.fragSpv = fragSpv;
+    desc.vertexBindings.assign( vertexInputBindings, vertexInputBindings + numVertexInputBindings );
+    desc.vertexAttributes.assign( vertexInputAttributes, vertexInputAttributes + numVertexInputAttributes );
+    desc.vertConstants = SpecializationConstants( vertSpecialization );
+    desc.fragConstants = SpecializationConstants( fragSpecialization );
+    desc.layout = m_pipelineLayout;
+
+    // Replaced by this call; frames in flight may still use it
+    if( m_pipeline != VK_NULL_HANDLE )
+    {
+        VkPipeline oldPipeline = m_pipeline;
+        m_pipeline = VK_NULL_HANDLE;
+        deferDestroy( [this, oldPipeline]()
+        {
+            vkDestroyPipeline( m_device, oldPipeline, nullptr );
+        } );
+    }
+
+    if( m_pipelineLibrary )
+    {
+        // A pipeline still being optimized for an earlier call is no longer wanted
+        if( m_optimizedPipeline.valid() )
+        {
+            vkDestroyPipeline( m_device, m_optimizedPipeline.get(), nullptr );
+        }
+
+        TimingStats::Clock::time_point start = TimingStats::Clock::now();
+        double linkTime = 0.0;
+        m_pipeline = m_pipelineCompiler.link( desc, GetPipelineTarget(), false, &linkTime );
+        std::chrono::duration<double, std::milli> totalTime = TimingStats::Clock::now() - start;
+
+        m_timing.record( m_pipelineCreateSeries, totalTime.count() );
+        std::cout << "Pipeline linked in " << linkTime << " ms, " << totalTime.count() << " ms with its library parts ("
+            << ( m_pipelineLibraryFastLinking ? "fast linking" : "no fast linking" ) << ", "
+            << ( m_pipelineCacheWarm ? "warm" : "cold" ) << " pipeline cache)" << std::endl;
+
+        m_optimizedPipelineStart = TimingStats::Clock::now();
+        m_optimizedPipeline = m_pipelineCompiler.linkOptimizedAsync( desc, GetPipelineTarget() );
+        return;
+    }
+
+    double compileTime = 0.0;
+    m_pipeline = m_pipelineCompiler.compile( desc, GetPipelineTarget(), &compileTime );
+
+    m_timing.record( m_pipelineCreateSeries, compileTime );
+    std::cout << "Pipeline created in " << compileTime << " ms ("
+        << ( m_pipelineCacheWarm ? "warm" : "cold" ) << " pipeline cache)" << std::endl;
+}
+
+// Replaces the fast-linked pipeline once the background link is done. Frames in flight may
+// still use the old one, so it goes through the deletion queue.
+void core::swapInOptimizedPipeline()
+{
+    if( !m_optimizedPipeline.valid() || m_optimizedPipeline.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+    {
+        return;
     }
+
+    VkPipeline fastPipeline = m_pipeline;
+    m_pipeline = m_optimizedPipeline.get();
+    deferDestroy( [this, fastPipeline]()
+    {
+        vkDestroyPipeline( m_device, fastPipeline, nullptr );
+    } );
+
+    std::chrono::duration<double, std::milli> waited = TimingStats::Clock::now() - m_optimizedPipelineStart;
+    std::cout << "Optimized pipeline swapped in after " << waited.count() << " ms" << std::endl;
 }
 
-std::vector<char> core::readFile( const std::string& fileName )
+// Compiles every description on the worker threads against core's pipeline cache. Descriptions
+// without a layout get the one SetGraphicsPipelineLayout describes. Caller owns the pipelines.
+std::vector<VkPipeline> core::CompileGraphicsPipelines( std::vector<GraphicsPipelineDesc> descs )
 {
-    std::ifstream file( fileName, std::ios::ate | std::ios::binary );
-
-    if( !file.is_open() )
+    VkPipelineLayout defaultLayout = m_descriptorLayouts.getPipelineLayout( m_graphicsSetLayouts, m_graphicsPushConstantRanges );
+    for( auto& desc : descs )
     {
-        throw std::runtime_error( "Error while opening file" );
+        if( desc.layout == VK_NULL_HANDLE )
+        {
+            desc.layout = defaultLayout;
+        }
     }
 
-    size_t fileSize = file.tellg();
-    std::vector<char> buffer( fileSize );
+    PipelineCompiler::BatchStats stats;
+    std::vector<VkPipeline> pipelines = m_pipelineCompiler.compileBatch( descs, GetPipelineTarget(), m_threadPool.get(), stats );
 
-    file.seekg( 0 );
-    file.read( buffer.data(), fileSize );
+    m_timing.record( m_pipelineBatchSeries, stats.wallMs );
+    m_pipelineBatchPipelines += stats.pipelines;
+    m_pipelineBatchWallMs += stats.wallMs;
+    m_pipelineBatchCompileMs += stats.compileMs;
 
-    file.close();
+    std::cout << "Compiled " << stats.pipelines << " pipelines on " << stats.threads << " thread(s) in " << stats.wallMs << " ms, "
+        << stats.compileMs << " ms of compile time (" << stats.compileMs / std::max( stats.wallMs, 0.001 ) << "x), slowest "
+        << stats.slowestMs << " ms (" << ( m_pipelineCacheWarm ? "warm" : "cold" ) << " pipeline cache)" << std::endl;
 
-    return buffer;
+    return pipelines;
 }
 
-VkShaderModule core::createShaderModule( const std::vector<char> code )
+// One pipeline per shader, state and specialization constant combination, compiled on first
+// use against core's pipeline cache. The variant cache owns the pipelines until cleanup.
+VkPipeline core::GetPipelineVariant( GraphicsPipelineDesc desc )
 {
-    VkShaderModule shader;
-    VkShaderModuleCreateInfo Info{};
-    Info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    Info.codeSize = code.size();
-    Info.pCode = reinterpret_cast< const uint32_t* >( code.data() );
-
-    if( vkCreateShaderModule( m_device, &Info, nullptr, &shader ) != VK_SUCCESS )
+    if( desc.layout == VK_NULL_HANDLE )
     {
-        throw std::runtime_error( "Failed to create Shader Module" );
+        desc.layout = m_descriptorLayouts.getPipelineLayout( m_graphicsSetLayouts, m_graphicsPushConstantRanges );
     }
 
-    return shader;
+    return m_pipelineCompiler.getVariant( desc, GetPipelineTarget() );
 }
 
-void core::createGraphicsPipeline( std::string vertSpv, std::string fragSpv )
+PipelineCompiler& core::GetPipelineCompiler()
 {
-    createGraphicsPipeline( vertSpv, fragSpv, 0, nullptr, 0, nullptr );
+    return m_pipelineCompiler;
 }
 
-void core::createGraphicsPipeline( std::string vertSpv, std::string fragSpv, uint32_t numVertexInputBindings, VkVertexInputBindingDescription* vertexInputBindings, uint32_t numVertexInputAttributes, VkVertexInputAttributeDescription* vertexInputAttributes )
+ShaderModuleCache& core::GetShaderModules()
 {
-    auto vertShaderCode = readFile( vertSpv );
-    auto fragShaderCode = readFile( fragSpv );
-
-    VkShaderModule vertShaderModule = createShaderModule( vertShaderCode );
-    VkShaderModule fragShaderModule = createShaderModule( fragShaderCode );
-
-    VkPipelineShaderStageCreateInfo vertStageInfo{};
-    vertStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertStageInfo.module = vertShaderModule;
-    vertStageInfo.pName = "main";
-
-    VkPipelineShaderStageCreateInfo fragStageInfo{};
-    fragStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragStageInfo.module = fragShaderModule;
-    fragStageInfo.pName = "main";
-
-    VkPipelineShaderStageCreateInfo shaderStages[] = { vertStageInfo, fragStageInfo };
-
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = numVertexInputBindings;
-    vertexInputInfo.pVertexBindingDescriptions = vertexInputBindings;
-    vertexInputInfo.vertexAttributeDescriptionCount = numVertexInputAttributes;
-    vertexInputInfo.pVertexAttributeDescriptions = vertexInputAttributes;
+    return m_shaderModules;
+}
 
-    VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo{};
-    inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
+// Pipelines are built against the render pass, or the swapchain format with dynamic rendering
+PipelineTarget core::GetPipelineTarget()
+{
+    PipelineTarget target;
+    target.renderPass = m_dynamicRendering ? VK_NULL_HANDLE : m_renderPass;
+    target.colorFormat = m_swapchainFormat;
+    return target;
+}
 
-    VkViewport viewport;
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = ( float )m_swapchainExtent.width;
-    viewport.height = ( float )m_swapchainExtent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
+// The layout has the given set layouts and one push constant range of pushConstantSize bytes
+// (none if 0) visible to the compute stage. Caller owns the pipeline, the layout belongs to
+// the descriptor layout cache and is shared with every pipeline that asks for the same one.
+VkPipeline core::createComputePipeline( std::string compSpv, uint32_t numSetLayouts, VkDescriptorSetLayout* setLayouts, uint32_t pushConstantSize, VkPipelineLayout& pipelineLayout )
+{
+    std::vector<VkPushConstantRange> pushConstantRanges;
+    if( pushConstantSize > 0 )
+    {
+        pushConstantRanges.push_back( { VK_SHADER_STAGE_COMPUTE_BIT, 0, pushConstantSize } );
+    }
 
-    VkRect2D scissor;
-    scissor.offset = { 0, 0 };
-    scissor.extent = m_swapchainExtent;
+    pipelineLayout = m_descriptorLayouts.getPipelineLayout( std::vector<VkDescriptorSetLayout>( setLayouts, setLayouts + numSetLayouts ), pushConstantRanges );
 
-    std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-    VkPipelineDynamicStateCreateInfo dynamicStateInfo{};
-    dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicStateInfo.dynamicStateCount = static_cast< uint32_t >( dynamicStates.size() );
-    dynamicStateInfo.pDynamicStates = dynamicStates.data();
-
-    VkPipelineViewportStateCreateInfo viewportState{};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
-    viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
-
-    VkPipelineRasterizationStateCreateInfo rasterizer{};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
-
-    VkPipelineMultisampleStateCreateInfo multisample{};
-    multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisample.sampleShadingEnable = VK_FALSE;
-    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    multisample.minSampleShading = 1.0f;
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-
-    VkPipelineColorBlendStateCreateInfo colorBlendState{};
-    colorBlendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlendState.logicOpEnable = VK_FALSE;
-    colorBlendState.logicOp = VK_LOGIC_OP_COPY;
-    colorBlendState.attachmentCount = 1;
-    colorBlendState.pAttachments = &colorBlendAttachment;
-    colorBlendState.blendConstants[0] = 0.0f;
-    colorBlendState.blendConstants[1] = 0.0f;
-    colorBlendState.blendConstants[2] = 0.0f;
-    colorBlendState.blendConstants[3] = 0.0f;
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-
-    if( vkCreatePipelineLayout( m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout ) != VK_SUCCESS )
-    {
-        throw std::runtime_error( "Failed creating Pipeline layout" );
-    }
-
-    VkGraphicsPipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.pStages = shaderStages;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisample;
-    pipelineInfo.pDepthStencilState = nullptr;
-    pipelineInfo.pColorBlendState = &colorBlendState;
-    pipelineInfo.pDynamicState = &dynamicStateInfo;
-    pipelineInfo.layout = m_pipelineLayout;
-    pipelineInfo.renderPass = m_renderPass;
-    pipelineInfo.subpass = 0;
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = createShaderModule( compSpv );
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pipelineLayout;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    if( vkCreateGraphicsPipelines( m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline ) != VK_SUCCESS )
+    TimingStats::Clock::time_point compileStart = TimingStats::Clock::now();
+
+    VkPipeline pipeline;
+    if( vkCreateComputePipelines( m_device, m_pipelineCache, 1, &pipelineInfo, nullptr, &pipeline ) != VK_SUCCESS )
     {
-        throw std::runtime_error( "Failed to create graphics m_pipeline!" );
+        throw std::runtime_error( "Failed to create compute pipeline!" );
     }
 
-    vkDestroyShaderModule( m_device, vertShaderModule, nullptr );
-    vkDestroyShaderModule( m_device, fragShaderModule, nullptr );
+    m_timing.record( m_pipelineCreateSeries, compileStart, TimingStats::Clock::now() );
+
+    return pipeline;
 }
 
+// Records groupCount workgroups of a 1D problem, see ComputeGroupGrid for the shader side
+void core::dispatch( VkCommandBuffer commandBuffer, uint64_t groupCount )
+{
+    VkExtent2D grid = ComputeGroupGrid( groupCount, m_maxComputeGroupCountX );
+    vkCmdDispatch( commandBuffer, grid.width, grid.height, 1 );
+}
+
+// Dynamic rendering renders straight to the image views, so a resize creates nothing here
 void core::createFramebuffers()
 {
+    if( m_dynamicRendering )
+    {
+        return;
+    }
+
     const size_t size = m_swapchainImageViews.size();
     m_swapchainFramebuffers.resize( size );
     for( size_t i = 0; i < size; i++ )
@@ -770,34 +2123,65 @@ void core::createFramebuffers()
 
 void core::createCommandPool()
 {
-    QueueFamilyIndices queueFamilyIndices = findQueueFamilies( m_physicalDevice );
+    const QueueFamilyIndices& queueFamilyIndices = m_queueFamilies;
 
+    // One pool per frame slot so a whole slot can be recycled with a single vkResetCommandPool
     VkCommandPoolCreateInfo commandPoolInfo{};
     commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
     commandPoolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
 
-    if( vkCreateCommandPool( m_device, &commandPoolInfo, nullptr, &m_commandPool ) != VK_SUCCESS )
+    m_frames.resize( m_framesInFlight );
+
+    for( auto& frame : m_frames )
     {
-        throw std::runtime_error( "Failed to create command pool!" );
+        if( vkCreateCommandPool( m_device, &commandPoolInfo, nullptr, &frame.commandPool ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create command pool!" );
+        }
+
+        // Command pools are externally synchronized, so every thread slot records from its own
+        frame.workerPools.resize( m_threadPool->size() );
+        for( auto& workerPool : frame.workerPools )
+        {
+            if( vkCreateCommandPool( m_device, &commandPoolInfo, nullptr, &workerPool ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to create command pool!" );
+            }
+        }
     }
 }
 
 void core::createCommandBuffer()
 {
-    VkCommandBufferAllocateInfo commandBufferInfo{};
-    commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    commandBufferInfo.commandBufferCount = 1;
-    commandBufferInfo.commandPool = m_commandPool;
-    commandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-
-    if( vkAllocateCommandBuffers( m_device, &commandBufferInfo, &m_commandBuffer ) != VK_SUCCESS )
+    for( auto& frame : m_frames )
     {
-        throw std::runtime_error( "Failed to create command buffers!" );
+        VkCommandBufferAllocateInfo commandBufferInfo{};
+        commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        commandBufferInfo.commandBufferCount = 1;
+        commandBufferInfo.commandPool = frame.commandPool;
+        commandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+        if( vkAllocateCommandBuffers( m_device, &commandBufferInfo, &frame.commandBuffer ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create command buffers!" );
+        }
+
+        frame.secondaryBuffers.resize( frame.workerPools.size() );
+        for( size_t i = 0; i < frame.workerPools.size(); i++ )
+        {
+            commandBufferInfo.commandPool = frame.workerPools[i];
+            commandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+            if( vkAllocateCommandBuffers( m_device, &commandBufferInfo, &frame.secondaryBuffers[i] ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to create command buffers!" );
+            }
+        }
     }
 }
 
-void core::recordCommandBufferProlog( uint32_t imageIndex )
+void core::recordDefaultState( VkCommandBuffer commandBuffer )
 {
     VkViewport viewport{};
     viewport.x = 0.0f;
@@ -811,6 +2195,24 @@ void core::recordCommandBufferProlog( uint32_t imageIndex )
     scissor.offset = { 0, 0 };
     scissor.extent = m_swapchainExtent;
 
+    vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline );
+    vkCmdSetViewport( commandBuffer, 0, 1, &viewport );
+    vkCmdSetScissor( commandBuffer, 0, 1, &scissor );
+}
+
+void core::recordCommandBufferProlog( uint32_t imageIndex )
+{
+    recordCommandBufferProlog( imageIndex, VK_SUBPASS_CONTENTS_INLINE );
+}
+
+// With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS the render pass may only contain
+// vkCmdExecuteCommands, so everything between prolog and epilog goes through recordParallel.
+void core::recordCommandBufferProlog( uint32_t imageIndex, VkSubpassContents contents )
+{
+    ScopedTiming timing( m_timing, m_phaseSeries[PHASE_RECORD_PROLOG] );
+
+    m_currentImage = imageIndex;
+
     VkCommandBufferBeginInfo commandBufferBegin{};
     commandBufferBegin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     commandBufferBegin.flags = 0;
@@ -818,35 +2220,271 @@ void core::recordCommandBufferProlog( uint32_t imageIndex )
 
     VkClearValue clearColor = { {{0.1f, 0.2f, 0.4f, 1.0f}} };
 
-    VkRenderPassBeginInfo renderpassBegin{};
-    renderpassBegin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderpassBegin.renderPass = m_renderPass;
-    renderpassBegin.framebuffer = m_swapchainFramebuffers[imageIndex];
-    renderpassBegin.renderArea.offset = { 0, 0 };
-    renderpassBegin.renderArea.extent = m_swapchainExtent;
-    renderpassBegin.clearValueCount = 1;
-    renderpassBegin.pClearValues = &clearColor;
+    VkCommandBuffer commandBuffer = GetCommandBuffer();
 
-    if( vkBeginCommandBuffer( m_commandBuffer, &commandBufferBegin ) != VK_SUCCESS )
+    if( vkBeginCommandBuffer( commandBuffer, &commandBufferBegin ) != VK_SUCCESS )
     {
         throw std::runtime_error( "Failed to begin command buffer" );
     }
 
-    vkCmdBeginRenderPass( m_commandBuffer, &renderpassBegin, VK_SUBPASS_CONTENTS_INLINE );
-    vkCmdBindPipeline( m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline );
-    vkCmdSetViewport( m_commandBuffer, 0, 1, &viewport );
-    vkCmdSetScissor( m_commandBuffer, 0, 1, &scissor );
+    // The slot's fence was waited on in drawFrameProlog, so its previous timestamps are ready
+    m_gpuTimer.beginFrame( commandBuffer, m_currentFrame );
+
+    // Uploads queued since the last frame land before this frame's render pass reads them
+    m_uploadRing.record( commandBuffer, m_currentFrame );
+    m_asyncUploader.record( commandBuffer, m_currentFrame );
+
+    recordPreRenderPass( commandBuffer );
+
+    m_renderPassQuery = m_gpuTimer.begin( commandBuffer, m_renderPassScope );
+
+    if( m_dynamicRendering )
+    {
+        // What the render pass's initial layout and external dependency did; the old contents
+        // are cleared anyway
+        transitionSwapchainImage( commandBuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT );
+
+        VkRenderingAttachmentInfoKHR colorAttachment{};
+        colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        colorAttachment.imageView = m_swapchainImageViews[imageIndex];
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.clearValue = clearColor;
+
+        VkRenderingInfoKHR renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+        renderingInfo.flags = contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0;
+        renderingInfo.renderArea.offset = { 0, 0 };
+        renderingInfo.renderArea.extent = m_swapchainExtent;
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachments = &colorAttachment;
+
+        m_cmdBeginRendering( commandBuffer, &renderingInfo );
+    }
+    else
+    {
+        VkRenderPassBeginInfo renderpassBegin{};
+        renderpassBegin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderpassBegin.renderPass = m_renderPass;
+        renderpassBegin.framebuffer = m_swapchainFramebuffers[imageIndex];
+        renderpassBegin.renderArea.offset = { 0, 0 };
+        renderpassBegin.renderArea.extent = m_swapchainExtent;
+        renderpassBegin.clearValueCount = 1;
+        renderpassBegin.pClearValues = &clearColor;
+
+        vkCmdBeginRenderPass( commandBuffer, &renderpassBegin, contents );
+    }
+
+    if( contents == VK_SUBPASS_CONTENTS_INLINE )
+    {
+        recordDefaultState( commandBuffer );
+    }
+
+    // Whatever the sample records between prolog and epilog is timed as PHASE_RECORD
+    m_recordStart = TimingStats::Clock::now();
+}
+
+// Splits itemCount items into contiguous ranges, one per thread slot, and records each range
+// into that slot's secondary command buffer on the thread pool. The secondaries inherit the
+// render pass and framebuffer, or the dynamic rendering attachment formats, begun in the prolog
+// and start with the pipeline, viewport and scissor bound. They are executed in range order, so
+// draw order is preserved. GPU timer scopes are not thread safe and must stay outside the
+// callback.
+void core::recordParallel( uint32_t itemCount, const std::function<void( VkCommandBuffer, uint32_t, uint32_t )>& record, uint32_t threads )
+{
+    FrameSlot& frame = m_frames[m_currentFrame];
+
+    const uint32_t slots = static_cast< uint32_t >( frame.secondaryBuffers.size() );
+    const uint32_t ranges = std::max( std::min( { threads == 0 ? slots : threads, slots, itemCount } ), 1u );
+
+    VkCommandBufferInheritanceInfo inheritance{};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.renderPass = m_renderPass;
+    inheritance.subpass = 0;
+    inheritance.framebuffer = m_dynamicRendering ? VK_NULL_HANDLE : m_swapchainFramebuffers[m_currentImage];
+
+    VkCommandBufferInheritanceRenderingInfoKHR renderingInheritance{};
+    renderingInheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+    renderingInheritance.colorAttachmentCount = 1;
+    renderingInheritance.pColorAttachmentFormats = &m_swapchainFormat;
+    renderingInheritance.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    if( m_dynamicRendering )
+    {
+        inheritance.pNext = &renderingInheritance;
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+
+    m_threadPool->run( ranges, [&]( uint32_t range, uint32_t )
+    {
+        // Range i always uses thread slot i's pool, so no pool is touched by two threads at once
+        VkCommandBuffer commandBuffer = frame.secondaryBuffers[range];
+
+        if( vkBeginCommandBuffer( commandBuffer, &beginInfo ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to begin secondary command buffer" );
+        }
+
+        recordDefaultState( commandBuffer );
+
+        const uint32_t first = static_cast< uint32_t >( static_cast< uint64_t >( itemCount ) * range / ranges );
+        const uint32_t last = static_cast< uint32_t >( static_cast< uint64_t >( itemCount ) * ( range + 1 ) / ranges );
+        record( commandBuffer, first, last - first );
 
+        if( vkEndCommandBuffer( commandBuffer ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to end secondary command buffer" );
+        }
+    } );
+
+    vkCmdExecuteCommands( GetCommandBuffer(), ranges, frame.secondaryBuffers.data() );
+}
+
+// Compute and transfer work the frame's render pass depends on, recorded after this frame's
+// uploads. Nothing by default.
+void core::recordPreRenderPass( VkCommandBuffer commandBuffer )
+{
 }
+
 void core::recordCommandBufferEpilog()
 {
-    vkCmdEndRenderPass( m_commandBuffer );
-    if( vkEndCommandBuffer( m_commandBuffer ) != VK_SUCCESS )
+    m_timing.record( m_phaseSeries[PHASE_RECORD], m_recordStart, TimingStats::Clock::now() );
+    ScopedTiming timing( m_timing, m_phaseSeries[PHASE_RECORD_EPILOG] );
+
+    VkCommandBuffer commandBuffer = GetCommandBuffer();
+
+    if( m_dynamicRendering )
+    {
+        m_cmdEndRendering( commandBuffer );
+
+        // The render pass's final layout, made visible to whatever comes next by the submit
+        transitionSwapchainImage( commandBuffer, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0 );
+    }
+    else
+    {
+        vkCmdEndRenderPass( commandBuffer );
+    }
+    m_gpuTimer.end( commandBuffer, m_renderPassQuery );
+
+    if( vkEndCommandBuffer( commandBuffer ) != VK_SUCCESS )
     {
         throw std::runtime_error( " Failed to end command buffer" );
     }
 }
 
+void core::transitionSwapchainImage( VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout,
+    VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess )
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_swapchainImages[m_currentImage];
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    vkCmdPipelineBarrier( commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier );
+}
+
+void core::createBuffer( VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& allocation )
+{
+    VkBufferCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    createInfo.size = size;
+    createInfo.usage = usage;
+    createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if( vkCreateBuffer( m_device, &createInfo, nullptr, &buffer ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Error while creating buffer" );
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements( m_device, buffer, &memoryRequirements );
+
+    allocation = m_allocator.allocate( memoryRequirements, properties );
+
+    vkBindBufferMemory( m_device, buffer, allocation.memory, allocation.offset );
+}
+
+void core::destroyBuffer( VkBuffer& buffer, Allocation& allocation )
+{
+    vkDestroyBuffer( m_device, buffer, nullptr );
+    m_allocator.free( allocation );
+    buffer = VK_NULL_HANDLE;
+}
+
+void core::uploadBuffer( VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size )
+{
+    const uint8_t* bytes = static_cast< const uint8_t* >( data );
+
+    while( size > 0 )
+    {
+        const VkDeviceSize chunk = std::min( size, m_uploadRing.capacity() );
+
+        if( !m_uploadRing.upload( dst, dstOffset, bytes, chunk ) )
+        {
+            // Ring is full of unsubmitted copies or frames still in flight
+            m_uploadStalls++;
+            flushUploads();
+            continue;
+        }
+
+        bytes += chunk;
+        dstOffset += chunk;
+        size -= chunk;
+    }
+}
+
+void core::flushUploads()
+{
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkResetCommandPool( m_device, m_uploadCommandPool, 0 );
+
+    if( vkBeginCommandBuffer( m_uploadCommandBuffer, &beginInfo ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to begin upload command buffer" );
+    }
+
+    m_uploadRing.record( m_uploadCommandBuffer, m_currentFrame );
+
+    if( vkEndCommandBuffer( m_uploadCommandBuffer ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to end upload command buffer" );
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_uploadCommandBuffer;
+
+    if( vkQueueSubmit( m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to submit uploads to Graphics Queue." );
+    }
+
+    // Also drains every frame in flight, so the whole ring is free afterwards
+    vkQueueWaitIdle( m_graphicsQueue );
+    m_uploadRing.reset();
+}
+
 void core::createSyncObjects()
 {
     VkSemaphoreCreateInfo semaphoreInfo = {};
@@ -856,54 +2494,221 @@ void core::createSyncObjects()
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    if( vkCreateSemaphore( m_device, &semaphoreInfo, nullptr, &m_imageAvailableSemaphore ) != VK_SUCCESS ||
-        vkCreateSemaphore( m_device, &semaphoreInfo, nullptr, &m_renderFinishedSemaphore ) != VK_SUCCESS ||
-        vkCreateFence( m_device, &fenceInfo, nullptr, &m_inflightFence ) != VK_SUCCESS )
+    // Present still needs binary semaphores; the timeline backend replaces only the fences
+    for( auto& frame : m_frames )
+    {
+        if( vkCreateSemaphore( m_device, &semaphoreInfo, nullptr, &frame.imageAvailableSemaphore ) != VK_SUCCESS ||
+            vkCreateSemaphore( m_device, &semaphoreInfo, nullptr, &frame.renderFinishedSemaphore ) != VK_SUCCESS ||
+            ( !m_timelineSync && vkCreateFence( m_device, &fenceInfo, nullptr, &frame.inflightFence ) != VK_SUCCESS ) )
+        {
+            throw std::runtime_error( "Failed to Create Synchronization objects" );
+        }
+    }
+
+    m_imageFrames.assign( m_swapchainImages.size(), 0 );
+
+    m_gpuTimer.init( m_device, m_deviceSnapshot, m_queueFamilies.graphicsFamily.value(), m_framesInFlight );
+}
+
+// Blocks until the GPU has finished frame: the timeline value, or the fence of the slot that
+// submitted it. A slot is only reused after its fence was waited on, so it is still there.
+void core::waitForFrame( uint64_t frame )
+{
+    if( frame <= m_completedFrame )
+    {
+        return;
+    }
+
+    if( m_timelineSync )
+    {
+        m_frameTimeline.wait( frame );
+        m_completedFrame = frame;
+        return;
+    }
+
+    for( auto& slot : m_frames )
     {
-        throw std::runtime_error( "Failed to Create Synchronization objects" );
+        if( slot.submittedFrame == frame )
+        {
+            vkWaitForFences( m_device, 1, &slot.inflightFence, VK_TRUE, UINT64_MAX );
+            m_completedFrame = frame;
+            return;
+        }
     }
 }
 
 uint32_t core::drawFrameProlog()
 {
+    // Prolog start to prolog start is the whole frame, including the sample and the message pump
+    TimingStats::Clock::time_point frameStart = TimingStats::Clock::now();
+    if( m_frameStart.time_since_epoch().count() != 0 )
+    {
+        m_timing.record( m_phaseSeries[PHASE_FRAME], m_frameStart, frameStart );
+    }
+    if( m_recreatedThisFrame )
+    {
+        // The whole frame a resize happened in, i.e. the hitch the user sees
+        m_timing.record( m_resizeFrameSeries, m_frameStart, frameStart );
+        m_recreatedThisFrame = false;
+    }
+    m_frameStart = frameStart;
+
     uint32_t imageIndex;
+    FrameSlot& frame = m_frames[m_currentFrame];
+
+    // Only waits for the frame that last used this slot, i.e. m_framesInFlight frames ago
+    TimingStats::Clock::time_point waitStart = TimingStats::Clock::now();
+    waitForFrame( frame.submittedFrame );
+    m_timing.record( m_frameWaitSeries, waitStart, TimingStats::Clock::now() );
+
+    // Frames complete in submission order, so every frame up to this one is done. The timeline
+    // may be further along already, which lets deferred destruction run earlier.
+    m_deletionQueue.collect( m_timelineSync ? CompletedFrame() : m_completedFrame );
+
+    swapInOptimizedPipeline();
+
+    if( m_swapchainDirty )
+    {
+        recreateSwapchain();
+    }
+
+    if( m_headless )
+    {
+        imageIndex = m_offscreenNextImage;
+        m_offscreenNextImage = ( m_offscreenNextImage + 1 ) % static_cast< uint32_t >( m_swapchainImages.size() );
+    }
+    else
+    {
+        // Blocks until an image is free, which is where FIFO paces the CPU
+        TimingStats::Clock::time_point acquireStart = TimingStats::Clock::now();
+        VkResult result = vkAcquireNextImageKHR( m_device, m_swapchain, UINT64_MAX, frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex );
+        m_timing.record( m_acquireSeries, acquireStart, TimingStats::Clock::now() );
+
+        // The semaphore is left unsignalled on failure, so it can be reused right away
+        while( result == VK_ERROR_OUT_OF_DATE_KHR )
+        {
+            recreateSwapchain();
+            result = vkAcquireNextImageKHR( m_device, m_swapchain, UINT64_MAX, frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex );
+        }
+
+        if( result == VK_SUBOPTIMAL_KHR )
+        {
+            // Still presentable, recreate once this frame is out
+            m_swapchainDirty = true;
+        }
+        else if( result != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to acquire swapchain image" );
+        }
+    }
+
+    // The swapchain can hand out an image that another slot is still rendering to
+    if( m_imageFrames[imageIndex] > m_completedFrame )
+    {
+        TimingStats::Clock::time_point imageWaitStart = TimingStats::Clock::now();
+        waitForFrame( m_imageFrames[imageIndex] );
+        m_timing.record( m_imageWaitSeries, imageWaitStart, TimingStats::Clock::now() );
+    }
+    m_imageFrames[imageIndex] = m_submittedFrames + 1;
 
-    vkWaitForFences( m_device, 1, &m_inflightFence, 1, UINT64_MAX );
-    vkResetFences( m_device, 1, &m_inflightFence );
+    if( !m_timelineSync )
+    {
+        vkResetFences( m_device, 1, &frame.inflightFence );
+    }
+    vkResetCommandPool( m_device, frame.commandPool, 0 );
+    for( auto workerPool : frame.workerPools )
+    {
+        vkResetCommandPool( m_device, workerPool, 0 );
+    }
+    m_uploadRing.beginFrame( m_currentFrame );
+    m_asyncUploader.beginFrame( m_currentFrame );
+    m_descriptorAllocator.beginFrame( m_currentFrame );
 
-    vkAcquireNextImageKHR( m_device, m_swapchain, UINT64_MAX, m_imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex );
+    m_recordingFrame = true;
 
-    vkResetCommandBuffer( m_commandBuffer, 0 );
+    m_timing.record( m_phaseSeries[PHASE_FRAME_PROLOG], frameStart, TimingStats::Clock::now() );
 
     return imageIndex;
 }
 
 void core::drawFrameEpilog(uint32_t imageIndex)
 {
+    ScopedTiming timing( m_timing, m_phaseSeries[PHASE_FRAME_EPILOG] );
+    FrameSlot& frame = m_frames[m_currentFrame];
+
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_commandBuffer;
+    submitInfo.pCommandBuffers = &frame.commandBuffer;
+
+    const uint64_t frameNumber = m_submittedFrames + 1;
+
+    m_submitWaitSemaphores.assign( m_asyncUploader.waitSemaphores().begin(), m_asyncUploader.waitSemaphores().end() );
+    m_submitWaitStages.assign( m_asyncUploader.waitStages().begin(), m_asyncUploader.waitStages().end() );
+    m_submitWaitValues.assign( m_asyncUploader.waitValues().begin(), m_asyncUploader.waitValues().end() );
+
+    // Offscreen images are handed out in order and guarded by m_imageFrames, nothing to wait on
+    if( !m_headless )
+    {
+        m_submitWaitSemaphores.push_back( frame.imageAvailableSemaphore );
+        m_submitWaitStages.push_back( VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+        m_submitWaitValues.push_back( 0 );
+    }
 
-    VkSemaphore signalSemaphores[] = { m_renderFinishedSemaphore };
-    VkSemaphore waitSemaphores[] = { m_imageAvailableSemaphore };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+    // The timeline, if used, goes first; values for binary semaphores are ignored
+    VkSemaphore signalSemaphores[2];
+    uint64_t signalValues[2] = { frameNumber, 0 };
+    uint32_t signalCount = 0;
+    if( m_timelineSync )
+    {
+        signalSemaphores[signalCount++] = m_frameTimeline.semaphore();
+    }
+    if( !m_headless )
+    {
+        signalSemaphores[signalCount++] = frame.renderFinishedSemaphore;
+    }
 
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = static_cast< uint32_t >( m_submitWaitSemaphores.size() );
+    submitInfo.pWaitSemaphores = m_submitWaitSemaphores.data();
+    submitInfo.pWaitDstStageMask = m_submitWaitStages.data();
+    submitInfo.signalSemaphoreCount = signalCount;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    if( vkQueueSubmit( m_graphicsQueue, 1, &submitInfo, m_inflightFence ) != VK_SUCCESS )
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = static_cast< uint32_t >( m_submitWaitValues.size() );
+    timelineInfo.pWaitSemaphoreValues = m_submitWaitValues.data();
+    timelineInfo.signalSemaphoreValueCount = signalCount;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+
+    if( m_timelineSync )
+    {
+        submitInfo.pNext = &timelineInfo;
+    }
+
+    if( vkQueueSubmit( m_graphicsQueue, 1, &submitInfo, m_timelineSync ? VK_NULL_HANDLE : frame.inflightFence ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to submit to Graphics Queue." );
+    }
+    frame.submittedFrame = ++m_submittedFrames;
+    m_recordingFrame = false;
+    m_timing.record( m_inputToSubmitSeries, m_frameStart, TimingStats::Clock::now() );
+
+    if( m_startup.markFirstFrame() )
+    {
+        m_startup.report( std::cout );
+    }
+
+    if( m_headless )
     {
-        std::runtime_error( "Failed to submit to Graphics Queue." );
+        m_currentFrame = ( m_currentFrame + 1 ) % m_framesInFlight;
+        return;
     }
 
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
+    presentInfo.pWaitSemaphores = &frame.renderFinishedSemaphore;
 
     VkSwapchainKHR swapchains[] = { m_swapchain };
     presentInfo.swapchainCount = 1;
@@ -911,7 +2716,24 @@ void core::drawFrameEpilog(uint32_t imageIndex)
     presentInfo.pImageIndices = &imageIndex;
     presentInfo.pResults = nullptr;
 
-    vkQueuePresentKHR( m_presentQueue, &presentInfo );
+    TimingStats::Clock::time_point presentStart = TimingStats::Clock::now();
+    VkResult result = vkQueuePresentKHR( m_presentQueue, &presentInfo );
+    TimingStats::Clock::time_point presentEnd = TimingStats::Clock::now();
+
+    // CPU side only: the present is queued here, scanout happens at the mode's discretion
+    m_timing.record( m_presentSeries, presentStart, presentEnd );
+    m_timing.record( m_inputToPresentSeries, m_frameStart, presentEnd );
+
+    if( result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR )
+    {
+        m_swapchainDirty = true;
+    }
+    else if( result != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to present swapchain image" );
+    }
+
+    m_currentFrame = ( m_currentFrame + 1 ) % m_framesInFlight;
 }
 
 void core::drawFrame()
@@ -921,7 +2743,7 @@ void core::drawFrame()
     imageIndex = drawFrameProlog();
 
     recordCommandBufferProlog( imageIndex );
-    vkCmdDraw( m_commandBuffer, 3, 1, 0, 0 );
+    vkCmdDraw( GetCommandBuffer(), 3, 1, 0, 0 );
     recordCommandBufferEpilog( );
 
     VkSemaphore signalSemaphores[1];
@@ -931,22 +2753,69 @@ void core::drawFrame()
 
 void core::cleanup()
 {
-    vkDestroySemaphore( m_device, m_imageAvailableSemaphore, nullptr );
-    vkDestroySemaphore( m_device, m_renderFinishedSemaphore, nullptr );
-    vkDestroyFence( m_device, m_inflightFence, nullptr );
-    vkDestroyCommandPool( m_device, m_commandPool, nullptr );
+    writeTimingReport();
+
+    // The device is idle by now, everything retired can go
+    m_deletionQueue.flush();
+
+    // The background link still uses the pipeline cache and the shader modules; waiting here
+    // also gets the optimized pipeline into the saved cache
+    if( m_optimizedPipeline.valid() )
+    {
+        vkDestroyPipeline( m_device, m_optimizedPipeline.get(), nullptr );
+    }
+
+    m_gpuTimer.destroy();
+
+    m_shaderModules.destroy();
+    m_uploadRing.destroy();
+    m_asyncUploader.destroy();
+    m_transferTimeline.destroy();
+    vkDestroyCommandPool( m_device, m_uploadCommandPool, nullptr );
+    savePipelineCache();
+    vkDestroyPipelineCache( m_device, m_pipelineCache, nullptr );
+    for( auto& frame : m_frames )
+    {
+        vkDestroySemaphore( m_device, frame.imageAvailableSemaphore, nullptr );
+        vkDestroySemaphore( m_device, frame.renderFinishedSemaphore, nullptr );
+        vkDestroyFence( m_device, frame.inflightFence, nullptr );
+        vkDestroyCommandPool( m_device, frame.commandPool, nullptr );
+        for( auto workerPool : frame.workerPools )
+        {
+            vkDestroyCommandPool( m_device, workerPool, nullptr );
+        }
+    }
+    m_frames.clear();
+    m_frameTimeline.destroy();
+    m_threadPool.reset();
     for( auto framebuffer : m_swapchainFramebuffers )
     {
         vkDestroyFramebuffer( m_device, framebuffer, nullptr );
     }
     vkDestroyRenderPass( m_device, m_renderPass, nullptr );
     vkDestroyPipeline( m_device, m_pipeline, nullptr );
-    vkDestroyPipelineLayout( m_device, m_pipelineLayout, nullptr );
+    m_pipelineCompiler.destroy();
+    m_bindless.destroy();
+    m_descriptorAllocator.destroy();
+    m_descriptorLayouts.destroy();
     for( auto imageView : m_swapchainImageViews )
     {
         vkDestroyImageView( m_device, imageView, nullptr );
     }
-    vkDestroySwapchainKHR( m_device, m_swapchain, nullptr );
+    if( m_headless )
+    {
+        for( size_t i = 0; i < m_swapchainImages.size(); i++ )
+        {
+            vkDestroyImage( m_device, m_swapchainImages[i], nullptr );
+            m_allocator.free( m_offscreenImageAllocations[i] );
+        }
+    }
+    else
+    {
+        vkDestroySwapchainKHR( m_device, m_swapchain, nullptr );
+        vkDestroySurfaceKHR( m_instance, m_surface, nullptr );
+    }
+    m_allocator.destroy();
     vkDestroyDevice( m_device, nullptr );
     vkDestroyInstance( m_instance, nullptr );
 }
\ No newline at end of file
@@ -0,0 +1,29 @@
+#include <deletionqueue.h>
+
+void DeletionQueue::push( uint64_t lastUseFrame, std::function<void()> destroy )
+{
+    m_entries.emplace_back( lastUseFrame, std::move( destroy ) );
+}
+
+void DeletionQueue::collect( uint64_t completedFrame )
+{
+    while( !m_entries.empty() && m_entries.front().first <= completedFrame )
+    {
+        m_entries.front().second();
+        m_entries.pop_front();
+    }
+}
+
+void DeletionQueue::flush()
+{
+    while( !m_entries.empty() )
+    {
+        m_entries.front().second();
+        m_entries.pop_front();
+    }
+}
+
+size_t DeletionQueue::size() const
+{
+    return m_entries.size();
+}
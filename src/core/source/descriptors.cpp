@@ -0,0 +1,318 @@
+#include <descriptors.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+void DescriptorLayoutCache::init( VkDevice device )
+{
+    m_device = device;
+}
+
+void DescriptorLayoutCache::destroy()
+{
+    for( auto& entry : m_pipelineLayouts )
+    {
+        vkDestroyPipelineLayout( m_device, entry.second, nullptr );
+    }
+    for( auto& entry : m_setLayouts )
+    {
+        vkDestroyDescriptorSetLayout( m_device, entry.second, nullptr );
+    }
+    m_pipelineLayouts.clear();
+    m_setLayouts.clear();
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::getSetLayout( const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutCreateFlags flags,
+    const std::vector<VkDescriptorBindingFlags>& bindingFlags )
+{
+    if( !bindingFlags.empty() && bindingFlags.size() != bindings.size() )
+    {
+        throw std::runtime_error( "Descriptor binding flags must match the bindings one to one" );
+    }
+
+    // Binding order does not change the layout, so it must not change the key
+    std::vector<size_t> order( bindings.size() );
+    for( size_t i = 0; i < order.size(); i++ )
+    {
+        order[i] = i;
+    }
+    std::sort( order.begin(), order.end(), [&bindings]( size_t a, size_t b )
+    {
+        return bindings[a].binding < bindings[b].binding;
+    } );
+
+    std::vector<VkDescriptorSetLayoutBinding> sorted;
+    std::vector<VkDescriptorBindingFlags> sortedFlags;
+    for( size_t i : order )
+    {
+        sorted.push_back( bindings[i] );
+        sortedFlags.push_back( bindingFlags.empty() ? 0 : bindingFlags[i] );
+    }
+
+    ObjectKey key;
+    key.words.push_back( flags );
+    for( size_t i = 0; i < sorted.size(); i++ )
+    {
+        const VkDescriptorSetLayoutBinding& binding = sorted[i];
+        if( binding.pImmutableSamplers != nullptr )
+        {
+            throw std::runtime_error( "Immutable samplers are not supported by the descriptor layout cache" );
+        }
+
+        key.words.push_back( binding.binding );
+        key.words.push_back( static_cast< uint64_t >( binding.descriptorType ) << 32 | binding.descriptorCount );
+        key.words.push_back( static_cast< uint64_t >( binding.stageFlags ) << 32 | sortedFlags[i] );
+    }
+
+    auto found = m_setLayouts.find( key );
+    if( found != m_setLayouts.end() )
+    {
+        return found->second;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.flags = flags;
+    layoutInfo.bindingCount = static_cast< uint32_t >( sorted.size() );
+    layoutInfo.pBindings = sorted.data();
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = static_cast< uint32_t >( sortedFlags.size() );
+    bindingFlagsInfo.pBindingFlags = sortedFlags.data();
+
+    if( !bindingFlags.empty() )
+    {
+        layoutInfo.pNext = &bindingFlagsInfo;
+    }
+
+    VkDescriptorSetLayout layout;
+    if( vkCreateDescriptorSetLayout( m_device, &layoutInfo, nullptr, &layout ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create descriptor set layout!" );
+    }
+
+    m_setLayouts.emplace( std::move( key ), layout );
+    return layout;
+}
+
+VkPipelineLayout DescriptorLayoutCache::getPipelineLayout( const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges )
+{
+    ObjectKey key;
+    key.words.push_back( setLayouts.size() );
+    for( VkDescriptorSetLayout setLayout : setLayouts )
+    {
+        key.words.push_back( reinterpret_cast< uint64_t >( setLayout ) );
+    }
+    for( const auto& range : pushConstantRanges )
+    {
+        key.words.push_back( range.stageFlags );
+        key.words.push_back( static_cast< uint64_t >( range.offset ) << 32 | range.size );
+    }
+
+    auto found = m_pipelineLayouts.find( key );
+    if( found != m_pipelineLayouts.end() )
+    {
+        return found->second;
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast< uint32_t >( setLayouts.size() );
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast< uint32_t >( pushConstantRanges.size() );
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+    VkPipelineLayout layout;
+    if( vkCreatePipelineLayout( m_device, &pipelineLayoutInfo, nullptr, &layout ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed creating Pipeline layout" );
+    }
+
+    m_pipelineLayouts.emplace( std::move( key ), layout );
+    return layout;
+}
+
+uint32_t DescriptorLayoutCache::setLayoutCount() const
+{
+    return static_cast< uint32_t >( m_setLayouts.size() );
+}
+
+uint32_t DescriptorLayoutCache::pipelineLayoutCount() const
+{
+    return static_cast< uint32_t >( m_pipelineLayouts.size() );
+}
+
+void DescriptorAllocator::init( VkDevice device, uint32_t frameSlots )
+{
+    m_device = device;
+    m_slots.assign( frameSlots, Slot() );
+}
+
+void DescriptorAllocator::destroy()
+{
+    for( VkDescriptorPool pool : m_allPools )
+    {
+        vkDestroyDescriptorPool( m_device, pool, nullptr );
+    }
+    m_allPools.clear();
+    m_freePools.clear();
+    m_slots.clear();
+}
+
+void DescriptorAllocator::beginFrame( uint32_t slot )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    Slot& frame = m_slots[slot];
+
+    // One reset returns every set of the pool at once
+    for( VkDescriptorPool pool : frame.usedPools )
+    {
+        vkResetDescriptorPool( m_device, pool, 0 );
+        m_freePools.push_back( pool );
+        m_stats.poolResets++;
+    }
+    frame.usedPools.clear();
+    frame.currentPool = VK_NULL_HANDLE;
+    frame.sets = 0;
+
+    m_currentSlot = slot;
+    m_stats.frameSets = 0;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate( VkDescriptorSetLayout layout )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    Slot& frame = m_slots[m_currentSlot];
+
+    VkDescriptorSetAllocateInfo allocateInfo{};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts = &layout;
+
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    VkResult result = VK_ERROR_OUT_OF_POOL_MEMORY;
+
+    if( frame.currentPool != VK_NULL_HANDLE )
+    {
+        allocateInfo.descriptorPool = frame.currentPool;
+        result = vkAllocateDescriptorSets( m_device, &allocateInfo, &set );
+    }
+
+    if( result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL )
+    {
+        // The current pool is full, it stays with the slot until the slot's next reset
+        frame.currentPool = takePool();
+        frame.usedPools.push_back( frame.currentPool );
+
+        allocateInfo.descriptorPool = frame.currentPool;
+        result = vkAllocateDescriptorSets( m_device, &allocateInfo, &set );
+    }
+
+    if( result != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to allocate descriptor set!" );
+    }
+
+    frame.sets++;
+    m_stats.setsAllocated++;
+    m_stats.frameSets = frame.sets;
+    m_stats.peakFrameSets = std::max( m_stats.peakFrameSets, frame.sets );
+
+    return set;
+}
+
+const DescriptorAllocator::Stats& DescriptorAllocator::stats() const
+{
+    return m_stats;
+}
+
+VkDescriptorPool DescriptorAllocator::takePool()
+{
+    if( !m_freePools.empty() )
+    {
+        VkDescriptorPool pool = m_freePools.back();
+        m_freePools.pop_back();
+        return pool;
+    }
+
+    // Descriptor counts per set, roughly what a material or a compute pass binds
+    const std::pair<VkDescriptorType, uint32_t> ratios[] = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1 },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
+        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2 },
+        { VK_DESCRIPTOR_TYPE_SAMPLER, 1 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 }
+    };
+
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for( const auto& ratio : ratios )
+    {
+        poolSizes.push_back( { ratio.first, ratio.second * m_setsPerPool } );
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = m_setsPerPool;
+    poolInfo.poolSizeCount = static_cast< uint32_t >( poolSizes.size() );
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    VkDescriptorPool pool;
+    if( vkCreateDescriptorPool( m_device, &poolInfo, nullptr, &pool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create descriptor pool!" );
+    }
+
+    m_allPools.push_back( pool );
+    m_stats.poolsCreated++;
+    m_setsPerPool = std::min( m_setsPerPool * 2, MAX_SETS_PER_POOL );
+
+    return pool;
+}
+
+DescriptorWriter& DescriptorWriter::writeBuffer( uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range )
+{
+    m_writes.push_back( { binding, type, false, m_bufferInfos.size() } );
+    m_bufferInfos.push_back( { buffer, offset, range } );
+    return *this;
+}
+
+DescriptorWriter& DescriptorWriter::writeImage( uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler, VkImageLayout layout )
+{
+    m_writes.push_back( { binding, type, true, m_imageInfos.size() } );
+    m_imageInfos.push_back( { sampler, view, layout } );
+    return *this;
+}
+
+void DescriptorWriter::update( VkDevice device, VkDescriptorSet set )
+{
+    m_vkWrites.clear();
+    for( const Write& write : m_writes )
+    {
+        VkWriteDescriptorSet vkWrite{};
+        vkWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        vkWrite.dstSet = set;
+        vkWrite.dstBinding = write.binding;
+        vkWrite.descriptorCount = 1;
+        vkWrite.descriptorType = write.type;
+        vkWrite.pBufferInfo = write.image ? nullptr : &m_bufferInfos[write.info];
+        vkWrite.pImageInfo = write.image ? &m_imageInfos[write.info] : nullptr;
+        m_vkWrites.push_back( vkWrite );
+    }
+
+    vkUpdateDescriptorSets( device, static_cast< uint32_t >( m_vkWrites.size() ), m_vkWrites.data(), 0, nullptr );
+
+    clear();
+}
+
+void DescriptorWriter::clear()
+{
+    m_writes.clear();
+    m_bufferInfos.clear();
+    m_imageInfos.clear();
+}
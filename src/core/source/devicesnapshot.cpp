@@ -0,0 +1,166 @@
+#include <devicesnapshot.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <tuple>
+
+bool DeviceSnapshot::Score::operator<( const Score& other ) const
+{
+    return std::tie( typeRank, deviceLocalBytes, features ) < std::tie( other.typeRank, other.deviceLocalBytes, other.features );
+}
+
+DeviceSnapshot DeviceSnapshot::capture( VkPhysicalDevice device, uint32_t index, uint32_t instanceApiVersion )
+{
+    DeviceSnapshot snapshot;
+    snapshot.device = device;
+    snapshot.index = index;
+
+    vkGetPhysicalDeviceProperties( device, &snapshot.properties );
+    vkGetPhysicalDeviceMemoryProperties( device, &snapshot.memoryProperties );
+    vkGetPhysicalDeviceFeatures( device, &snapshot.features );
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties( device, &queueFamilyCount, nullptr );
+    snapshot.queueFamilies.resize( queueFamilyCount );
+    vkGetPhysicalDeviceQueueFamilyProperties( device, &queueFamilyCount, snapshot.queueFamilies.data() );
+
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties( device, nullptr, &extensionCount, nullptr );
+    snapshot.extensions.resize( extensionCount );
+    vkEnumerateDeviceExtensionProperties( device, nullptr, &extensionCount, snapshot.extensions.data() );
+
+    if( std::min( snapshot.properties.apiVersion, instanceApiVersion ) >= VK_API_VERSION_1_1 )
+    {
+        VkPhysicalDeviceIDProperties idProperties{};
+        idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &idProperties;
+        vkGetPhysicalDeviceProperties2( device, &properties );
+
+        memcpy( snapshot.uuid, idProperties.deviceUUID, VK_UUID_SIZE );
+        snapshot.hasUuid = true;
+    }
+
+    return snapshot;
+}
+
+bool DeviceSnapshot::hasExtension( const char* name ) const
+{
+    return std::any_of( extensions.begin(), extensions.end(), [name]( const VkExtensionProperties& extension )
+    {
+        return strcmp( extension.extensionName, name ) == 0;
+    } );
+}
+
+VkDeviceSize DeviceSnapshot::largestDeviceLocalHeap() const
+{
+    VkDeviceSize largest = 0;
+    for( uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++ )
+    {
+        if( memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT )
+        {
+            largest = std::max( largest, memoryProperties.memoryHeaps[i].size );
+        }
+    }
+    return largest;
+}
+
+DeviceSnapshot::Score DeviceSnapshot::score() const
+{
+    Score score;
+
+    switch( properties.deviceType )
+    {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        score.typeRank = 4;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        score.typeRank = 3;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        score.typeRank = 2;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+        score.typeRank = 0;
+        break;
+    default:
+        score.typeRank = 1;
+        break;
+    }
+
+    score.deviceLocalBytes = largestDeviceLocalHeap();
+
+    // What createLogicalDevice and GpuTimer use when they are there
+    score.features = ( features.multiDrawIndirect ? 1 : 0 ) + ( features.drawIndirectFirstInstance ? 1 : 0 ) +
+        ( properties.limits.timestampComputeAndGraphics ? 1 : 0 );
+
+    return score;
+}
+
+std::string DeviceSnapshot::uuidString() const
+{
+    if( !hasUuid )
+    {
+        return "";
+    }
+
+    static const char digits[] = "0123456789abcdef";
+    std::string text;
+    for( uint8_t byte : uuid )
+    {
+        text += digits[byte >> 4];
+        text += digits[byte & 0xf];
+    }
+    return text;
+}
+
+const char* DeviceSnapshot::typeName( VkPhysicalDeviceType type )
+{
+    switch( type )
+    {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        return "discrete";
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        return "integrated";
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        return "virtual";
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+        return "cpu";
+    default:
+        return "other";
+    }
+}
+
+bool DeviceSnapshot::matches( const std::string& selector ) const
+{
+    auto lower = []( std::string text )
+    {
+        std::transform( text.begin(), text.end(), text.begin(), []( unsigned char c )
+        {
+            return static_cast< char >( std::tolower( c ) );
+        } );
+        return text;
+    };
+
+    if( selector.empty() )
+    {
+        return false;
+    }
+
+    if( std::all_of( selector.begin(), selector.end(), []( unsigned char c ) { return std::isdigit( c ); } ) && selector.size() < 4 )
+    {
+        return std::stoul( selector ) == index;
+    }
+
+    std::string uuidSelector = lower( selector );
+    uuidSelector.erase( std::remove( uuidSelector.begin(), uuidSelector.end(), '-' ), uuidSelector.end() );
+    if( hasUuid && uuidSelector == uuidString() )
+    {
+        return true;
+    }
+
+    return lower( properties.deviceName ).find( lower( selector ) ) != std::string::npos;
+}
@@ -0,0 +1,129 @@
+#include <gputimer.h>
+
+#include <stdexcept>
+
+void GpuTimer::init( VkDevice device, const DeviceSnapshot& physicalDevice, uint32_t queueFamily, uint32_t frameSlots )
+{
+    m_device = device;
+    m_slots.assign( frameSlots, SlotQueries() );
+
+    const uint32_t validBits = physicalDevice.queueFamilies[queueFamily].timestampValidBits;
+    if( validBits == 0 )
+    {
+        // Timers stay registered but record nothing
+        return;
+    }
+
+    m_timestampPeriod = physicalDevice.properties.limits.timestampPeriod;
+    m_timestampMask = validBits >= 64 ? ~0ull : ( ( 1ull << validBits ) - 1 );
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = MAX_QUERIES_PER_FRAME * frameSlots;
+
+    if( vkCreateQueryPool( m_device, &queryPoolInfo, nullptr, &m_queryPool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create timestamp query pool!" );
+    }
+}
+
+void GpuTimer::destroy()
+{
+    if( m_queryPool != VK_NULL_HANDLE )
+    {
+        vkDestroyQueryPool( m_device, m_queryPool, nullptr );
+        m_queryPool = VK_NULL_HANDLE;
+    }
+}
+
+bool GpuTimer::isSupported() const
+{
+    return m_queryPool != VK_NULL_HANDLE;
+}
+
+uint32_t GpuTimer::registerScope( const std::string& name )
+{
+    m_scopeSeries.push_back( m_stats.addSeries( "gpu." + name ) );
+    return static_cast< uint32_t >( m_scopeSeries.size() - 1 );
+}
+
+void GpuTimer::beginFrame( VkCommandBuffer commandBuffer, uint32_t slot )
+{
+    m_currentSlot = slot;
+
+    if( !isSupported() )
+    {
+        return;
+    }
+
+    collect( slot );
+
+    vkCmdResetQueryPool( commandBuffer, m_queryPool, slot * MAX_QUERIES_PER_FRAME, MAX_QUERIES_PER_FRAME );
+}
+
+uint32_t GpuTimer::begin( VkCommandBuffer commandBuffer, uint32_t scope )
+{
+    if( !isSupported() || m_slots[m_currentSlot].used + 2 > MAX_QUERIES_PER_FRAME )
+    {
+        return INVALID_QUERY;
+    }
+
+    SlotQueries& slot = m_slots[m_currentSlot];
+
+    const uint32_t query = m_currentSlot * MAX_QUERIES_PER_FRAME + slot.used;
+    slot.used += 2;
+    slot.scopes.push_back( { scope, query } );
+
+    vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, query );
+
+    return query;
+}
+
+void GpuTimer::end( VkCommandBuffer commandBuffer, uint32_t query )
+{
+    if( query == INVALID_QUERY )
+    {
+        return;
+    }
+
+    vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, query + 1 );
+}
+
+void GpuTimer::collect( uint32_t slotIndex )
+{
+    SlotQueries& slot = m_slots[slotIndex];
+
+    if( slot.used == 0 )
+    {
+        return;
+    }
+
+    // Pairs of { timestamp, availability }. The slot's fence has signalled, so no WAIT_BIT.
+    m_results.resize( slot.used * 2 );
+    const uint32_t firstQuery = slotIndex * MAX_QUERIES_PER_FRAME;
+
+    VkResult result = vkGetQueryPoolResults( m_device, m_queryPool, firstQuery, slot.used,
+        m_results.size() * sizeof( uint64_t ), m_results.data(), 2 * sizeof( uint64_t ),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT );
+
+    if( result == VK_SUCCESS || result == VK_NOT_READY )
+    {
+        for( const auto& pending : slot.scopes )
+        {
+            const uint32_t beginIndex = ( pending.query - firstQuery ) * 2;
+            const uint32_t endIndex = beginIndex + 2;
+
+            if( m_results[beginIndex + 1] == 0 || m_results[endIndex + 1] == 0 )
+            {
+                continue;
+            }
+
+            const uint64_t ticks = ( m_results[endIndex] - m_results[beginIndex] ) & m_timestampMask;
+            m_stats.record( m_scopeSeries[pending.scope], ticks * m_timestampPeriod / 1000000.0 );
+        }
+    }
+
+    slot.used = 0;
+    slot.scopes.clear();
+}
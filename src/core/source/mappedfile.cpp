@@ -0,0 +1,88 @@
+#include <mappedfile.h>
+
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile( const std::string& path )
+{
+    m_file = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+
+    if( m_file == INVALID_HANDLE_VALUE )
+    {
+        throw std::runtime_error( "Error while opening file " + path );
+    }
+
+    LARGE_INTEGER fileSize;
+    if( !GetFileSizeEx( m_file, &fileSize ) || fileSize.QuadPart == 0 )
+    {
+        CloseHandle( m_file );
+        throw std::runtime_error( "Error while reading size of " + path );
+    }
+
+    m_size = static_cast< size_t >( fileSize.QuadPart );
+    m_mapping = CreateFileMappingA( m_file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+
+    if( m_mapping != nullptr )
+    {
+        m_data = MapViewOfFile( m_mapping, FILE_MAP_READ, 0, 0, 0 );
+    }
+
+    if( m_data == nullptr )
+    {
+        if( m_mapping != nullptr )
+        {
+            CloseHandle( m_mapping );
+        }
+        CloseHandle( m_file );
+        throw std::runtime_error( "Error while mapping file " + path );
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    UnmapViewOfFile( m_data );
+    CloseHandle( m_mapping );
+    CloseHandle( m_file );
+}
+#else
+MappedFile::MappedFile( const std::string& path )
+{
+    m_fd = open( path.c_str(), O_RDONLY );
+
+    if( m_fd < 0 )
+    {
+        throw std::runtime_error( "Error while opening file " + path );
+    }
+
+    struct stat fileStat;
+    if( fstat( m_fd, &fileStat ) != 0 || fileStat.st_size == 0 )
+    {
+        close( m_fd );
+        throw std::runtime_error( "Error while reading size of " + path );
+    }
+
+    m_size = static_cast< size_t >( fileStat.st_size );
+
+    void* data = mmap( nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0 );
+    if( data == MAP_FAILED )
+    {
+        close( m_fd );
+        throw std::runtime_error( "Error while mapping file " + path );
+    }
+
+    m_data = data;
+}
+
+MappedFile::~MappedFile()
+{
+    munmap( const_cast< void* >( m_data ), m_size );
+    close( m_fd );
+}
+#endif
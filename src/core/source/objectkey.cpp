@@ -0,0 +1,12 @@
+#include <objectkey.h>
+
+size_t ObjectKeyHash::operator()( const ObjectKey& key ) const
+{
+    // FNV-1a over the words
+    uint64_t hash = 14695981039346656037ull;
+    for( uint64_t word : key.words )
+    {
+        hash = ( hash ^ word ) * 1099511628211ull;
+    }
+    return static_cast< size_t >( hash );
+}
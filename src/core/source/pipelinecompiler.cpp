@@ -0,0 +1,612 @@
+#include <pipelinecompiler.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+SpecializationConstants::SpecializationConstants( const VkSpecializationInfo* info )
+{
+    if( info == nullptr )
+    {
+        return;
+    }
+
+    for( uint32_t i = 0; i < info->mapEntryCount; i++ )
+    {
+        const VkSpecializationMapEntry& entry = info->pMapEntries[i];
+        set( entry.constantID, static_cast< const uint8_t* >( info->pData ) + entry.offset, entry.size );
+    }
+}
+
+SpecializationConstants& SpecializationConstants::set( uint32_t constantId, const void* value, size_t size )
+{
+    auto entry = std::lower_bound( entries.begin(), entries.end(), constantId, []( const VkSpecializationMapEntry& entry, uint32_t id )
+    {
+        return entry.constantID < id;
+    } );
+
+    if( entry != entries.end() && entry->constantID == constantId )
+    {
+        if( entry->size != size )
+        {
+            throw std::runtime_error( "Specialization constant " + std::to_string( constantId ) + " set with a different size" );
+        }
+        memcpy( data.data() + entry->offset, value, size );
+        return *this;
+    }
+
+    const uint32_t offset = static_cast< uint32_t >( data.size() );
+    data.insert( data.end(), static_cast< const uint8_t* >( value ), static_cast< const uint8_t* >( value ) + size );
+    entries.insert( entry, { constantId, offset, size } );
+    return *this;
+}
+
+SpecializationConstants& SpecializationConstants::setInt( uint32_t constantId, int32_t value )
+{
+    return set( constantId, &value, sizeof( value ) );
+}
+
+SpecializationConstants& SpecializationConstants::setUint( uint32_t constantId, uint32_t value )
+{
+    return set( constantId, &value, sizeof( value ) );
+}
+
+SpecializationConstants& SpecializationConstants::setFloat( uint32_t constantId, float value )
+{
+    return set( constantId, &value, sizeof( value ) );
+}
+
+// SPIR-V booleans are 32 bits wide
+SpecializationConstants& SpecializationConstants::setBool( uint32_t constantId, bool value )
+{
+    VkBool32 boolValue = value ? VK_TRUE : VK_FALSE;
+    return set( constantId, &boolValue, sizeof( boolValue ) );
+}
+
+bool SpecializationConstants::empty() const
+{
+    return entries.empty();
+}
+
+VkSpecializationInfo SpecializationConstants::info() const
+{
+    VkSpecializationInfo info{};
+    info.mapEntryCount = static_cast< uint32_t >( entries.size() );
+    info.pMapEntries = entries.data();
+    info.dataSize = data.size();
+    info.pData = data.data();
+    return info;
+}
+
+struct PipelineCompiler::State
+{
+    VkPipelineShaderStageCreateInfo stages[2] = {};
+    VkSpecializationInfo specialization[2] = {};
+    VkPipelineVertexInputStateCreateInfo vertexInput{};
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    VkDynamicState dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    VkPipelineViewportStateCreateInfo viewportState{};
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    VkPipelineMultisampleStateCreateInfo multisample{};
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    VkPipelineColorBlendStateCreateInfo colorBlend{};
+    VkPipelineRenderingCreateInfoKHR rendering{};
+    VkGraphicsPipelineCreateInfo pipeline{};
+};
+
+static double millisecondsSince( std::chrono::steady_clock::time_point start )
+{
+    return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+}
+
+void PipelineCompiler::init( VkDevice device, VkPipelineCache cache, ShaderModuleCache& shaders )
+{
+    m_device = device;
+    m_cache = cache;
+    m_shaders = &shaders;
+}
+
+void PipelineCompiler::destroy()
+{
+    for( auto& part : m_parts )
+    {
+        vkDestroyPipeline( m_device, part.second, nullptr );
+    }
+    m_parts.clear();
+
+    for( auto& variant : m_variants )
+    {
+        vkDestroyPipeline( m_device, variant.second, nullptr );
+    }
+    m_variants.clear();
+}
+
+void PipelineCompiler::fillState( const GraphicsPipelineDesc& desc, const PipelineTarget& target, State& state )
+{
+    if( desc.layout == VK_NULL_HANDLE )
+    {
+        throw std::runtime_error( "Graphics pipeline description without a layout" );
+    }
+
+    state.stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    state.stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    state.stages[0].module = m_shaders->get( desc.vertSpv );
+    state.stages[0].pName = "main";
+    state.specialization[0] = desc.vertConstants.info();
+    state.stages[0].pSpecializationInfo = desc.vertConstants.empty() ? nullptr : &state.specialization[0];
+
+    state.stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    state.stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    state.stages[1].module = m_shaders->get( desc.fragSpv );
+    state.stages[1].pName = "main";
+    state.specialization[1] = desc.fragConstants.info();
+    state.stages[1].pSpecializationInfo = desc.fragConstants.empty() ? nullptr : &state.specialization[1];
+
+    state.vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    state.vertexInput.vertexBindingDescriptionCount = static_cast< uint32_t >( desc.vertexBindings.size() );
+    state.vertexInput.pVertexBindingDescriptions = desc.vertexBindings.data();
+    state.vertexInput.vertexAttributeDescriptionCount = static_cast< uint32_t >( desc.vertexAttributes.size() );
+    state.vertexInput.pVertexAttributeDescriptions = desc.vertexAttributes.data();
+
+    state.inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    state.inputAssembly.topology = desc.topology;
+    state.inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    state.dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    state.dynamicState.dynamicStateCount = 2;
+    state.dynamicState.pDynamicStates = state.dynamicStates;
+
+    // Both are dynamic, only the counts matter
+    state.viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    state.viewportState.viewportCount = 1;
+    state.viewportState.scissorCount = 1;
+
+    state.rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    state.rasterizer.depthClampEnable = VK_FALSE;
+    state.rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    state.rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    state.rasterizer.lineWidth = 1.0f;
+    state.rasterizer.cullMode = desc.cullMode;
+    state.rasterizer.frontFace = desc.frontFace;
+    state.rasterizer.depthBiasEnable = VK_FALSE;
+
+    state.multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    state.multisample.sampleShadingEnable = VK_FALSE;
+    state.multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    state.multisample.minSampleShading = 1.0f;
+
+    // Blending is premultiplied alpha over the target when enabled
+    state.colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    state.colorBlendAttachment.blendEnable = desc.blendEnable ? VK_TRUE : VK_FALSE;
+    state.colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    state.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    state.colorBlendAttachment.dstColorBlendFactor = desc.blendEnable ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO;
+    state.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    state.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    state.colorBlendAttachment.dstAlphaBlendFactor = desc.blendEnable ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO;
+
+    state.colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    state.colorBlend.logicOpEnable = VK_FALSE;
+    state.colorBlend.logicOp = VK_LOGIC_OP_COPY;
+    state.colorBlend.attachmentCount = 1;
+    state.colorBlend.pAttachments = &state.colorBlendAttachment;
+
+    state.rendering.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    state.rendering.colorAttachmentCount = 1;
+    state.rendering.pColorAttachmentFormats = &target.colorFormat;
+
+    state.pipeline.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    state.pipeline.pNext = target.renderPass == VK_NULL_HANDLE ? &state.rendering : nullptr;
+    state.pipeline.pStages = state.stages;
+    state.pipeline.stageCount = 2;
+    state.pipeline.pVertexInputState = &state.vertexInput;
+    state.pipeline.pInputAssemblyState = &state.inputAssembly;
+    state.pipeline.pViewportState = &state.viewportState;
+    state.pipeline.pRasterizationState = &state.rasterizer;
+    state.pipeline.pMultisampleState = &state.multisample;
+    state.pipeline.pDepthStencilState = nullptr;
+    state.pipeline.pColorBlendState = &state.colorBlend;
+    state.pipeline.pDynamicState = &state.dynamicState;
+    state.pipeline.layout = desc.layout;
+    state.pipeline.renderPass = target.renderPass;
+    state.pipeline.subpass = 0;
+    state.pipeline.basePipelineHandle = VK_NULL_HANDLE;
+    state.pipeline.basePipelineIndex = -1;
+}
+
+VkPipeline PipelineCompiler::compile( const GraphicsPipelineDesc& desc, const PipelineTarget& target, double* compileMs )
+{
+    State state;
+    fillState( desc, target, state );
+
+    const auto compileStart = std::chrono::steady_clock::now();
+
+    VkPipeline pipeline;
+    if( vkCreateGraphicsPipelines( m_device, m_cache, 1, &state.pipeline, nullptr, &pipeline ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create graphics pipeline for " + desc.vertSpv + " / " + desc.fragSpv );
+    }
+
+    if( compileMs != nullptr )
+    {
+        *compileMs = millisecondsSince( compileStart );
+    }
+
+    return pipeline;
+}
+
+std::vector<VkPipeline> PipelineCompiler::compileBatch( const std::vector<GraphicsPipelineDesc>& descs, const PipelineTarget& target, ThreadPool* pool, BatchStats& stats )
+{
+    const uint32_t count = static_cast< uint32_t >( descs.size() );
+
+    std::vector<VkPipeline> pipelines( count, VK_NULL_HANDLE );
+    std::vector<double> compileTimes( count, 0.0 );
+
+    auto task = [&]( uint32_t index, uint32_t )
+    {
+        pipelines[index] = compile( descs[index], target, &compileTimes[index] );
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+
+    try
+    {
+        if( pool != nullptr )
+        {
+            pool->run( count, task );
+        }
+        else
+        {
+            for( uint32_t i = 0; i < count; i++ )
+            {
+                task( i, 0 );
+            }
+        }
+    }
+    catch( ... )
+    {
+        for( VkPipeline pipeline : pipelines )
+        {
+            vkDestroyPipeline( m_device, pipeline, nullptr );
+        }
+        throw;
+    }
+
+    stats.pipelines = count;
+    stats.threads = pool != nullptr ? std::min( pool->size(), count ) : 1;
+    stats.wallMs = millisecondsSince( start );
+    stats.compileMs = 0.0;
+    stats.slowestMs = 0.0;
+    for( double time : compileTimes )
+    {
+        stats.compileMs += time;
+        stats.slowestMs = std::max( stats.slowestMs, time );
+    }
+
+    return pipelines;
+}
+
+VkPipeline PipelineCompiler::getVariant( const GraphicsPipelineDesc& desc, const PipelineTarget& target )
+{
+    // The four part keys together cover every field of the description
+    ObjectKey key;
+    for( uint32_t part = 0; part < PART_COUNT; part++ )
+    {
+        ObjectKey partWords = partKey( static_cast< Part >( part ), desc, target );
+        key.words.insert( key.words.end(), partWords.words.begin(), partWords.words.end() );
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        auto cached = m_variants.find( key );
+        if( cached != m_variants.end() )
+        {
+            m_variantStats.hits++;
+            return cached->second;
+        }
+    }
+
+    double compileTime = 0.0;
+    VkPipeline pipeline = compile( desc, target, &compileTime );
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+    auto inserted = m_variants.emplace( std::move( key ), pipeline );
+    if( !inserted.second )
+    {
+        vkDestroyPipeline( m_device, pipeline, nullptr );
+        m_variantStats.hits++;
+        return inserted.first->second;
+    }
+
+    m_variantStats.variants++;
+    m_variantStats.compileMs += compileTime;
+    return pipeline;
+}
+
+PipelineCompiler::VariantStats PipelineCompiler::variantStats()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_variantStats;
+}
+
+void PipelineCompiler::useLibraries()
+{
+    m_libraries = true;
+}
+
+bool PipelineCompiler::usesLibraries() const
+{
+    return m_libraries;
+}
+
+// Only the state that goes into the part, so descriptions that differ elsewhere share it
+ObjectKey PipelineCompiler::partKey( Part part, const GraphicsPipelineDesc& desc, const PipelineTarget& target )
+{
+    ObjectKey key;
+    key.words.push_back( part );
+
+    auto handle = []( const void* object )
+    {
+        return static_cast< uint64_t >( reinterpret_cast< uintptr_t >( object ) );
+    };
+
+    auto constants = [&key]( const SpecializationConstants& constants )
+    {
+        key.words.push_back( constants.entries.size() );
+        for( const auto& entry : constants.entries )
+        {
+            key.words.push_back( ( static_cast< uint64_t >( entry.constantID ) << 32 ) | entry.size );
+            for( size_t i = 0; i < entry.size; i += sizeof( uint64_t ) )
+            {
+                uint64_t word = 0;
+                memcpy( &word, constants.data.data() + entry.offset + i, std::min( entry.size - i, sizeof( uint64_t ) ) );
+                key.words.push_back( word );
+            }
+        }
+    };
+
+    switch( part )
+    {
+    case PART_VERTEX_INPUT:
+        key.words.push_back( desc.topology );
+        for( const auto& binding : desc.vertexBindings )
+        {
+            key.words.push_back( ( static_cast< uint64_t >( binding.binding ) << 32 ) | binding.stride );
+            key.words.push_back( binding.inputRate );
+        }
+        key.words.push_back( UINT64_MAX );
+        for( const auto& attribute : desc.vertexAttributes )
+        {
+            key.words.push_back( ( static_cast< uint64_t >( attribute.location ) << 32 ) | attribute.binding );
+            key.words.push_back( ( static_cast< uint64_t >( attribute.format ) << 32 ) | attribute.offset );
+        }
+        break;
+    case PART_PRE_RASTERIZATION:
+        key.words.push_back( handle( m_shaders->get( desc.vertSpv ) ) );
+        constants( desc.vertConstants );
+        key.words.push_back( handle( desc.layout ) );
+        key.words.push_back( ( static_cast< uint64_t >( desc.cullMode ) << 32 ) | desc.frontFace );
+        key.words.push_back( handle( target.renderPass ) );
+        key.words.push_back( target.colorFormat );
+        break;
+    case PART_FRAGMENT_SHADER:
+        key.words.push_back( handle( m_shaders->get( desc.fragSpv ) ) );
+        constants( desc.fragConstants );
+        key.words.push_back( handle( desc.layout ) );
+        key.words.push_back( handle( target.renderPass ) );
+        key.words.push_back( target.colorFormat );
+        break;
+    default:
+        key.words.push_back( desc.blendEnable ? 1 : 0 );
+        key.words.push_back( handle( target.renderPass ) );
+        key.words.push_back( target.colorFormat );
+        break;
+    }
+
+    return key;
+}
+
+VkPipeline PipelineCompiler::compilePart( Part part, const GraphicsPipelineDesc& desc, const PipelineTarget& target )
+{
+    State state;
+    fillState( desc, target, state );
+
+    static const VkGraphicsPipelineLibraryFlagsEXT partFlags[PART_COUNT] = {
+        VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT
+    };
+
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+    libraryInfo.pNext = state.pipeline.pNext;
+    libraryInfo.flags = partFlags[part];
+
+    // Keep only the state the part owns; the rest must not be looked at by the driver
+    VkGraphicsPipelineCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    info.pNext = &libraryInfo;
+    info.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+    info.basePipelineIndex = -1;
+
+    switch( part )
+    {
+    case PART_VERTEX_INPUT:
+        libraryInfo.pNext = nullptr;
+        info.pVertexInputState = state.pipeline.pVertexInputState;
+        info.pInputAssemblyState = state.pipeline.pInputAssemblyState;
+        break;
+    case PART_PRE_RASTERIZATION:
+        info.stageCount = 1;
+        info.pStages = &state.stages[0];
+        info.pViewportState = state.pipeline.pViewportState;
+        info.pRasterizationState = state.pipeline.pRasterizationState;
+        info.pDynamicState = state.pipeline.pDynamicState;
+        info.layout = desc.layout;
+        info.renderPass = target.renderPass;
+        break;
+    case PART_FRAGMENT_SHADER:
+        info.stageCount = 1;
+        info.pStages = &state.stages[1];
+        info.pMultisampleState = state.pipeline.pMultisampleState;
+        info.layout = desc.layout;
+        info.renderPass = target.renderPass;
+        break;
+    default:
+        info.pMultisampleState = state.pipeline.pMultisampleState;
+        info.pColorBlendState = state.pipeline.pColorBlendState;
+        info.renderPass = target.renderPass;
+        break;
+    }
+
+    const auto compileStart = std::chrono::steady_clock::now();
+
+    VkPipeline library;
+    if( vkCreateGraphicsPipelines( m_device, m_cache, 1, &info, nullptr, &library ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create graphics pipeline library for " + desc.vertSpv + " / " + desc.fragSpv );
+    }
+
+    const double compileTime = millisecondsSince( compileStart );
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_libraryStats.parts++;
+    m_libraryStats.partCompileMs += compileTime;
+
+    return library;
+}
+
+// Compiled outside the lock; if another thread got there first its library wins
+VkPipeline PipelineCompiler::getPart( Part part, const GraphicsPipelineDesc& desc, const PipelineTarget& target )
+{
+    ObjectKey key = partKey( part, desc, target );
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        auto cached = m_parts.find( key );
+        if( cached != m_parts.end() )
+        {
+            return cached->second;
+        }
+    }
+
+    VkPipeline library = compilePart( part, desc, target );
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+    auto inserted = m_parts.emplace( std::move( key ), library );
+    if( !inserted.second )
+    {
+        vkDestroyPipeline( m_device, library, nullptr );
+    }
+    return inserted.first->second;
+}
+
+void PipelineCompiler::precompileLibraries( const std::vector<GraphicsPipelineDesc>& descs, const PipelineTarget& target, ThreadPool* pool )
+{
+    // One task per distinct missing part, so no two tasks compile the same one
+    std::vector<std::pair<Part, const GraphicsPipelineDesc*>> missing;
+    {
+        std::unordered_map<ObjectKey, bool, ObjectKeyHash> seen;
+        std::lock_guard<std::mutex> lock( m_mutex );
+        for( const auto& desc : descs )
+        {
+            for( uint32_t part = 0; part < PART_COUNT; part++ )
+            {
+                ObjectKey key = partKey( static_cast< Part >( part ), desc, target );
+                if( m_parts.find( key ) == m_parts.end() && seen.emplace( std::move( key ), true ).second )
+                {
+                    missing.emplace_back( static_cast< Part >( part ), &desc );
+                }
+            }
+        }
+    }
+
+    auto task = [&]( uint32_t index, uint32_t )
+    {
+        getPart( missing[index].first, *missing[index].second, target );
+    };
+
+    if( pool != nullptr )
+    {
+        pool->run( static_cast< uint32_t >( missing.size() ), task );
+    }
+    else
+    {
+        for( uint32_t i = 0; i < missing.size(); i++ )
+        {
+            task( i, 0 );
+        }
+    }
+}
+
+VkPipeline PipelineCompiler::link( const GraphicsPipelineDesc& desc, const PipelineTarget& target, bool optimize, double* linkMs )
+{
+    if( !m_libraries )
+    {
+        throw std::runtime_error( "Pipeline libraries are not enabled" );
+    }
+
+    VkPipeline libraries[PART_COUNT];
+    for( uint32_t part = 0; part < PART_COUNT; part++ )
+    {
+        libraries[part] = getPart( static_cast< Part >( part ), desc, target );
+    }
+
+    VkPipelineLibraryCreateInfoKHR libraryInfo{};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    libraryInfo.libraryCount = PART_COUNT;
+    libraryInfo.pLibraries = libraries;
+
+    VkGraphicsPipelineCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    info.pNext = &libraryInfo;
+    info.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+    info.layout = desc.layout;
+    info.basePipelineIndex = -1;
+
+    const auto linkStart = std::chrono::steady_clock::now();
+
+    VkPipeline pipeline;
+    if( vkCreateGraphicsPipelines( m_device, m_cache, 1, &info, nullptr, &pipeline ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to link graphics pipeline for " + desc.vertSpv + " / " + desc.fragSpv );
+    }
+
+    const double linkTime = millisecondsSince( linkStart );
+    if( linkMs != nullptr )
+    {
+        *linkMs = linkTime;
+    }
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+    if( optimize )
+    {
+        m_libraryStats.optimizedLinks++;
+        m_libraryStats.optimizedLinkMs += linkTime;
+    }
+    else
+    {
+        m_libraryStats.fastLinks++;
+        m_libraryStats.fastLinkMs += linkTime;
+    }
+
+    return pipeline;
+}
+
+std::future<VkPipeline> PipelineCompiler::linkOptimizedAsync( const GraphicsPipelineDesc& desc, const PipelineTarget& target )
+{
+    return std::async( std::launch::async, [this, desc, target]()
+    {
+        return link( desc, target, true );
+    } );
+}
+
+PipelineCompiler::LibraryStats PipelineCompiler::libraryStats()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_libraryStats;
+}
@@ -0,0 +1,99 @@
+#include <presentpolicy.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+static std::vector<VkPresentModeKHR> preferredModes( PresentGoal goal )
+{
+    switch( goal )
+    {
+    case PRESENT_LOW_LATENCY:
+        return { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR };
+    case PRESENT_THROUGHPUT:
+        return { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR };
+    case PRESENT_POWER_SAVING:
+    default:
+        return { VK_PRESENT_MODE_FIFO_KHR };
+    }
+}
+
+VkPresentModeKHR ChoosePresentMode( PresentGoal goal, const std::vector<VkPresentModeKHR>& availableModes )
+{
+    for( VkPresentModeKHR mode : preferredModes( goal ) )
+    {
+        if( std::find( availableModes.begin(), availableModes.end(), mode ) != availableModes.end() )
+        {
+            return mode;
+        }
+    }
+
+    // Required by the spec on every surface
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+VkPresentModeKHR ChoosePresentMode( VkPresentModeKHR requested, PresentGoal goal, const std::vector<VkPresentModeKHR>& availableModes )
+{
+    if( std::find( availableModes.begin(), availableModes.end(), requested ) != availableModes.end() )
+    {
+        return requested;
+    }
+
+    return ChoosePresentMode( goal, availableModes );
+}
+
+const char* PresentModeName( VkPresentModeKHR mode )
+{
+    switch( mode )
+    {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR:
+        return "fifo";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "fifo_relaxed";
+    default:
+        return "other";
+    }
+}
+
+const char* PresentGoalName( PresentGoal goal )
+{
+    switch( goal )
+    {
+    case PRESENT_LOW_LATENCY:
+        return "latency";
+    case PRESENT_THROUGHPUT:
+        return "throughput";
+    case PRESENT_POWER_SAVING:
+    default:
+        return "power";
+    }
+}
+
+PresentGoal ParsePresentGoal( const std::string& name )
+{
+    for( PresentGoal goal : { PRESENT_LOW_LATENCY, PRESENT_THROUGHPUT, PRESENT_POWER_SAVING } )
+    {
+        if( name == PresentGoalName( goal ) )
+        {
+            return goal;
+        }
+    }
+
+    throw std::runtime_error( "Unknown present goal " + name + ", expected latency, throughput or power" );
+}
+
+VkPresentModeKHR ParsePresentMode( const std::string& name )
+{
+    for( VkPresentModeKHR mode : { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR } )
+    {
+        if( name == PresentModeName( mode ) )
+        {
+            return mode;
+        }
+    }
+
+    throw std::runtime_error( "Unknown present mode " + name + ", expected fifo, fifo_relaxed, mailbox or immediate" );
+}
@@ -0,0 +1,125 @@
+#include <shadercache.h>
+
+#include <cstring>
+#include <stdexcept>
+
+void ShaderModuleCache::init( VkDevice device )
+{
+    m_device = device;
+}
+
+void ShaderModuleCache::destroy()
+{
+    for( auto& module : m_modules )
+    {
+        vkDestroyShaderModule( m_device, module.second.module, nullptr );
+    }
+
+    for( auto module : m_uncached )
+    {
+        vkDestroyShaderModule( m_device, module, nullptr );
+    }
+
+    m_modules.clear();
+    m_uncached.clear();
+    m_paths.clear();
+}
+
+VkShaderModule ShaderModuleCache::get( const std::string& spvPath )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    auto path = m_paths.find( spvPath );
+    if( path != m_paths.end() )
+    {
+        m_stats.cacheHits++;
+        return path->second;
+    }
+
+    std::unique_ptr<MappedFile> file = std::make_unique<MappedFile>( spvPath );
+
+    if( file->size() % sizeof( uint32_t ) != 0 )
+    {
+        throw std::runtime_error( "Invalid SPIR-V size in " + spvPath );
+    }
+
+    m_stats.bytesMapped += file->size();
+    m_stats.filesMapped++;
+
+    // Mappings are page aligned, so the words can be passed straight to the driver
+    const uint32_t* code = static_cast< const uint32_t* >( file->data() );
+    const size_t size = file->size();
+    VkShaderModule module = getLocked( code, size, std::move( file ) );
+    m_paths.emplace( spvPath, module );
+
+    return module;
+}
+
+VkShaderModule ShaderModuleCache::get( const uint32_t* code, size_t size )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return getLocked( code, size, nullptr );
+}
+
+// Without a mapping the caller's code may go away, so a cached module keeps a copy of it
+VkShaderModule ShaderModuleCache::getLocked( const uint32_t* code, size_t size, std::unique_ptr<MappedFile> mapping )
+{
+    const uint64_t key = hash( code, size );
+
+    auto cached = m_modules.find( key );
+    if( cached != m_modules.end() && cached->second.size == size && memcmp( cached->second.code, code, size ) == 0 )
+    {
+        m_stats.cacheHits++;
+        return cached->second.module;
+    }
+
+    VkShaderModuleCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    info.codeSize = size;
+    info.pCode = code;
+
+    VkShaderModule module;
+    if( vkCreateShaderModule( m_device, &info, nullptr, &module ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create Shader Module" );
+    }
+
+    m_stats.modulesCreated++;
+
+    if( cached != m_modules.end() )
+    {
+        // Hash collision with different code, keep this one out of the cache
+        m_uncached.push_back( module );
+    }
+    else
+    {
+        Entry entry{ module, code, size, std::move( mapping ), {} };
+        if( !entry.mapping )
+        {
+            entry.copy.assign( code, code + size / sizeof( uint32_t ) );
+            entry.code = entry.copy.data();
+        }
+        m_modules.emplace( key, std::move( entry ) );
+    }
+
+    return module;
+}
+
+const ShaderModuleCache::Stats& ShaderModuleCache::stats() const
+{
+    return m_stats;
+}
+
+uint64_t ShaderModuleCache::hash( const uint32_t* code, size_t size )
+{
+    // FNV-1a over 32-bit words; SPIR-V is always a whole number of words
+    uint64_t hash = 14695981039346656037ull;
+
+    for( size_t i = 0; i < size / sizeof( uint32_t ); i++ )
+    {
+        hash ^= code[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash ^ size;
+}
@@ -0,0 +1,109 @@
+#include <startup.h>
+
+#include <algorithm>
+
+StartupProfiler::StartupProfiler() :
+    m_start( TimingStats::Clock::now() )
+{
+}
+
+double StartupProfiler::sinceStart( TimingStats::Clock::time_point time ) const
+{
+    return std::chrono::duration<double, std::milli>( time - m_start ).count();
+}
+
+void StartupProfiler::step( const std::string& name, const std::function<void()>& work, uint32_t worker )
+{
+    TimingStats::Clock::time_point start = TimingStats::Clock::now();
+    work();
+    record( name, start, TimingStats::Clock::now(), worker );
+}
+
+void StartupProfiler::record( const std::string& name, TimingStats::Clock::time_point start, TimingStats::Clock::time_point end, uint32_t worker )
+{
+    Step step;
+    step.name = name;
+    step.startMs = sinceStart( start );
+    step.durationMs = std::chrono::duration<double, std::milli>( end - start ).count();
+    step.worker = worker;
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_steps.push_back( step );
+}
+
+bool StartupProfiler::markFirstFrame()
+{
+    const double now = sinceStart( TimingStats::Clock::now() );
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+    if( m_firstFrameMarked )
+    {
+        return false;
+    }
+
+    m_firstFrameMarked = true;
+    m_firstFrameMs = now;
+    return true;
+}
+
+bool StartupProfiler::firstFrameMarked() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_firstFrameMarked;
+}
+
+double StartupProfiler::firstFrameMs() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_firstFrameMs;
+}
+
+std::vector<StartupProfiler::Step> StartupProfiler::steps() const
+{
+    std::vector<Step> steps;
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        steps = m_steps;
+    }
+
+    std::stable_sort( steps.begin(), steps.end(), []( const Step& a, const Step& b )
+    {
+        return a.startMs < b.startMs;
+    } );
+    return steps;
+}
+
+double StartupProfiler::busyMs() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    double busy = 0.0;
+    for( const auto& step : m_steps )
+    {
+        busy += step.durationMs;
+    }
+    return busy;
+}
+
+void StartupProfiler::report( std::ostream& out ) const
+{
+    const std::vector<Step> ordered = steps();
+
+    size_t nameWidth = 0;
+    for( const auto& step : ordered )
+    {
+        nameWidth = std::max( nameWidth, step.name.size() );
+    }
+
+    out << "Startup steps (start, duration, worker):" << std::endl;
+    for( const auto& step : ordered )
+    {
+        out << "  " << step.name << std::string( nameWidth - step.name.size(), ' ' ) << "  +" << step.startMs << " ms  "
+            << step.durationMs << " ms  #" << step.worker << std::endl;
+    }
+
+    if( firstFrameMarked() )
+    {
+        out << "  first frame submitted at " << firstFrameMs() << " ms, " << busyMs() << " ms of steps" << std::endl;
+    }
+}
@@ -0,0 +1,142 @@
+#include <taskgraph.h>
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+
+TaskGraph::TaskId TaskGraph::add( const std::string& name, std::function<void()> work, const std::vector<TaskId>& dependencies )
+{
+    const TaskId id = static_cast< TaskId >( m_tasks.size() );
+
+    for( TaskId dependency : dependencies )
+    {
+        if( dependency >= id )
+        {
+            throw std::runtime_error( "Task " + name + " depends on a task added after it" );
+        }
+        m_tasks[dependency].dependents.push_back( id );
+    }
+
+    Task task;
+    task.name = name;
+    task.work = std::move( work );
+    task.dependencyCount = static_cast< uint32_t >( dependencies.size() );
+    m_tasks.push_back( std::move( task ) );
+
+    return id;
+}
+
+uint32_t TaskGraph::size() const
+{
+    return static_cast< uint32_t >( m_tasks.size() );
+}
+
+void TaskGraph::runTask( const Task& task, StartupProfiler* profiler, uint32_t worker )
+{
+    if( profiler != nullptr )
+    {
+        profiler->step( task.name, task.work, worker );
+    }
+    else
+    {
+        task.work();
+    }
+}
+
+void TaskGraph::run( ThreadPool* pool, StartupProfiler* profiler )
+{
+    if( pool == nullptr || pool->size() == 1 )
+    {
+        for( const auto& task : m_tasks )
+        {
+            runTask( task, profiler, 0 );
+        }
+        return;
+    }
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<uint32_t> waitingOn( m_tasks.size() );
+    // Lowest id first, so ready tasks start in the order they were added
+    std::set<TaskId> ready;
+    uint32_t finished = 0;
+    uint32_t running = 0;
+    std::exception_ptr error;
+
+    for( TaskId id = 0; id < m_tasks.size(); id++ )
+    {
+        waitingOn[id] = m_tasks[id].dependencyCount;
+        if( waitingOn[id] == 0 )
+        {
+            ready.insert( id );
+        }
+    }
+
+    // Every thread takes ready tasks until there are none left to come. Whichever thread
+    // finishes a task releases its dependents.
+    pool->run( pool->size(), [&]( uint32_t, uint32_t worker )
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+
+        while( true )
+        {
+            changed.wait( lock, [&]
+            {
+                return !ready.empty() || finished == m_tasks.size() || ( error && running == 0 );
+            } );
+
+            if( ready.empty() )
+            {
+                return;
+            }
+
+            const TaskId id = *ready.begin();
+            ready.erase( ready.begin() );
+            running++;
+            lock.unlock();
+
+            std::exception_ptr taskError;
+            try
+            {
+                runTask( m_tasks[id], profiler, worker );
+            }
+            catch( ... )
+            {
+                taskError = std::current_exception();
+            }
+
+            lock.lock();
+            running--;
+            finished++;
+
+            if( taskError && !error )
+            {
+                error = taskError;
+            }
+
+            if( error )
+            {
+                ready.clear();
+            }
+            else
+            {
+                for( TaskId dependent : m_tasks[id].dependents )
+                {
+                    if( --waitingOn[dependent] == 0 )
+                    {
+                        ready.insert( dependent );
+                    }
+                }
+            }
+
+            changed.notify_all();
+        }
+    } );
+
+    if( error )
+    {
+        std::rethrow_exception( error );
+    }
+}
@@ -0,0 +1,138 @@
+#include <threadpool.h>
+
+#include <algorithm>
+
+ThreadPool::ThreadPool( uint32_t threadCount )
+{
+    threadCount = std::max( threadCount, 1u );
+
+    // Worker 0 is whoever calls run()
+    for( uint32_t i = 1; i < threadCount; i++ )
+    {
+        m_threads.emplace_back( &ThreadPool::workerLoop, this, i );
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for( auto& thread : m_threads )
+    {
+        thread.join();
+    }
+}
+
+uint32_t ThreadPool::size() const
+{
+    return static_cast< uint32_t >( m_threads.size() + 1 );
+}
+
+void ThreadPool::run( uint32_t taskCount, const std::function<void( uint32_t, uint32_t )>& task )
+{
+    if( taskCount == 0 )
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_task = &task;
+        m_taskCount = taskCount;
+        m_nextTask = 0;
+        m_pendingTasks = taskCount;
+        m_error = nullptr;
+        m_generation++;
+    }
+
+    // A single task is not worth waking anybody for
+    if( taskCount > 1 )
+    {
+        m_wake.notify_all();
+    }
+
+    runTasks( 0 );
+
+    std::exception_ptr error;
+    {
+        // Workers must have left this generation before m_task goes out of scope
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_done.wait( lock, [this]
+        {
+            return m_pendingTasks == 0 && m_activeWorkers == 0;
+        } );
+
+        m_task = nullptr;
+        error = m_error;
+    }
+
+    if( error )
+    {
+        std::rethrow_exception( error );
+    }
+}
+
+void ThreadPool::workerLoop( uint32_t workerIndex )
+{
+    uint64_t seenGeneration = 0;
+
+    while( true )
+    {
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_wake.wait( lock, [this, seenGeneration]
+            {
+                return m_stop || ( m_generation != seenGeneration && m_task != nullptr );
+            } );
+
+            if( m_stop )
+            {
+                return;
+            }
+
+            seenGeneration = m_generation;
+            m_activeWorkers++;
+        }
+
+        runTasks( workerIndex );
+
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_activeWorkers--;
+        }
+        m_done.notify_all();
+    }
+}
+
+void ThreadPool::runTasks( uint32_t workerIndex )
+{
+    uint32_t finished = 0;
+
+    for( uint32_t taskIndex = m_nextTask++; taskIndex < m_taskCount; taskIndex = m_nextTask++ )
+    {
+        try
+        {
+            ( *m_task )( taskIndex, workerIndex );
+        }
+        catch( ... )
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            if( !m_error )
+            {
+                m_error = std::current_exception();
+            }
+        }
+        finished++;
+    }
+
+    if( finished > 0 )
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_pendingTasks -= finished;
+    }
+    m_done.notify_all();
+}
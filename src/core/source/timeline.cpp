@@ -0,0 +1,86 @@
+#include <timeline.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+void TimelineSemaphore::init( VkDevice device, bool khr )
+{
+    m_device = device;
+    m_completed = 0;
+
+    m_getCounterValue = reinterpret_cast< PFN_vkGetSemaphoreCounterValueKHR >(
+        vkGetDeviceProcAddr( m_device, khr ? "vkGetSemaphoreCounterValueKHR" : "vkGetSemaphoreCounterValue" ) );
+    m_waitSemaphores = reinterpret_cast< PFN_vkWaitSemaphoresKHR >(
+        vkGetDeviceProcAddr( m_device, khr ? "vkWaitSemaphoresKHR" : "vkWaitSemaphores" ) );
+
+    if( m_getCounterValue == nullptr || m_waitSemaphores == nullptr )
+    {
+        throw std::runtime_error( "Timeline semaphore entry points not found" );
+    }
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if( vkCreateSemaphore( m_device, &semaphoreInfo, nullptr, &m_semaphore ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create timeline semaphore" );
+    }
+}
+
+void TimelineSemaphore::destroy()
+{
+    if( m_semaphore != VK_NULL_HANDLE )
+    {
+        vkDestroySemaphore( m_device, m_semaphore, nullptr );
+    }
+    m_semaphore = VK_NULL_HANDLE;
+}
+
+VkSemaphore TimelineSemaphore::semaphore() const
+{
+    return m_semaphore;
+}
+
+uint64_t TimelineSemaphore::completedValue()
+{
+    uint64_t value = 0;
+    if( m_getCounterValue( m_device, m_semaphore, &value ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to read timeline semaphore" );
+    }
+
+    m_completed = std::max( m_completed, value );
+    return m_completed;
+}
+
+bool TimelineSemaphore::isComplete( uint64_t value )
+{
+    return value <= m_completed || value <= completedValue();
+}
+
+void TimelineSemaphore::wait( uint64_t value )
+{
+    if( value <= m_completed )
+    {
+        return;
+    }
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_semaphore;
+    waitInfo.pValues = &value;
+
+    if( m_waitSemaphores( m_device, &waitInfo, UINT64_MAX ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to wait for timeline semaphore" );
+    }
+
+    m_completed = std::max( m_completed, value );
+}
@@ -0,0 +1,164 @@
+#include <timing.h>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+std::vector<float> TimingRing::snapshot() const
+{
+    const uint64_t written = count();
+    const uint64_t available = std::min<uint64_t>( written, CAPACITY );
+
+    std::vector<float> values( static_cast< size_t >( available ) );
+
+    for( uint64_t i = 0; i < available; i++ )
+    {
+        values[static_cast< size_t >( i )] = m_samples[( written - available + i ) % CAPACITY];
+    }
+
+    return values;
+}
+
+uint32_t TimingStats::addSeries( const std::string& name )
+{
+    uint32_t existing = findSeries( name );
+    if( existing != INVALID_SERIES )
+    {
+        return existing;
+    }
+
+    auto series = std::make_unique<Series>();
+    series->name = name;
+    m_series.push_back( std::move( series ) );
+
+    return static_cast< uint32_t >( m_series.size() - 1 );
+}
+
+uint32_t TimingStats::findSeries( const std::string& name ) const
+{
+    for( size_t i = 0; i < m_series.size(); i++ )
+    {
+        if( m_series[i]->name == name )
+        {
+            return static_cast< uint32_t >( i );
+        }
+    }
+
+    return INVALID_SERIES;
+}
+
+void TimingStats::setInfo( const std::string& key, const std::string& value )
+{
+    for( auto& info : m_info )
+    {
+        if( info.first == key )
+        {
+            info.second = value;
+            return;
+        }
+    }
+
+    m_info.emplace_back( key, value );
+}
+
+TimingStats::Summary TimingStats::summarize( uint32_t series ) const
+{
+    Summary summary;
+    summary.name = m_series[series]->name;
+    summary.count = m_series[series]->samples.count();
+
+    std::vector<float> values = m_series[series]->samples.snapshot();
+    if( values.empty() )
+    {
+        return summary;
+    }
+
+    std::sort( values.begin(), values.end() );
+
+    // Nearest-rank percentile over the retained window
+    auto percentile = [&values]( double p )
+    {
+        size_t rank = static_cast< size_t >( p * ( values.size() - 1 ) + 0.5 );
+        return static_cast< double >( values[rank] );
+    };
+
+    double sum = 0.0;
+    for( float value : values )
+    {
+        sum += value;
+    }
+
+    summary.mean = sum / values.size();
+    summary.min = values.front();
+    summary.p50 = percentile( 0.50 );
+    summary.p95 = percentile( 0.95 );
+    summary.p99 = percentile( 0.99 );
+    summary.max = values.back();
+
+    return summary;
+}
+
+static std::string jsonString( const std::string& value )
+{
+    std::string escaped = "\"";
+
+    for( char c : value )
+    {
+        if( static_cast< unsigned char >( c ) < 0x20 )
+        {
+            // Control characters are not allowed raw in JSON strings
+            const char* hex = "0123456789abcdef";
+            escaped += "\\u00";
+            escaped += hex[( c >> 4 ) & 0xf];
+            escaped += hex[c & 0xf];
+            continue;
+        }
+        if( c == '"' || c == '\\' )
+        {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+
+    return escaped + "\"";
+}
+
+void TimingStats::writeJson( std::ostream& out ) const
+{
+    out << "{\n  \"info\": {";
+    for( size_t i = 0; i < m_info.size(); i++ )
+    {
+        out << ( i ? ",\n    " : "\n    " ) << jsonString( m_info[i].first ) << ": " << jsonString( m_info[i].second );
+    }
+    out << ( m_info.empty() ? "},\n" : "\n  },\n" );
+
+    out << "  \"series\": [";
+    for( uint32_t i = 0; i < m_series.size(); i++ )
+    {
+        Summary summary = summarize( i );
+
+        out << ( i ? ",\n    " : "\n    " )
+            << "{ \"name\": " << jsonString( summary.name )
+            << ", \"unit\": \"ms\""
+            << ", \"count\": " << summary.count
+            << ", \"mean\": " << summary.mean
+            << ", \"min\": " << summary.min
+            << ", \"p50\": " << summary.p50
+            << ", \"p95\": " << summary.p95
+            << ", \"p99\": " << summary.p99
+            << ", \"max\": " << summary.max << " }";
+    }
+    out << ( m_series.empty() ? "]\n}\n" : "\n  ]\n}\n" );
+}
+
+void TimingStats::writeJson( const std::string& path ) const
+{
+    std::ofstream file( path, std::ios::trunc );
+
+    if( !file.is_open() )
+    {
+        throw std::runtime_error( "Error while opening timing report " + path );
+    }
+
+    writeJson( file );
+}
@@ -0,0 +1,155 @@
+#include <upload.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+void UploadRing::init( VkDevice device, DeviceAllocator& allocator, VkDeviceSize size, VkDeviceSize alignment, uint32_t frameSlots )
+{
+    m_device = device;
+    m_allocator = &allocator;
+    m_capacity = size;
+    m_alignment = std::max<VkDeviceSize>( alignment, 4 );
+    m_slotMarkers.assign( frameSlots, 0 );
+
+    VkBufferCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    createInfo.size = size;
+    createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if( vkCreateBuffer( m_device, &createInfo, nullptr, &m_buffer ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Error while creating staging buffer" );
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements( m_device, m_buffer, &memoryRequirements );
+
+    // Coherent, so writes need no vkFlushMappedMemoryRanges before the copy is submitted
+    m_allocation = m_allocator->allocate( memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT );
+
+    vkBindBufferMemory( m_device, m_buffer, m_allocation.memory, m_allocation.offset );
+}
+
+void UploadRing::destroy()
+{
+    if( m_buffer != VK_NULL_HANDLE )
+    {
+        vkDestroyBuffer( m_device, m_buffer, nullptr );
+        m_allocator->free( m_allocation );
+        m_buffer = VK_NULL_HANDLE;
+    }
+}
+
+void UploadRing::beginFrame( uint32_t slot )
+{
+    // Slots retire in submission order, so everything written before this marker is free
+    m_released = std::max( m_released, m_slotMarkers[slot] );
+}
+
+bool UploadRing::upload( VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size )
+{
+    VkDeviceSize offset = m_written % m_capacity;
+    VkDeviceSize alignedOffset = ( offset + m_alignment - 1 ) / m_alignment * m_alignment;
+    VkDeviceSize padding = alignedOffset - offset;
+
+    // A copy never straddles the end of the ring; skip the tail and start over at 0
+    if( alignedOffset + size > m_capacity )
+    {
+        padding = m_capacity - offset;
+        alignedOffset = 0;
+    }
+
+    if( m_written + padding + size - m_released > m_capacity )
+    {
+        return false;
+    }
+
+    memcpy( static_cast< uint8_t* >( m_allocation.mapped ) + alignedOffset, data, static_cast< size_t >( size ) );
+
+    PendingCopy copy;
+    copy.dst = dst;
+    copy.region.srcOffset = alignedOffset;
+    copy.region.dstOffset = dstOffset;
+    copy.region.size = size;
+    m_pending.push_back( copy );
+
+    m_written += padding + size;
+
+    m_stats.bytesUploaded += size;
+    m_stats.copies++;
+
+    return true;
+}
+
+bool UploadRing::hasPending() const
+{
+    return !m_pending.empty();
+}
+
+void UploadRing::record( VkCommandBuffer commandBuffer, uint32_t slot )
+{
+    m_slotMarkers[slot] = m_written;
+
+    if( m_pending.empty() )
+    {
+        return;
+    }
+
+    const VkPipelineStageFlags readStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+    // Earlier frames may still be reading the ranges about to be overwritten
+    vkCmdPipelineBarrier( commandBuffer, readStages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr );
+
+    // One vkCmdCopyBuffer per destination buffer
+    std::stable_sort( m_pending.begin(), m_pending.end(), []( const PendingCopy& a, const PendingCopy& b )
+    {
+        return a.dst < b.dst;
+    } );
+
+    std::vector<VkBufferCopy> regions;
+    for( size_t first = 0; first < m_pending.size(); )
+    {
+        size_t last = first;
+        regions.clear();
+
+        while( last < m_pending.size() && m_pending[last].dst == m_pending[first].dst )
+        {
+            regions.push_back( m_pending[last].region );
+            last++;
+        }
+
+        vkCmdCopyBuffer( commandBuffer, m_buffer, m_pending[first].dst, static_cast< uint32_t >( regions.size() ), regions.data() );
+        first = last;
+    }
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+        VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, readStages, 0, 1, &barrier, 0, nullptr, 0, nullptr );
+
+    m_pending.clear();
+    m_stats.flushes++;
+}
+
+void UploadRing::reset()
+{
+    m_written = 0;
+    m_released = 0;
+    std::fill( m_slotMarkers.begin(), m_slotMarkers.end(), 0 );
+}
+
+VkDeviceSize UploadRing::capacity() const
+{
+    return m_capacity;
+}
+
+const UploadRing::Stats& UploadRing::stats() const
+{
+    return m_stats;
+}